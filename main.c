@@ -1,246 +1,91 @@
-// TODO: figure out how to let particles "pass" each other unaffected. In other
-// words, if certain particles do not interact, but they happen to land at the
-// same pixel location, how do I not lose one of them?
+// SDL front end: a window onto one world from the momentum engine library.
 //
 #include <assert.h>
 #include <SDL.h>
+#include "momentum.h"
 
 typedef uint32_t u32;
 typedef uint8_t bool;
 typedef uint8_t u8;
-/* typedef int16_t i16; */
+typedef uint64_t u64;
 
 #define true 1
 #define false 0
 
-#define internal static // static functions are "internal"
-
 #define PIXEL_SCALE 5
-#define SCREEN_WIDTH 100
-#define SCREEN_HEIGHT 100
-
-// Identify empty space
-#define EMPTY_SPACE 0x00000000
-// Return value for pixels outside the screen area
-#define OUT_OF_BOUNDS 0x00000001
-
-// Create projectiles as pixel particles
-#define PROJECTILE_COLOR 0xFFFF0000 // opaque red
 // Play with these numbers to tune the "feel"
 // TODO: make it so that one #define controls simulation speed.
 // Smaller physics delay moves the simulation faster.
 // Alternatively, go faster by making BLAST and GRAVITY larger.
-#define PHYSICS_DELAY 4 // ms -- Calc physics this often
-#define VIDEO_DELAY 16 // ms -- Render this often, sort of
-// Actually renders frames at FRAMES_PER_PHYSICS * PHYSICS_DELAY
-// and FRAMES_PER_PHYSICS is integer truncated (e.g., 16/3 = 5).
-#define FRAMES_PER_PHYSICS (VIDEO_DELAY/PHYSICS_DELAY)
-#define GRAVITY 0.01 // tie this to FRAMES_PER_PHYSICS?
-#define BLAST  -1.2   // tie this to FRAMES_PER_PHYSICS?
-
-typedef struct
-{
-    int x; // row of topleft corner
-    int y; // col of topleft corner
-    int w; // width
-    int h; // height
-} rect_t;
+#define PHYSICS_DELAY 4 // ms -- Calc physics this often (--tick-ms to change)
+#define VIDEO_DELAY 16 // ms -- Render this often
+// Frames land between ticks and draw projectiles partway between the last two,
+// so a slower physics rate still moves smoothly.
+#define MAX_CATCH_UP 25 // ticks -- after a stall, skip ticks past this many
+#define REWIND_BUDGET (16 << 20) // bytes of history to scrub back through
 
-typedef struct
-{
-    float x;  // vertical position as float (think fractional rows)
-    float y;  // horizontal position as float (think fractional cols)
-    float dx; // vertical (think rows)
-    float dy; // horizontal (think cols)
-} momentum_t;
-
-/**
- *  \brief Move rectangle topleft to x,y
- *
- *  \param rect Pointer to the rectangle to move
- *  \param x    Destination row
- *  \param y    Destination column
- *
- *  Example: to move player UP one pixel:
- *      MoveRect(&player, player.x++, player.y)
- */
-internal void MoveRect(rect_t *rect, int x, int y)
-{
-    // TODO: clamp to allowed positions
-    rect->x = x;
-    rect->y = y;
-}
-
-internal void FillRect(rect_t rect, u32 pixel_color, u32 *buffer)
+int main(int argc, char **argv)
 {
-    assert(buffer);
-    for (int row=0; row < rect.h; row++)
+    // ---Headless modes---
+
+    int status = MomentumHeadless(argc, argv);
+    if (status >= 0) return status;
+
+    // ---World---
+
+    world_config_t config = {0, 0x6D6F6D656E74756D, PIXEL_SCALE}; // seed: "momentum"
+    world_t *world = WorldCreate(&config);
+    int rows, cols;
+    WorldSize(world, &rows, &cols);
+    WorldSetRewind(world, REWIND_BUDGET);
+
+    // ---Options---
+
+    // --hash-log [path]: write the world hash every tick, to compare runs
+    // --shm [name]: share every tick with other processes (see --shm-view)
+    // --record [path]: record every projectile every tick (see --record-bench)
+    // --tick-ms [ms]: physics tick length, PHYSICS_DELAY by default
+    // --glow: bright projectiles glow, for presentation
+    SDL_RWops *hash_log = NULL;
+    recorder_t *recorder = NULL;
+    momentum_t *particles = NULL;
+    int tick_ms = PHYSICS_DELAY;
+    bloom_t *bloom = NULL;
+    for (int i=1; i < argc; i++)
     {
-        for (int col=0; col < rect.w; col++)
+        const char *value = ((i+1 < argc) && (argv[i+1][0] != '-')) ? argv[i+1] : NULL;
+        if (strcmp(argv[i], "--hash-log") == 0)
         {
-            buffer[ (rect.x + row)*SCREEN_WIDTH + (rect.y + col) ] = pixel_color;
+            const char *path = value ? value : "momentum-hashes.txt";
+            hash_log = SDL_RWFromFile(path, "wb");
+            if (!hash_log) printf("Cannot open %s\n", path);
         }
-    }
-}
-
-/**
- *  \brief Set pixel color in PREV buffer.
- *
- *  \param x    Screen row number (0 is top)
- *  \param y    Screen col number (0 is left)
- *  \param color    Color to set at this pixel
- *  \param screen_pixels    Pointer to the screen buffer to write to
- */
-inline internal void ColorSetUnsafe(int x, int y, u32 color, u32 *screen_pixels)
-{
-    screen_pixels[x*SCREEN_WIDTH+y] = color;
-}
-
-/**
- *  \brief Get pixel color
- *
- *  \param x    Screen row number (0 is top)
- *  \param y    Screen col number (0 is left)
- *  \param screen_pixels    Pointer to the screen buffer
- *
- *  \return color   ARGB as unsigned 32-bit, or 1 if (x,y) is outside screen
- */
-inline internal u32 ColorAt(int x, int y, u32 *screen_pixels)
-{
-    if ((x >= 0) && (y >= 0) && (x < SCREEN_HEIGHT) && (y < SCREEN_WIDTH))
-    {
-        return screen_pixels[x*SCREEN_WIDTH+y];
-    }
-    else // Pixel is outside screen area
-    {
-        // Any value that is NOT "EMPTY_SPACE" acts as a boundary
-        assert(EMPTY_SPACE != OUT_OF_BOUNDS);
-        return OUT_OF_BOUNDS;
-    }
-}
-
-/**
- *  \brief Get particle momentum
- *
- *  \param x    Screen row number (0 is top)
- *  \param y    Screen col number (0 is left)
- *  \param momentum Pointer to the momentum buffer
- *
- *  \return momentum_t {float x, float y, float dx, float dy}
- */
-inline internal momentum_t MomentumAt(int x, int y, momentum_t *momentum)
-{
-    if ((x >= 0) && (y >= 0) && (x < SCREEN_HEIGHT) && (y < SCREEN_WIDTH))
-    {
-        return momentum[x*SCREEN_WIDTH+y];
-    }
-    else // Pixel is outside screen area
-    {
-        // Gotta return something. How about -1,-1,0,0?
-        momentum_t out_of_bounds_momentum = {-1,-1,0,0};
-        return out_of_bounds_momentum;
-    }
-}
-
-/**
- *  \brief Set momentum in PREV buffer.
- *
- *  \param x    Screen row number (0 is top)
- *  \param y    Screen col number (0 is left)
- *  \param momentum Momentum to set at this pixel
- *  \param momentum_buffer Pointer to the momentum buffer to write to
- */
-inline internal void MomentumSetUnsafe(int x, int y, momentum_t momentum, momentum_t *momentum_buffer)
-{
-    momentum_buffer[x*SCREEN_WIDTH+y] = momentum;
-}
-
-/**
- *  \brief Start a new projectile
- *
- *  \param projectile_buffer   Pointer to the position buffer `projectile_buffer`
- *  \param momentum_buffer Pointer to the projectile momentum buffer `momentum`
- */
-internal void InitProjectile(u32 *projectile_buffer, momentum_t *momentum_buffer)
-{
-    int x = SCREEN_HEIGHT-1;
-    int y = SCREEN_WIDTH/2;
-    momentum_t momentum = {(float)x,(float)y,BLAST,0};
-
-    if (ColorAt(x,y,projectile_buffer) == EMPTY_SPACE)
-    {
-        ColorSetUnsafe(x, y, PROJECTILE_COLOR, projectile_buffer);
-        MomentumSetUnsafe(x, y, momentum, momentum_buffer);
-    }
-}
-
-/**
- *  \brief Update projectiles
- *
- *  Read the projectile locations from PREV frame and write the new locations to
- *  the NEXT frame.
- *
- *  \param frame        Pointer to the `projectile_buffer`
- *                      Projectile POSITIONS for PREV frame
- *  \param frame_next   Pointer to the `projectile_buffer_next`
- *                      Projectile POSITIONS for NEXT frame
- *  \param momentum_prev Pointer to `momentum`
- *                      Projectile MOMENTUM for PREV frame
- *  \param momentum_next Pointer to `momentum_next`
- *                      Projectile MOMENTUM for NEXT frame
- */
-internal void DrawProjectile( // u32 *frame, u32 *frame_next
-        u32 *frame, u32 *frame_next,
-        momentum_t *momentum_prev, momentum_t *momentum_next
-        )
-{
-    for (int row=0; row < SCREEN_HEIGHT; row++)
-        for (int col=0; col < SCREEN_WIDTH; col++)
+        else if (strcmp(argv[i], "--shm") == 0)
         {
-            momentum_t momentum = MomentumAt(row, col, momentum_prev);
-            // Decelerate
-            momentum.dx += GRAVITY;
-            // Record new position in floating point
-            momentum.x += momentum.dx;
-            // Inspect color of this pixel and future location of this pixel
-            u32 color = ColorAt(row, col, frame);
-            // NOTE: Don't use roundf().
-            // roundf() is defined in math.h. Including it REALLY slows compilation.
-            // A simple integer truncate seems to work just as well as rounding.
-            /* u32 row_predict = roundf(momentum.x); */
-            u32 row_predict = (int)(momentum.x);
-            u32 color_predict = ColorAt(row_predict, col, frame);
-            switch (color)
+            const char *name = value ? value : "momentum";
+            if (!WorldShare(world, name))
             {
-                case PROJECTILE_COLOR:
-                        // TEMP: stop at top of screen
-                        if (color_predict == OUT_OF_BOUNDS)
-                        {
-                            // Erase the projectile
-                            ColorSetUnsafe(row, col, EMPTY_SPACE, frame_next);
-                            momentum_t momentum_new = {0,0,0,0};
-                            MomentumSetUnsafe(row, col, momentum_new, momentum_next);
-                        }
-                        // Keep moving: not at top of screen yet
-                        else
-                        {
-                            // Show projectile at future pixel location
-                            ColorSetUnsafe(row_predict, col, PROJECTILE_COLOR, frame_next);
-                            // Record "actual" floating-point position at this
-                            // future pixel location
-                            MomentumSetUnsafe(row_predict, col, momentum, momentum_next);
-                        }
-                    break;
+                printf("Cannot share the world as %s\n", name);
             }
         }
-}
-
+        else if (strcmp(argv[i], "--record") == 0)
+        {
+            const char *path = value ? value : "momentum-trajectory.bin";
+            recorder = RecorderOpen(path);
+            if (!recorder) printf("Cannot open %s\n", path);
+            particles = (momentum_t*) calloc(rows * cols, sizeof(momentum_t));
+            assert(particles);
+        }
+        else if (strcmp(argv[i], "--tick-ms") == 0)
+        {
+            tick_ms = SDL_max(value ? atoi(value) : PHYSICS_DELAY, 1);
+        }
+        else if (strcmp(argv[i], "--glow") == 0)
+        {
+            bloom = BloomCreate(PIXEL_SCALE*rows, PIXEL_SCALE*cols, 0);
+        }
+    }
 
-int main(int argc, char **argv)
-{
-    u8 frame_num = 1;
-    /* printf("%d",FRAMES_PER_PHYSICS); */
-    assert(FRAMES_PER_PHYSICS != 0);
     // ---------
     // | Setup |
     // ---------
@@ -250,15 +95,15 @@ int main(int argc, char **argv)
     SDL_Init(SDL_INIT_VIDEO);
 
     // Window is resizable with mouse. Pixels resize so that
-    // SCREEN_WIDTH x SCREEN_HEIGHT spans the window.
+    // cols x rows spans the window.
     // For precise pixel scaling, pass scaled values for
-    // SCREEN_WIDTH and SCREEN_HEIGHT in call to
+    // cols and rows in call to
     // SDL_CreateWindow().
     SDL_Window *window = SDL_CreateWindow(
             "momentum - Space to launch a particle", // const char *title
             /* SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, // int x, int y */
             SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, // int x, int y
-            PIXEL_SCALE*SCREEN_WIDTH, PIXEL_SCALE*SCREEN_HEIGHT, // int w, int h,
+            PIXEL_SCALE*cols, PIXEL_SCALE*rows, // int w, int h,
             SDL_WINDOW_RESIZABLE // Uint32 flags
             );
     assert(window);
@@ -279,44 +124,30 @@ int main(int argc, char **argv)
             renderer, // SDL_Renderer *
             format->format, // Uint32 format,
             SDL_TEXTUREACCESS_STREAMING, // int access,
-            SCREEN_WIDTH, SCREEN_HEIGHT // int w, int h
+            cols, rows // int w, int h
             );
     assert(player_texture);
     SDL_SetTextureBlendMode(player_texture, SDL_BLENDMODE_BLEND);
 
+    // Projectiles draw at sub-pixel positions, PIXEL_SCALE texels per pixel
     SDL_Texture *projectile_texture = SDL_CreateTexture(
             renderer, // SDL_Renderer *
             format->format, // Uint32 format,
             SDL_TEXTUREACCESS_STREAMING, // int access,
-            SCREEN_WIDTH, SCREEN_HEIGHT // int w, int h
+            PIXEL_SCALE*cols, PIXEL_SCALE*rows // int w, int h
             );
     assert(projectile_texture);
     SDL_SetTextureBlendMode(projectile_texture, SDL_BLENDMODE_BLEND);
 
     // ---Pixel Artwork Buffers---
 
-    u32 *player_buffer = (u32*) calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(u32));
-    assert(player_buffer);
-
-    u32 *projectile_buffer = (u32*) calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(u32));
-    assert(projectile_buffer);
-    u32 *projectile_buffer_next = (u32*) calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(u32));
-    assert(projectile_buffer_next);
-    momentum_t *momentum = (momentum_t*) calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(momentum_t));
-    assert(momentum);
-    momentum_t *momentum_next = (momentum_t*) calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(momentum_t));
-    assert(momentum_next);
-
-    // Create player: a 1x1 rectangle
-    const u8 player_size = 1;
-    rect_t player = {0,0,player_size,player_size}; // row,col,w,h
-    const u32 player_color = 0x8000FF00; // transparent green
-
-    // Start player at bottom left
-    MoveRect(&player, (SCREEN_HEIGHT-1)-player.h, 0);
-
-    // Create a rect for clearing pixel artwork from the screen
-    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    // One palette index per pixel, widened to ARGB straight into the textures
+    const u32 *palette = WorldPalette(world);
+    u8 *player_indexes = (u8*) calloc(cols * rows, sizeof(u8));
+    assert(player_indexes);
+    u8 *projectile_indexes = (u8*) calloc(PIXEL_SCALE*cols * PIXEL_SCALE*rows, sizeof(u8));
+    assert(projectile_indexes);
+    int player_row = -1, player_col = -1; // where the player texture last drew it
 
     // Initialize player controls
     bool pressed_space = false;
@@ -324,18 +155,21 @@ int main(int argc, char **argv)
     bool pressed_up    = false;
     bool pressed_left  = false;
     bool pressed_right = false;
+    bool held_rewind   = false;
 
     // -------------
     // | Game Loop |
     // -------------
 
     bool done = false;
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 tick_period = frequency * tick_ms / 1000;
+    Uint64 frame_period = frequency * VIDEO_DELAY / 1000;
+    Uint64 last_tick = SDL_GetPerformanceCounter(); // when the world last stepped
+    Uint64 last_frame = last_tick - frame_period; // draw right away
 
     while (!done)
     {
-        // Erase old artwork before updating position
-        FillRect(player, 0x00000000, player_buffer);
-
         // --------------
         // | Get inputs |
         // --------------
@@ -349,6 +183,7 @@ int main(int argc, char **argv)
             }
 
             SDL_Keycode code = event.key.keysym.sym;
+            int toggle = -1; // mode to switch on or off
 
             switch (code)
             {
@@ -376,9 +211,28 @@ int main(int argc, char **argv)
                     pressed_right = (event.type == SDL_KEYDOWN);
                     break;
 
+                case SDLK_r: // r - hold to scrub backward in time
+                    held_rewind = (event.type == SDL_KEYDOWN);
+                    break;
+
+                case SDLK_d: toggle = WORLD_LOD;     break; // d - level of detail
+                case SDLK_t: toggle = WORLD_TRAILS;  break; // t - trails
+                case SDLK_m: toggle = WORLD_HEATMAP; break; // m - heatmap
+                case SDLK_f: toggle = WORLD_FLUID;   break; // f - fluid: Space pours
+                case SDLK_w: toggle = WORLD_WIND;    break; // w - wind
+                case SDLK_b: toggle = WORLD_TUNNEL;  break; // b - wind tunnel
+                case SDLK_i: toggle = WORLD_HEAT;    break; // i - heat (infrared view)
+                case SDLK_c: toggle = WORLD_LIFE;    break; // c - cellular automaton
+                case SDLK_g: toggle = WORLD_CLOUD;   break; // g - gravity cloud
+                case SDLK_a: toggle = WORLD_SMOOTH;  break; // a - anti-aliasing
+
                 default:
                     break;
             }
+            if ((toggle >= 0) && (event.type == SDL_KEYDOWN))
+            {
+                WorldSetMode(world, (world_mode_t)toggle, !WorldMode(world, (world_mode_t)toggle));
+            }
         }
 
         // ------------------
@@ -387,86 +241,84 @@ int main(int argc, char **argv)
 
         if (pressed_space)
         {
-            InitProjectile(projectile_buffer, momentum);
+            WorldLaunch(world);
             pressed_space = false;
         }
-        if (pressed_down)
+        if (pressed_down || pressed_up || pressed_left || pressed_right)
         {
-            if ((player.x + player.h) < (SCREEN_HEIGHT-1) ) // not at bottom yet
-            {
-                MoveRect(&player, player.x+player.h, player.y);
-                pressed_down = false;
-            }
+            WorldMovePlayer(world, pressed_down - pressed_up, pressed_right - pressed_left);
+            pressed_down = pressed_up = pressed_left = pressed_right = false;
+        }
+
+        // -----------
+        // | Physics |
+        // -----------
+
+        // Run every tick that is due
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now - last_tick > MAX_CATCH_UP * tick_period)
+        {
+            last_tick = now - MAX_CATCH_UP * tick_period; // fell behind: slow down instead
         }
-        if (pressed_up)
+        while (now - last_tick >= tick_period)
         {
-            if (player.x > (0 + player.h)) // not at top yet
+            last_tick += tick_period;
+            if (held_rewind)
             {
-                MoveRect(&player, player.x-player.h, player.y);
-                pressed_up = false;
+                WorldRewind(world, WorldTick(world) - 1); // stops at the oldest tick kept
             }
-        }
-        if (pressed_left)
-        {
-            if (player.y > 0)
+            else
             {
-                MoveRect(&player, player.x, player.y-player.w);
-                pressed_left = false;
+                WorldStep(world);
             }
-        }
-        if (pressed_right)
-        {
-            if (player.y < (SCREEN_WIDTH - player.w))
+            if (hash_log)
+            {
+                u64 h = WorldHash(world);
+                char line[32];
+                int length = SDL_snprintf(line, sizeof(line), "%016llx\n", (unsigned long long)h);
+                SDL_RWwrite(hash_log, line, 1, length);
+            }
+            if (recorder && !held_rewind) // ticks already recorded are skipped
             {
-                MoveRect(&player, player.x, player.y+player.w);
-                pressed_right = false;
+                int count = WorldGetParticles(world, particles, rows * cols);
+                RecorderAdd(recorder, WorldTick(world), particles, count);
             }
         }
 
-        // --------------------------
-        // | Pixel Draw and Physics |
-        // --------------------------
-
-        // Erase old artwork
-        FillRect(entire_screen, EMPTY_SPACE, projectile_buffer_next);
-
-        // Draw projectiles for next frame
-        DrawProjectile(projectile_buffer, projectile_buffer_next, momentum, momentum_next);
-
-        // Load next position frame
-        u32 *tmp_pix = projectile_buffer;
-        projectile_buffer = projectile_buffer_next;
-        projectile_buffer_next = tmp_pix;
-        // Load next momentum frame
-        momentum_t *tmp_mom = momentum;
-        momentum = momentum_next;
-        momentum_next = tmp_mom;
-
         // ------------------------
         // | Render to the screen |
         // ------------------------
 
-        if (frame_num++%FRAMES_PER_PHYSICS == 0)
+        if (now - last_frame >= frame_period)
         {
-            frame_num = 1;
-            // -------------
-            // | Rect Draw |
-            // -------------
-            // Draw player
-            FillRect(player, player_color, player_buffer);
-
-            SDL_UpdateTexture(
-                    player_texture,     // SDL_Texture *
-                    NULL,               // const SDL_Rect * - NULL updates entire texture
-                    player_buffer, // const void *pixels
-                    SCREEN_WIDTH * sizeof(u32) // int pitch - n bytes in a row of pixel data
-                    );
-            SDL_UpdateTexture(
-                    projectile_texture, // SDL_Texture *
-                    NULL,               // const SDL_Rect * - NULL updates entire texture
-                    projectile_buffer,  // const void *pixels
-                    SCREEN_WIDTH * sizeof(u32) // int pitch - n bytes in a row of pixel data
-                    );
+            last_frame = now;
+            // Part of the next tick gone by: draw that far from the last tick
+            // to this one. Scrubbing back has no "next", so draw the tick.
+            float alpha = held_rewind ? 1 : (float)(now - last_tick) / tick_period;
+            WorldRenderInterpolated(world, alpha, PIXEL_SCALE, projectile_indexes);
+
+            // The player texture only changes when the player moves
+            int row, col;
+            WorldPlayer(world, &row, &col);
+            bool player_moved = (row != player_row) || (col != player_col);
+            player_row = row;
+            player_col = col;
+            if (player_moved) WorldRenderIndexed(world, NULL, player_indexes);
+
+            void *texture_pixels;
+            int pitch; // n bytes in a row of texture pixels
+            if (player_moved && (SDL_LockTexture(player_texture, NULL, &texture_pixels, &pitch) == 0))
+            {
+                PaletteExpand(palette, player_indexes, rows, cols, texture_pixels, pitch);
+                SDL_UnlockTexture(player_texture);
+            }
+            if (SDL_LockTexture(projectile_texture, NULL, &texture_pixels, &pitch) == 0)
+            {
+                PaletteExpand(palette, projectile_indexes, PIXEL_SCALE*rows, PIXEL_SCALE*cols,
+                        texture_pixels, pitch);
+                if (bloom) BloomApply(bloom, texture_pixels, pitch);
+                SDL_UnlockTexture(projectile_texture);
+            }
 
             SDL_RenderClear(renderer);
             SDL_RenderCopy(
@@ -483,12 +335,22 @@ int main(int argc, char **argv)
                     );
             SDL_RenderPresent(renderer);
         }
-        SDL_Delay(PHYSICS_DELAY);
+        SDL_Delay(1);
 
     }
     // ---Cleanup---
 
+    if (hash_log) SDL_RWclose(hash_log);
+    if (recorder) RecorderClose(recorder);
+    free(particles);
+    BloomDestroy(bloom);
+    WorldDestroy(world);
+
+    free(player_indexes);
+    free(projectile_indexes);
     SDL_DestroyTexture(player_texture);
+    SDL_DestroyTexture(projectile_texture);
+    SDL_FreeFormat(format);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
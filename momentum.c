@@ -0,0 +1,8113 @@
+// TODO: figure out how to let particles "pass" each other unaffected. In other
+// words, if certain particles do not interact, but they happen to land at the
+// same pixel location, how do I not lose one of them?
+//
+#include <assert.h>
+#include <SDL.h>
+#include "momentum.h"
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+typedef uint32_t u32;
+typedef uint8_t bool;
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint64_t u64;
+/* typedef int16_t i16; */
+
+// SIMD vectors (GCC vector extensions)
+typedef u8  u8x16 __attribute__((vector_size(16)));
+typedef u16 u16x16 __attribute__((vector_size(32)));
+typedef float f32x4 __attribute__((vector_size(16)));
+typedef int32_t i32x4 __attribute__((vector_size(16)));
+typedef u64 u64x4 __attribute__((vector_size(32)));
+typedef u32 u32x8 __attribute__((vector_size(32)));
+typedef float f32x8 __attribute__((vector_size(32)));
+typedef int32_t i32x8 __attribute__((vector_size(32)));
+
+/**
+ *  \brief Square root of four floats at once
+ */
+static inline f32x4 SqrtF32x4(f32x4 v)
+{
+#ifdef __SSE__
+    return (f32x4) _mm_sqrt_ps((__m128) v);
+#else
+    for (int i=0; i < 4; i++) v[i] = SDL_sqrtf(v[i]);
+    return v;
+#endif
+}
+
+/**
+ *  \brief Lane by lane minimum of four floats
+ */
+static inline f32x4 MinF32x4(f32x4 a, f32x4 b)
+{
+#ifdef __SSE__
+    return (f32x4) _mm_min_ps((__m128) a, (__m128) b);
+#else
+    for (int i=0; i < 4; i++) a[i] = SDL_min(a[i], b[i]);
+    return a;
+#endif
+}
+
+/**
+ *  \brief Lane by lane maximum of four floats
+ */
+static inline f32x4 MaxF32x4(f32x4 a, f32x4 b)
+{
+#ifdef __SSE__
+    return (f32x4) _mm_max_ps((__m128) a, (__m128) b);
+#else
+    for (int i=0; i < 4; i++) a[i] = SDL_max(a[i], b[i]);
+    return a;
+#endif
+}
+
+#define true 1
+#define false 0
+
+#define internal static // static functions are "internal"
+
+#define SCREEN_WIDTH 100
+#define SCREEN_HEIGHT 100
+
+// The world is cut into square tiles for paging and for skipping empty space
+#define TILE_SIZE 32 // pixels per tile side
+#define SCREEN_TILE_ROWS ((SCREEN_HEIGHT + TILE_SIZE-1)/TILE_SIZE)
+#define SCREEN_TILE_COLS ((SCREEN_WIDTH + TILE_SIZE-1)/TILE_SIZE)
+
+// Identify empty space
+#define EMPTY_SPACE 0x00000000
+// Return value for pixels outside the screen area
+#define OUT_OF_BOUNDS 0x00000001
+
+// Create projectiles as pixel particles
+#define PROJECTILE_COLOR 0xFFFF0000 // opaque red
+// Play with these numbers to tune the "feel"
+// Go faster by making BLAST and GRAVITY larger (or see PHYSICS_DELAY in main.c).
+#define GRAVITY 0.01 // tie this to FRAMES_PER_PHYSICS?
+#define BLAST  -1.2   // tie this to FRAMES_PER_PHYSICS?
+#define PLAYER_COLOR 0x8000FF00 // transparent green
+
+typedef struct
+{
+    int x; // row of topleft corner
+    int y; // col of topleft corner
+    int w; // width
+    int h; // height
+} rect_t;
+
+/**
+ *  \brief Move rectangle topleft to x,y
+ *
+ *  \param rect Pointer to the rectangle to move
+ *  \param x    Destination row
+ *  \param y    Destination column
+ *
+ *  Example: to move player UP one pixel:
+ *      MoveRect(&player, player.x++, player.y)
+ */
+internal void MoveRect(rect_t *rect, int x, int y)
+{
+    // TODO: clamp to allowed positions
+    rect->x = x;
+    rect->y = y;
+}
+
+internal void FillRect(rect_t rect, u32 pixel_color, u32 *buffer)
+{
+    assert(buffer);
+    for (int row=0; row < rect.h; row++)
+    {
+        for (int col=0; col < rect.w; col++)
+        {
+            buffer[ (rect.x + row)*SCREEN_WIDTH + (rect.y + col) ] = pixel_color;
+        }
+    }
+}
+
+/**
+ *  \brief Set pixel color in PREV buffer.
+ *
+ *  \param x    Screen row number (0 is top)
+ *  \param y    Screen col number (0 is left)
+ *  \param color    Color to set at this pixel
+ *  \param screen_pixels    Pointer to the screen buffer to write to
+ */
+inline internal void ColorSetUnsafe(int x, int y, u32 color, u32 *screen_pixels)
+{
+    screen_pixels[x*SCREEN_WIDTH+y] = color;
+}
+
+/**
+ *  \brief Get pixel color
+ *
+ *  \param x    Screen row number (0 is top)
+ *  \param y    Screen col number (0 is left)
+ *  \param screen_pixels    Pointer to the screen buffer
+ *
+ *  \return color   ARGB as unsigned 32-bit, or 1 if (x,y) is outside screen
+ */
+inline internal u32 ColorAt(int x, int y, u32 *screen_pixels)
+{
+    if ((x >= 0) && (y >= 0) && (x < SCREEN_HEIGHT) && (y < SCREEN_WIDTH))
+    {
+        return screen_pixels[x*SCREEN_WIDTH+y];
+    }
+    else // Pixel is outside screen area
+    {
+        // Any value that is NOT "EMPTY_SPACE" acts as a boundary
+        assert(EMPTY_SPACE != OUT_OF_BOUNDS);
+        return OUT_OF_BOUNDS;
+    }
+}
+
+/**
+ *  \brief Get particle momentum
+ *
+ *  \param x    Screen row number (0 is top)
+ *  \param y    Screen col number (0 is left)
+ *  \param momentum Pointer to the momentum buffer
+ *
+ *  \return momentum_t {float x, float y, float dx, float dy}
+ */
+inline internal momentum_t MomentumAt(int x, int y, momentum_t *momentum)
+{
+    if ((x >= 0) && (y >= 0) && (x < SCREEN_HEIGHT) && (y < SCREEN_WIDTH))
+    {
+        return momentum[x*SCREEN_WIDTH+y];
+    }
+    else // Pixel is outside screen area
+    {
+        // Gotta return something. How about -1,-1,0,0?
+        momentum_t out_of_bounds_momentum = {-1,-1,0,0};
+        return out_of_bounds_momentum;
+    }
+}
+
+/**
+ *  \brief Set momentum in PREV buffer.
+ *
+ *  \param x    Screen row number (0 is top)
+ *  \param y    Screen col number (0 is left)
+ *  \param momentum Momentum to set at this pixel
+ *  \param momentum_buffer Pointer to the momentum buffer to write to
+ */
+inline internal void MomentumSetUnsafe(int x, int y, momentum_t momentum, momentum_t *momentum_buffer)
+{
+    momentum_buffer[x*SCREEN_WIDTH+y] = momentum;
+}
+
+/**
+ *  \brief Start a new projectile
+ *
+ *  \param projectile_buffer   Pointer to the position buffer `projectile_buffer`
+ *  \param momentum_buffer Pointer to the projectile momentum buffer `momentum`
+ */
+internal void InitProjectile(u32 *projectile_buffer, momentum_t *momentum_buffer)
+{
+    int x = SCREEN_HEIGHT-1;
+    int y = SCREEN_WIDTH/2;
+    momentum_t momentum = {(float)x,(float)y,BLAST,0};
+
+    if (ColorAt(x,y,projectile_buffer) == EMPTY_SPACE)
+    {
+        ColorSetUnsafe(x, y, PROJECTILE_COLOR, projectile_buffer);
+        MomentumSetUnsafe(x, y, momentum, momentum_buffer);
+    }
+}
+
+/**
+ *  \brief Update projectiles
+ *
+ *  Read the projectile locations from PREV frame and write the new locations to
+ *  the NEXT frame.
+ *
+ *  \param frame        Pointer to the `projectile_buffer`
+ *                      Projectile POSITIONS for PREV frame
+ *  \param frame_next   Pointer to the `projectile_buffer_next`
+ *                      Projectile POSITIONS for NEXT frame
+ *  \param momentum_prev Pointer to `momentum`
+ *                      Projectile MOMENTUM for PREV frame
+ *  \param momentum_next Pointer to `momentum_next`
+ *                      Projectile MOMENTUM for NEXT frame
+ */
+internal void DrawProjectile( // u32 *frame, u32 *frame_next
+        u32 *frame, u32 *frame_next,
+        momentum_t *momentum_prev, momentum_t *momentum_next
+        )
+{
+    for (int row=0; row < SCREEN_HEIGHT; row++)
+        for (int col=0; col < SCREEN_WIDTH; col++)
+        {
+            momentum_t momentum = MomentumAt(row, col, momentum_prev);
+            // Decelerate
+            momentum.dx += GRAVITY;
+            // Record new position in floating point
+            momentum.x += momentum.dx;
+            // Inspect color of this pixel and future location of this pixel
+            u32 color = ColorAt(row, col, frame);
+            // NOTE: Don't use roundf().
+            // roundf() is defined in math.h. Including it REALLY slows compilation.
+            // A simple integer truncate seems to work just as well as rounding.
+            /* u32 row_predict = roundf(momentum.x); */
+            u32 row_predict = (int)(momentum.x);
+            u32 color_predict = ColorAt(row_predict, col, frame);
+            switch (color)
+            {
+                case PROJECTILE_COLOR:
+                        // TEMP: stop at top of screen
+                        if (color_predict == OUT_OF_BOUNDS)
+                        {
+                            // Erase the projectile
+                            ColorSetUnsafe(row, col, EMPTY_SPACE, frame_next);
+                            momentum_t momentum_new = {0,0,0,0};
+                            MomentumSetUnsafe(row, col, momentum_new, momentum_next);
+                        }
+                        // Keep moving: not at top of screen yet
+                        else
+                        {
+                            // Show projectile at future pixel location
+                            ColorSetUnsafe(row_predict, col, PROJECTILE_COLOR, frame_next);
+                            // Record "actual" floating-point position at this
+                            // future pixel location
+                            MomentumSetUnsafe(row_predict, col, momentum, momentum_next);
+                        }
+                    break;
+            }
+        }
+}
+
+
+// -------------------
+// | Level of Detail |
+// -------------------
+
+// Projectiles near the focus (the player) update every tick. Everywhere else
+// waits, and every LOD_TICKS ticks jumps all the ticks it is owed at once.
+// Projectiles only move along their column, so the focus is a strip of whole
+// columns: nothing flies into it or out of it, and the two regions only meet
+// when the focus moves.
+#define LOD_TICKS 4 // coarse region updates this often
+#define LOD_FOCUS_RADIUS 20 // columns either side of the player at full detail
+
+typedef struct
+{
+    rect_t focus; // full-detail region used last tick, empty to resync
+    u32 tick;     // coarse ticks fall on every LOD_TICKS-th
+    int owed;     // ticks the coarse region is behind the focus
+} lod_t;
+
+inline internal bool InRect(int x, int y, rect_t rect)
+{
+    return (x >= rect.x) && (y >= rect.y) && (x < rect.x + rect.h) && (y < rect.y + rect.w);
+}
+
+/**
+ *  \brief Full-detail region: the player's columns, widened by LOD_FOCUS_RADIUS
+ */
+internal rect_t LODFocus(rect_t player)
+{
+    int left  = SDL_max(player.y - LOD_FOCUS_RADIUS, 0);
+    int right = SDL_min(player.y + player.w + LOD_FOCUS_RADIUS, SCREEN_WIDTH);
+    rect_t focus = {0, left, right-left, SCREEN_HEIGHT};
+    return focus;
+}
+
+/**
+ *  \brief Move one projectile ahead `ticks` ticks
+ *
+ *  Same physics as DrawProjectile(). Gravity is constant, so `ticks` updates
+ *  of "dx += GRAVITY; x += dx" collapse to a closed form. It is evaluated in
+ *  double where full detail accumulates in float, so the coarse region lands
+ *  where full detail would have put it up to float rounding, and now and then
+ *  a row off. The jump also skips the ticks between: a projectile that would
+ *  have left the screen and come back, or landed on another, does neither.
+ *
+ *  \return row the projectile lands on, or -1 if it left the screen
+ */
+inline internal int StepProjectile(int row, int col, int ticks,
+        u32 *frame, momentum_t *momentum_prev, momentum_t *momentum_out)
+{
+    momentum_t momentum = MomentumAt(row, col, momentum_prev);
+    if (ticks == 1)
+    {
+        momentum.dx += GRAVITY;
+        momentum.x += momentum.dx;
+    }
+    else
+    {
+        momentum.x += ticks*momentum.dx + GRAVITY*ticks*(ticks+1)/2;
+        momentum.dx += ticks*GRAVITY;
+    }
+    *momentum_out = momentum;
+    u32 row_predict = (int)(momentum.x);
+    if (ColorAt(row_predict, col, frame) == OUT_OF_BOUNDS) return -1;
+    return row_predict;
+}
+
+/**
+ *  \brief Bring the coarse region up to the focus's tick, in both buffers
+ *
+ *  Call before writing projectiles into `frame` (or reading all of them as of
+ *  one tick). The next DrawProjectileLOD() then resyncs, without losing its
+ *  place between coarse ticks.
+ */
+internal void LODSettle(
+        u32 *frame, u32 *frame_next,
+        momentum_t *momentum_prev, momentum_t *momentum_next,
+        lod_t *lod
+        )
+{
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    rect_t nowhere = {0,0,0,0};
+    if (lod->owed > 0)
+    {
+        FillRect(entire_screen, EMPTY_SPACE, frame_next);
+        for (int row=0; row < SCREEN_HEIGHT; row++)
+        {
+            for (int col=0; col < SCREEN_WIDTH; col++)
+            {
+                if (ColorAt(row, col, frame) != PROJECTILE_COLOR) continue;
+                momentum_t momentum = MomentumAt(row, col, momentum_prev);
+                int row_predict = row;
+                if (!InRect(row, col, lod->focus))
+                {
+                    row_predict = StepProjectile(row, col, lod->owed, frame, momentum_prev, &momentum);
+                    if (row_predict < 0) continue;
+                }
+                ColorSetUnsafe(row_predict, col, PROJECTILE_COLOR, frame_next);
+                MomentumSetUnsafe(row_predict, col, momentum, momentum_next);
+            }
+        }
+        memcpy(frame, frame_next, SCREEN_WIDTH*SCREEN_HEIGHT * sizeof(u32));
+        memcpy(momentum_prev, momentum_next, SCREEN_WIDTH*SCREEN_HEIGHT * sizeof(momentum_t));
+        lod->owed = 0;
+    }
+    lod->focus = nowhere;
+}
+
+/**
+ *  \brief Update projectiles at full detail near the focus, coarse elsewhere
+ *
+ *  Like DrawProjectile(), but also clears `frame_next` itself.
+ *
+ *  The coarse region is only written on coarse ticks, and then it is copied
+ *  back into `frame` too, so after the caller swaps buffers both buffers hold
+ *  the same coarse state and the in-between ticks can leave it alone. A coarse
+ *  tick jumps the coarse region by every tick it is owed, so afterwards both
+ *  regions are at the same tick and hand-offs need no bookkeeping.
+ *
+ *  The focus only takes effect on a coarse tick: when it moves, this tick
+ *  becomes one early, still with the old focus at full detail. Zeroing `lod`
+ *  (or LODSettle()) resyncs the same way with nothing at full detail.
+ *
+ *  \param lod      Level-of-detail state, zero it to start, or LODSettle() it
+ *                  before writing projectiles into `frame`
+ *  \param focus    Region to update at full detail, whole columns
+ */
+internal void DrawProjectileLOD(
+        u32 *frame, u32 *frame_next,
+        momentum_t *momentum_prev, momentum_t *momentum_next,
+        lod_t *lod, rect_t focus
+        )
+{
+    assert((focus.x == 0) && (focus.h == SCREEN_HEIGHT));
+    rect_t detail = lod->focus;
+    bool moved = (focus.y != detail.y) || (focus.w != detail.w) || (focus.h != detail.h);
+    bool coarse_tick = moved || (lod->tick % LOD_TICKS == LOD_TICKS-1);
+    int coarse_ticks = lod->owed + 1;
+    lod->tick++;
+    lod->owed = coarse_tick ? 0 : lod->owed + 1;
+    lod->focus = focus;
+
+    // Erase old artwork
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    FillRect(coarse_tick ? entire_screen : detail, EMPTY_SPACE, frame_next);
+
+    // In-between ticks only visit the focus
+    rect_t visit = coarse_tick ? entire_screen : detail;
+    for (int row=visit.x; row < visit.x + visit.h; row++)
+    {
+        for (int col=visit.y; col < visit.y + visit.w; col++)
+        {
+            if (ColorAt(row, col, frame) != PROJECTILE_COLOR) continue;
+
+            int ticks = InRect(row, col, detail) ? 1 : coarse_ticks;
+            momentum_t momentum;
+            int row_predict = StepProjectile(row, col, ticks, frame, momentum_prev, &momentum);
+            if (row_predict < 0) // Erase the projectile
+            {
+                if (ticks == 1)
+                {
+                    // Like DrawProjectile(), the erase clears the old cell in
+                    // frame_next, even if a projectile already moved into it
+                    momentum_t momentum_new = {0,0,0,0};
+                    ColorSetUnsafe(row, col, EMPTY_SPACE, frame_next);
+                    MomentumSetUnsafe(row, col, momentum_new, momentum_next);
+                }
+                continue;
+            }
+
+            ColorSetUnsafe(row_predict, col, PROJECTILE_COLOR, frame_next);
+            MomentumSetUnsafe(row_predict, col, momentum, momentum_next);
+        }
+    }
+
+    if (coarse_tick) // Copy back so both buffers agree outside the focus
+    {
+        memcpy(frame, frame_next, SCREEN_WIDTH*SCREEN_HEIGHT * sizeof(u32));
+        memcpy(momentum_prev, momentum_next, SCREEN_WIDTH*SCREEN_HEIGHT * sizeof(momentum_t));
+    }
+}
+
+// ----------
+// | Trails |
+// ----------
+
+// Projectiles leave a trail that fades out. Every frame, each 8-bit channel of
+// the trail is scaled by TRAIL_DECAY/256, sixteen channels at a time. Tiles
+// that have faded to nothing are skipped.
+#define TRAIL_DECAY 235 // out of 256 -- bigger is a longer trail
+
+typedef struct
+{
+    u32 *pixels; // ARGB, same layout as `projectile_buffer`
+    bool live[SCREEN_TILE_ROWS*SCREEN_TILE_COLS]; // tile has non-zero pixels
+} trail_t;
+
+/**
+ *  \brief Scale sixteen 8-bit channels by TRAIL_DECAY/256
+ */
+inline internal u8x16 DecayChannels(u8x16 channels)
+{
+    u16x16 wide = __builtin_convertvector(channels, u16x16);
+    wide = (wide * TRAIL_DECAY) >> 8;
+    return __builtin_convertvector(wide, u8x16);
+}
+
+/**
+ *  \brief Fade the trail, only touching tiles that still have something in them
+ */
+internal void DecayTrail(trail_t *trail)
+{
+    for (int tile_row=0; tile_row < SCREEN_TILE_ROWS; tile_row++)
+        for (int tile_col=0; tile_col < SCREEN_TILE_COLS; tile_col++)
+        {
+            bool *live = &trail->live[tile_row*SCREEN_TILE_COLS + tile_col];
+            if (!*live) continue;
+
+            int row_end = SDL_min((tile_row+1)*TILE_SIZE, SCREEN_HEIGHT);
+            int col = tile_col*TILE_SIZE;
+            int num_bytes = SDL_min(TILE_SIZE, SCREEN_WIDTH - col) * sizeof(u32);
+            u8x16 any = {0};
+            u8 any_tail = 0;
+            for (int row=tile_row*TILE_SIZE; row < row_end; row++)
+            {
+                u8 *bytes = (u8*) &trail->pixels[row*SCREEN_WIDTH + col];
+                int i = 0;
+                for (; i+16 <= num_bytes; i += 16)
+                {
+                    u8x16 channels;
+                    memcpy(&channels, bytes+i, 16); // rows are not 16-byte aligned
+                    channels = DecayChannels(channels);
+                    memcpy(bytes+i, &channels, 16);
+                    any |= channels;
+                }
+                for (; i < num_bytes; i++)
+                {
+                    bytes[i] = (u8)((bytes[i] * TRAIL_DECAY) >> 8);
+                    any_tail |= bytes[i];
+                }
+            }
+            u64 any_lanes[2];
+            memcpy(any_lanes, &any, 16);
+            *live = (any_lanes[0] | any_lanes[1] | any_tail) != 0;
+        }
+}
+
+/**
+ *  \brief Draw every projectile into the trail at full strength
+ */
+internal void StampTrail(u32 *frame, trail_t *trail)
+{
+    for (int row=0; row < SCREEN_HEIGHT; row++)
+        for (int col=0; col < SCREEN_WIDTH; col++)
+        {
+            if (ColorAt(row, col, frame) != PROJECTILE_COLOR) continue;
+            ColorSetUnsafe(row, col, PROJECTILE_COLOR, trail->pixels);
+            trail->live[(row/TILE_SIZE)*SCREEN_TILE_COLS + col/TILE_SIZE] = true;
+        }
+}
+
+// ---------------
+// | Thread Pool |
+// ---------------
+
+// Split a loop across every core. Work is handed out in chunks, so cores that
+// finish early take more. Jobs also get the index of the thread running them,
+// for writing into per-thread buffers without locks.
+#define MAX_THREADS 64
+
+typedef void (*job_t)(void *data, int begin, int end, int thread);
+
+typedef struct thread_pool_t thread_pool_t;
+
+typedef struct
+{
+    thread_pool_t *pool;
+    int index;
+} worker_t;
+
+struct thread_pool_t
+{
+    int num_threads; // workers plus the thread calling ParallelFor()
+    SDL_Thread *threads[MAX_THREADS];
+    worker_t workers[MAX_THREADS];
+    SDL_sem *work;   // posted once per worker to start a job
+    SDL_sem *done;   // posted once per worker when the job is finished
+    bool quit;
+
+    // ---Current job---
+    job_t job;
+    void *data;
+    int count;
+    int chunk;
+    SDL_atomic_t next; // start of the next chunk nobody has taken yet
+};
+
+/**
+ *  \brief Take chunks of the current job until there are none left
+ */
+internal void RunChunks(thread_pool_t *pool, int thread)
+{
+    for (;;)
+    {
+        int begin = SDL_AtomicAdd(&pool->next, pool->chunk);
+        if (begin >= pool->count) return;
+        int end = SDL_min(begin + pool->chunk, pool->count);
+        pool->job(pool->data, begin, end, thread);
+    }
+}
+
+internal int WorkerThread(void *data)
+{
+    worker_t *worker = (worker_t*) data;
+    thread_pool_t *pool = worker->pool;
+    for (;;)
+    {
+        SDL_SemWait(pool->work);
+        if (pool->quit) return 0;
+        RunChunks(pool, worker->index);
+        SDL_SemPost(pool->done);
+    }
+}
+
+/**
+ *  \brief Threads a pool started with `num_threads` has, counting the caller
+ */
+internal int ThreadPoolSize(int num_threads)
+{
+    if (num_threads <= 0) num_threads = SDL_GetCPUCount();
+    return SDL_max(1, SDL_min(num_threads, MAX_THREADS));
+}
+
+/**
+ *  \brief Start the worker threads
+ *
+ *  \param num_threads  Threads to use, counting the caller, 0 for one per core
+ */
+internal void ThreadPoolInit(thread_pool_t *pool, int num_threads)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->num_threads = ThreadPoolSize(num_threads);
+    pool->work = SDL_CreateSemaphore(0);
+    pool->done = SDL_CreateSemaphore(0);
+    for (int i=1; i < pool->num_threads; i++)
+    {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        pool->threads[i] = SDL_CreateThread(WorkerThread, "worker", &pool->workers[i]);
+        assert(pool->threads[i]);
+    }
+}
+
+internal void ThreadPoolFree(thread_pool_t *pool)
+{
+    pool->quit = true;
+    for (int i=1; i < pool->num_threads; i++) SDL_SemPost(pool->work);
+    for (int i=1; i < pool->num_threads; i++) SDL_WaitThread(pool->threads[i], NULL);
+    SDL_DestroySemaphore(pool->work);
+    SDL_DestroySemaphore(pool->done);
+}
+
+/**
+ *  \brief Run job(data, begin, end, thread) over [0, count) on every thread
+ *
+ *  \param chunk    Items per call, big enough to amortize the handoff
+ *
+ *  Returns when every item is done. The caller works too, as thread 0.
+ */
+internal void ParallelFor(thread_pool_t *pool, int count, int chunk, job_t job, void *data)
+{
+    if (count <= 0) return;
+    pool->job = job;
+    pool->data = data;
+    pool->count = count;
+    pool->chunk = SDL_max(chunk, 1);
+    SDL_AtomicSet(&pool->next, 0);
+    int helpers = SDL_min(pool->num_threads-1, (count-1)/pool->chunk);
+    for (int i=0; i < helpers; i++) SDL_SemPost(pool->work);
+    RunChunks(pool, 0);
+    for (int i=0; i < helpers; i++) SDL_SemWait(pool->done);
+}
+
+// ---------
+// | Arena |
+// ---------
+
+// One allocation carved into pieces, all released together. Every piece
+// starts on an ARENA_ALIGN boundary (a cache line, and as wide as any vector
+// here), and is followed by at least ARENA_ALIGN bytes of slack, so a vector
+// load that runs past the end of a buffer stays inside the allocation.
+//
+// An arena with no memory only counts: push the same pieces through one to
+// size the real thing. Subsystems take theirs in Init() and have no Free(); the
+// owner frees the arena, and everything carved from it, at once.
+#define ARENA_ALIGN 64
+
+// Allocations for a world go through CountedCalloc(), so --allocs can check
+// how many creating and running one takes
+static SDL_atomic_t allocations;
+
+internal void *CountedCalloc(size_t count, size_t size)
+{
+    SDL_AtomicAdd(&allocations, 1);
+    return calloc(count, size);
+}
+
+typedef struct
+{
+    void *memory; // what to free
+    u8 *base;     // first aligned byte, NULL while counting
+    size_t size, used;
+} arena_t;
+
+inline internal size_t ArenaRound(size_t bytes)
+{
+    return (bytes + ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1);
+}
+
+/**
+ *  \brief Allocate `bytes` of zeroed, aligned memory to carve up
+ */
+internal void ArenaInit(arena_t *arena, size_t bytes)
+{
+    arena->memory = CountedCalloc(bytes + ARENA_ALIGN, 1);
+    assert(arena->memory);
+    arena->base = (u8*) ArenaRound((size_t)arena->memory);
+    arena->size = bytes;
+    arena->used = 0;
+}
+
+/**
+ *  \brief Next zeroed piece of `bytes`, or NULL when only counting
+ */
+internal void *ArenaPush(arena_t *arena, size_t bytes)
+{
+    size_t at = arena->used;
+    arena->used += ArenaRound(bytes) + ARENA_ALIGN;
+    if (!arena->base) return NULL;
+    assert(arena->used <= arena->size);
+    return arena->base + at;
+}
+
+internal void ArenaFree(arena_t *arena)
+{
+    free(arena->memory);
+    memset(arena, 0, sizeof(*arena));
+}
+
+// Run an Init() taking `arena` twice: once to size it, then for real
+#define ARENA_SIZED(arena, init) \
+    do { init; ArenaInit(arena, (arena)->used); init; } while (0)
+
+// ------------------
+// | Random Numbers |
+// ------------------
+
+// Counter-based random numbers (Philox4x32-10): a number is a pure function
+// of (seed, tick, id, draw), with no generator state to share or split. Any
+// thread, in any order, at any vector width, gets the same value for the
+// same particle or cell on the same tick. RngU32x8() makes eight at once,
+// for ids id..id+7, and matches RngU32() lane for lane.
+//
+// Counter words: id, tick, draw/4, 0. Key: the seed. Each block gives four
+// numbers, so draws 0-3 of an id share one block.
+#define PHILOX_M0 0xD2511F53
+#define PHILOX_M1 0xCD9E8D57
+#define PHILOX_W0 0x9E3779B9 // key schedule: golden ratio
+#define PHILOX_W1 0xBB67AE85 // key schedule: sqrt(3) - 1
+
+/**
+ *  \brief Philox4x32-10 block: ten rounds of multiply and xor
+ */
+internal void Philox(u32 counter[4], u32 k0, u32 k1)
+{
+    for (int round=0; round < 10; round++)
+    {
+        u64 p0 = (u64)PHILOX_M0 * counter[0];
+        u64 p1 = (u64)PHILOX_M1 * counter[2];
+        u32 c1 = counter[1], c3 = counter[3];
+        counter[0] = (u32)(p1 >> 32) ^ c1 ^ k0;
+        counter[1] = (u32)p1;
+        counter[2] = (u32)(p0 >> 32) ^ c3 ^ k1;
+        counter[3] = (u32)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+/**
+ *  \brief Random u32 for (seed, tick, id), the `draw`th one for that id
+ */
+internal u32 RngU32(u64 seed, u32 tick, u32 id, u32 draw)
+{
+    u32 counter[4] = {id, tick, draw >> 2, 0};
+    Philox(counter, (u32)seed, (u32)(seed >> 32));
+    return counter[draw & 3];
+}
+
+/**
+ *  \brief Full 32x32 -> 64-bit products of eight lanes with m, split into halves
+ *
+ *  Works on the lanes as four u64 pairs, even lane low, odd lane high. With
+ *  SSE2 or AVX2 each multiply is a pmuludq; GCC would otherwise expand a multiply by
+ *  a constant into a long chain of 64-bit shifts and adds.
+ */
+#if defined(__AVX2__)
+#define PHILOX_MUL_PAIRS(even, odd, pairs, m) do { \
+    __m256i m256 = _mm256_set1_epi32(m); \
+    (even) = (u64x4) _mm256_mul_epu32((__m256i)(pairs), m256); \
+    (odd) = (u64x4) _mm256_mul_epu32((__m256i)((pairs) >> 32), m256); \
+} while (0)
+#elif defined(__SSE2__)
+#define PHILOX_MUL_PAIRS(even, odd, pairs, m) do { \
+    __m128i halves[2], products[2], m128 = _mm_set1_epi32(m); \
+    memcpy(halves, &(pairs), sizeof(halves)); \
+    products[0] = _mm_mul_epu32(halves[0], m128); \
+    products[1] = _mm_mul_epu32(halves[1], m128); \
+    memcpy(&(even), products, sizeof(products)); \
+    products[0] = _mm_mul_epu32(_mm_srli_epi64(halves[0], 32), m128); \
+    products[1] = _mm_mul_epu32(_mm_srli_epi64(halves[1], 32), m128); \
+    memcpy(&(odd), products, sizeof(products)); \
+} while (0)
+#else
+#define PHILOX_MUL_PAIRS(even, odd, pairs, m) do { \
+    (even) = ((pairs) & 0xFFFFFFFF) * (u64)(m); \
+    (odd) = ((pairs) >> 32) * (u64)(m); \
+} while (0)
+#endif
+#define PHILOX_MUL8(a, m, hi, lo) do { \
+    const u64x4 low32 = {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF}; \
+    u64x4 pairs = (u64x4)(a), even, odd; \
+    PHILOX_MUL_PAIRS(even, odd, pairs, m); \
+    (lo) = (u32x8)((even & low32) | (odd << 32)); \
+    (hi) = (u32x8)((even >> 32) | (odd & ~low32)); \
+} while (0)
+
+/**
+ *  \brief Eight random u32s, for ids id..id+7; lane i is RngU32(seed, tick, id+i, draw)
+ */
+internal void RngU32x8(u64 seed, u32 tick, u32 id, u32 draw, u32 out[8])
+{
+    const u32x8 lanes = {0, 1, 2, 3, 4, 5, 6, 7};
+    u32x8 c0 = id + lanes;
+    u32x8 c1 = lanes*0 + tick;
+    u32x8 c2 = lanes*0 + (draw >> 2);
+    u32x8 c3 = lanes*0;
+    u32 k0 = (u32)seed, k1 = (u32)(seed >> 32);
+    for (int round=0; round < 10; round++)
+    {
+        u32x8 hi0, lo0, hi1, lo1;
+        PHILOX_MUL8(c0, PHILOX_M0, hi0, lo0);
+        PHILOX_MUL8(c2, PHILOX_M1, hi1, lo1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    u32x8 result = ((draw & 3) == 0) ? c0 : ((draw & 3) == 1) ? c1 : ((draw & 3) == 2) ? c2 : c3;
+    memcpy(out, &result, sizeof(result));
+}
+
+/**
+ *  \brief Top 24 bits of a random u32 as a float in [0, 1)
+ */
+inline internal float RngUnit(u32 bits)
+{
+    return (bits >> 8) * (1.0f/(1 << 24));
+}
+
+/**
+ *  \brief `count` projectiles anywhere on the screen, for the headless tools
+ *
+ *  Each moves up or down at under `speed`/2 rows a tick, none sideways.
+ */
+internal void ScatterParticles(u64 seed, int count, float speed, momentum_t *out)
+{
+    for (int i=0; i < count; i++)
+    {
+        momentum_t particle = {
+            RngUnit(RngU32(seed, 0, i, 0)) * SCREEN_HEIGHT,
+            RngUnit(RngU32(seed, 0, i, 1)) * SCREEN_WIDTH,
+            (RngUnit(RngU32(seed, 0, i, 2)) - 0.5f) * speed, 0};
+        out[i] = particle;
+    }
+}
+
+typedef struct
+{
+    u32 *out;
+    u32 tick;
+} rng_job_t;
+
+internal void RngFillJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    rng_job_t *job = (rng_job_t*) data;
+    int i = begin;
+    for (; i + 8 <= end; i += 8) RngU32x8(1, job->tick, i, 0, &job->out[i]);
+    for (; i < end; i++) job->out[i] = RngU32(1, job->tick, i, 0);
+}
+
+/**
+ *  \brief Headless check and benchmark: scalar vs 8-wide vs threaded streams
+ *
+ *  momentum.exe --rng [count]
+ */
+internal int RngBenchmark(int argc, char **argv)
+{
+    int count = (argc > 0) ? atoi(argv[0]) : 10000000;
+
+    // Known answer for Philox4x32-10, zero key and counter
+    u32 kat[4] = {0, 0, 0, 0};
+    Philox(kat, 0, 0);
+    bool kat_ok = (kat[0] == 0x6627E8D5) && (kat[1] == 0xE169C58D)
+               && (kat[2] == 0xBC57AC4C) && (kat[3] == 0x9B00DBD8);
+
+    thread_pool_t pool;
+    ThreadPoolInit(&pool, 0);
+    u32 *scalar = (u32*) calloc(count, sizeof(u32));
+    u32 *wide = (u32*) calloc(count, sizeof(u32));
+    assert(scalar && wide);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i=0; i < count; i++) scalar[i] = RngU32(1, 7, i, 0);
+    Uint64 middle = SDL_GetPerformanceCounter();
+    rng_job_t job = {wide, 7};
+    ParallelFor(&pool, count, 1000, RngFillJob, &job); // odd chunk: ragged lanes
+    Uint64 end = SDL_GetPerformanceCounter();
+    double frequency = (double)SDL_GetPerformanceFrequency();
+
+    int mismatches = 0;
+    for (int i=0; i < count; i++) mismatches += (scalar[i] != wide[i]);
+    printf("Philox known answer %s; %d numbers: scalar %.0f M/s, 8-wide on %d threads %.0f M/s, %d mismatches\n",
+            kat_ok ? "ok" : "WRONG", count,
+            count / ((middle - start) / frequency) / 1e6, pool.num_threads,
+            count / ((end - middle) / frequency) / 1e6, mismatches);
+    free(scalar);
+    free(wide);
+    ThreadPoolFree(&pool);
+    return (kat_ok && (mismatches == 0)) ? 0 : 1;
+}
+
+// -----------
+// | Heatmap |
+// -----------
+
+// Count how many particles land on each pixel and color pixels by count. At a
+// million particles, one pixel per particle just overwrites itself; counts show
+// where the particles actually are. Every thread counts into its own buffer,
+// then the buffers are summed up and mapped through a color look-up table.
+#define HEATMAP_MAX_COUNT 1024 // counts at or above this get the hottest color
+
+typedef struct
+{
+    int rows, cols;
+    int num_threads;
+    u32 *counts[MAX_THREADS]; // per-thread counts, rows x cols each
+    u32 lut[256];             // heat color for each level
+    u8 level[HEATMAP_MAX_COUNT+1]; // lut index for each count
+} heatmap_t;
+
+internal void HeatmapInit(heatmap_t *heatmap, int rows, int cols, int num_threads, arena_t *arena)
+{
+    memset(heatmap, 0, sizeof(*heatmap));
+    heatmap->rows = rows;
+    heatmap->cols = cols;
+    heatmap->num_threads = num_threads;
+    for (int t=0; t < num_threads; t++)
+    {
+        heatmap->counts[t] = (u32*) ArenaPush(arena, (size_t)rows*cols * sizeof(u32));
+    }
+    // Black -> red -> yellow -> white, transparent where there is nothing
+    heatmap->lut[0] = EMPTY_SPACE;
+    for (int i=1; i < 256; i++)
+    {
+        u32 r = SDL_min(3*i, 255);
+        u32 g = SDL_min(SDL_max(3*i - 255, 0), 255);
+        u32 b = SDL_max(3*i - 510, 0);
+        heatmap->lut[i] = 0xFF000000 | (r << 16) | (g << 8) | b;
+    }
+    // Square-root scale so sparse pixels still show up
+    heatmap->level[0] = 0;
+    for (int c=1; c <= HEATMAP_MAX_COUNT; c++)
+    {
+        int level = (int)(255.0*SDL_sqrt((double)c/HEATMAP_MAX_COUNT));
+        heatmap->level[c] = (u8) SDL_max(level, 1);
+    }
+}
+
+typedef struct
+{
+    heatmap_t *heatmap;
+    const momentum_t *particles;
+    const u32 *frame;
+    u32 *pixels;
+    u8 *levels; // instead of `pixels`
+} heatmap_job_t;
+
+internal void HeatmapScatterParticlesJob(void *data, int begin, int end, int thread)
+{
+    heatmap_job_t *job = (heatmap_job_t*) data;
+    heatmap_t *heatmap = job->heatmap;
+    u32 *counts = heatmap->counts[thread];
+    for (int i=begin; i < end; i++)
+    {
+        int row = (int)(job->particles[i].x);
+        int col = (int)(job->particles[i].y);
+        // One unsigned compare catches negative and too-big both
+        if (((unsigned)row < (unsigned)heatmap->rows) && ((unsigned)col < (unsigned)heatmap->cols))
+        {
+            counts[row*heatmap->cols + col]++;
+        }
+    }
+}
+
+/**
+ *  \brief Count a list of particles, using their floating-point positions
+ */
+internal void HeatmapScatterParticles(heatmap_t *heatmap, thread_pool_t *pool,
+        const momentum_t *particles, int count)
+{
+    assert(pool->num_threads <= heatmap->num_threads);
+    heatmap_job_t job = {heatmap, particles, NULL, NULL, NULL};
+    ParallelFor(pool, count, 1 << 16, HeatmapScatterParticlesJob, &job);
+}
+
+internal void HeatmapScatterGridJob(void *data, int begin, int end, int thread)
+{
+    heatmap_job_t *job = (heatmap_job_t*) data;
+    u32 *counts = job->heatmap->counts[thread];
+    for (int row=begin; row < end; row++)
+        for (int col=0; col < SCREEN_WIDTH; col++)
+        {
+            counts[row*SCREEN_WIDTH + col] += (job->frame[row*SCREEN_WIDTH + col] == PROJECTILE_COLOR);
+        }
+}
+
+/**
+ *  \brief Count the projectiles in the simulation grid `frame`
+ *
+ *  The heatmap must be SCREEN_HEIGHT x SCREEN_WIDTH. Counts build up until
+ *  HeatmapResolve(), so scattering every tick between frames shows where
+ *  projectiles spent their time.
+ */
+internal void HeatmapScatterGrid(heatmap_t *heatmap, thread_pool_t *pool, const u32 *frame)
+{
+    assert((heatmap->rows == SCREEN_HEIGHT) && (heatmap->cols == SCREEN_WIDTH));
+    assert(pool->num_threads <= heatmap->num_threads);
+    heatmap_job_t job = {heatmap, NULL, frame, NULL, NULL};
+    ParallelFor(pool, SCREEN_HEIGHT, 8, HeatmapScatterGridJob, &job);
+}
+
+internal void HeatmapResolveJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    heatmap_job_t *job = (heatmap_job_t*) data;
+    heatmap_t *heatmap = job->heatmap;
+    for (int i=begin; i < end; i++)
+    {
+        u32 count = 0;
+        for (int t=0; t < heatmap->num_threads; t++)
+        {
+            count += heatmap->counts[t][i];
+            heatmap->counts[t][i] = 0;
+        }
+        count = SDL_min(count, HEATMAP_MAX_COUNT);
+        if (job->levels) job->levels[i] = heatmap->level[count];
+        else job->pixels[i] = heatmap->lut[heatmap->level[count]];
+    }
+}
+
+/**
+ *  \brief Sum the per-thread counts into ARGB `pixels` and start over
+ *
+ *  \param pixels   rows x cols ARGB output
+ */
+internal void HeatmapResolve(heatmap_t *heatmap, thread_pool_t *pool, u32 *pixels)
+{
+    heatmap_job_t job = {heatmap, NULL, NULL, pixels, NULL};
+    ParallelFor(pool, heatmap->rows*heatmap->cols, 1 << 14, HeatmapResolveJob, &job);
+}
+
+/**
+ *  \brief Like HeatmapResolve(), but write the lut index of each pixel
+ *
+ *  \param levels   rows x cols, 0 where nothing passed
+ */
+internal void HeatmapResolveLevels(heatmap_t *heatmap, thread_pool_t *pool, u8 *levels)
+{
+    heatmap_job_t job = {heatmap, NULL, NULL, NULL, levels};
+    ParallelFor(pool, heatmap->rows*heatmap->cols, 1 << 14, HeatmapResolveJob, &job);
+}
+
+/**
+ *  \brief Headless benchmark: heatmap of a particle list every frame
+ *
+ *  momentum.exe --heatmap [particles] [rows] [cols] [frames]
+ */
+internal int HeatmapBenchmark(int argc, char **argv)
+{
+    int count  = (argc > 0) ? atoi(argv[0]) : 10000000;
+    int rows   = (argc > 1) ? atoi(argv[1]) : 1080;
+    int cols   = (argc > 2) ? atoi(argv[2]) : 1920;
+    int frames = (argc > 3) ? atoi(argv[3]) : 20;
+
+    thread_pool_t pool;
+    ThreadPoolInit(&pool, 0);
+    heatmap_t heatmap;
+    arena_t arena = {0};
+    ARENA_SIZED(&arena, HeatmapInit(&heatmap, rows, cols, pool.num_threads, &arena));
+    u32 *pixels = (u32*) calloc((size_t)rows*cols, sizeof(u32));
+    momentum_t *particles = (momentum_t*) calloc(count, sizeof(momentum_t));
+    assert(pixels && particles);
+
+    // A lopsided cloud: sum of two uniforms piles particles up in the middle
+    for (int i=0; i < count; i++)
+    {
+        float r[4];
+        for (int k=0; k < 4; k++) r[k] = RngUnit(RngU32(1, 0, i, k));
+        momentum_t particle = {(r[0]+r[1])*0.5f*rows, (r[2]+r[3])*0.5f*cols, 0, 0};
+        particles[i] = particle;
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int frame=0; frame < frames; frame++)
+    {
+        HeatmapScatterParticles(&heatmap, &pool, particles, count);
+        HeatmapResolve(&heatmap, &pool, pixels);
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    printf("%d particles into %dx%d on %d threads: %.2f ms per frame\n",
+            count, cols, rows, pool.num_threads, 1000.0*seconds/frames);
+
+    free(particles);
+    free(pixels);
+    ArenaFree(&arena);
+    ThreadPoolFree(&pool);
+    return 0;
+}
+
+// -----------------------------------
+// | Smoothed-Particle Hydrodynamics |
+// -----------------------------------
+
+// Fluid mode: each particle is a blob of liquid. Density is the sum of its
+// neighbors' smoothing kernels, pressure pushes toward the rest density and
+// viscosity evens out neighbor velocities. Neighbors come from a cell list:
+// particles are sorted into SPH_H x SPH_H cells, so only the 3x3 cells around
+// a particle need to be searched. Positions and velocities stay in momentum_t.
+#define SPH_H 2.0f          // smoothing radius in pixels (also the cell size)
+#define SPH_SPACING 1.0f    // particle spacing at rest density
+#define SPH_STIFFNESS 1.0f // pressure per unit of density above rest
+#define SPH_VISCOSITY 0.2f
+#define SPH_WALL_DAMPING 0.5f // fraction of speed kept bouncing off a wall
+#define FLUID_COLOR 0xFF3080FF // opaque blue
+
+// 2D kernel normalization constants (Mueller et al. 2003, in 2D)
+#define SPH_PI 3.14159265f
+#define SPH_POLY6 (4.0f/(SPH_PI*SPH_H*SPH_H*SPH_H*SPH_H*SPH_H*SPH_H*SPH_H*SPH_H))
+#define SPH_SPIKY_GRAD (-30.0f/(SPH_PI*SPH_H*SPH_H*SPH_H*SPH_H*SPH_H))
+#define SPH_VISC_LAP (40.0f/(SPH_PI*SPH_H*SPH_H*SPH_H*SPH_H*SPH_H))
+
+typedef struct
+{
+    int rows, cols;          // domain size in pixels
+    int cell_rows, cell_cols;
+    int count, capacity;
+    float rest_density;
+
+    momentum_t *particles;   // sorted by cell after every step
+    float *density;          // per particle, same order as `particles`
+    float *pressure;
+
+    // ---Scratch---
+    momentum_t *sorted;      // next `particles`
+    float *x, *y, *dx, *dy;  // positions and velocities, one array each (SIMD)
+    int *cell_of;            // cell of each particle before sorting
+    int *cell_start;         // first sorted particle in each cell, plus one past the end
+} sph_t;
+
+inline internal float SphPoly6(float r2)
+{
+    float d = SPH_H*SPH_H - r2;
+    return (d > 0) ? SPH_POLY6*d*d*d : 0;
+}
+
+internal void SphInit(sph_t *sph, int rows, int cols, int capacity, arena_t *arena)
+{
+    memset(sph, 0, sizeof(*sph));
+    sph->rows = rows;
+    sph->cols = cols;
+    sph->cell_rows = (int)(rows/SPH_H) + 1;
+    sph->cell_cols = (int)(cols/SPH_H) + 1;
+    sph->capacity = capacity;
+    sph->particles = (momentum_t*) ArenaPush(arena, capacity * sizeof(momentum_t));
+    sph->sorted    = (momentum_t*) ArenaPush(arena, capacity * sizeof(momentum_t));
+    sph->density   = (float*) ArenaPush(arena, capacity * sizeof(float));
+    sph->pressure  = (float*) ArenaPush(arena, capacity * sizeof(float));
+    // The arena's slack keeps SIMD loads past the last particle in bounds
+    sph->x  = (float*) ArenaPush(arena, capacity * sizeof(float));
+    sph->y  = (float*) ArenaPush(arena, capacity * sizeof(float));
+    sph->dx = (float*) ArenaPush(arena, capacity * sizeof(float));
+    sph->dy = (float*) ArenaPush(arena, capacity * sizeof(float));
+    sph->cell_of = (int*) ArenaPush(arena, capacity * sizeof(int));
+    sph->cell_start = (int*) ArenaPush(arena, (sph->cell_rows*sph->cell_cols + 1) * sizeof(int));
+
+    // Rest density: what a particle sees on a square lattice at SPH_SPACING
+    float rest = 0;
+    for (int i=-3; i <= 3; i++)
+        for (int j=-3; j <= 3; j++)
+        {
+            rest += SphPoly6((i*i + j*j)*SPH_SPACING*SPH_SPACING);
+        }
+    sph->rest_density = rest;
+}
+
+/**
+ *  \brief Add a fluid particle
+ *
+ *  \return false if the fluid is full
+ */
+internal bool SphAdd(sph_t *sph, momentum_t particle)
+{
+    if (sph->count == sph->capacity) return false;
+    sph->particles[sph->count++] = particle;
+    return true;
+}
+
+inline internal int SphCell(sph_t *sph, float x, float y)
+{
+    int cell_row = SDL_clamp((int)(x*(1.0f/SPH_H)), 0, sph->cell_rows-1);
+    int cell_col = SDL_clamp((int)(y*(1.0f/SPH_H)), 0, sph->cell_cols-1);
+    return cell_row*sph->cell_cols + cell_col;
+}
+
+/**
+ *  \brief Counting sort of the particles by cell, into the SoA scratch arrays
+ */
+internal void SphSortIntoCells(sph_t *sph)
+{
+    int num_cells = sph->cell_rows*sph->cell_cols;
+    int *start = sph->cell_start;
+    memset(start, 0, (num_cells+1)*sizeof(int));
+    for (int i=0; i < sph->count; i++)
+    {
+        int cell = SphCell(sph, sph->particles[i].x, sph->particles[i].y);
+        sph->cell_of[i] = cell;
+        start[cell+1]++;
+    }
+    for (int c=0; c < num_cells; c++) start[c+1] += start[c];
+    for (int i=0; i < sph->count; i++)
+    {
+        // start[cell] walks forward as the cell fills, then is put back below
+        int j = start[sph->cell_of[i]]++;
+        momentum_t p = sph->particles[i];
+        sph->x[j] = p.x;
+        sph->y[j] = p.y;
+        sph->dx[j] = p.dx;
+        sph->dy[j] = p.dy;
+    }
+    for (int c=num_cells; c > 0; c--) start[c] = start[c-1];
+    start[0] = 0;
+}
+
+internal void SphDensityJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    sph_t *sph = (sph_t*) data;
+    const f32x4 h2 = {SPH_H*SPH_H, SPH_H*SPH_H, SPH_H*SPH_H, SPH_H*SPH_H};
+    const f32x4 zero = {0};
+    for (int i=begin; i < end; i++)
+    {
+        float xi = sph->x[i], yi = sph->y[i];
+        f32x4 x4 = {xi, xi, xi, xi}, y4 = {yi, yi, yi, yi};
+        f32x4 sum4 = zero;
+        float sum = 0;
+        int cell = SphCell(sph, xi, yi);
+        int cell_row = cell / sph->cell_cols, cell_col = cell % sph->cell_cols;
+        for (int r=SDL_max(cell_row-1, 0); r <= SDL_min(cell_row+1, sph->cell_rows-1); r++)
+        {
+            // The three cells side by side in a row are contiguous after sorting
+            int first = sph->cell_start[r*sph->cell_cols + SDL_max(cell_col-1, 0)];
+            int last  = sph->cell_start[r*sph->cell_cols + SDL_min(cell_col+1, sph->cell_cols-1) + 1];
+            int j = first;
+            for (; j+4 <= last; j += 4)
+            {
+                f32x4 ddx, ddy;
+                memcpy(&ddx, &sph->x[j], sizeof(ddx));
+                memcpy(&ddy, &sph->y[j], sizeof(ddy));
+                ddx -= x4;
+                ddy -= y4;
+                f32x4 d = h2 - (ddx*ddx + ddy*ddy);
+                d = (f32x4)((i32x4)d & (d > zero)); // outside the radius: 0
+                sum4 += d*d*d;
+            }
+            for (; j < last; j++)
+            {
+                float ddx = sph->x[j] - xi, ddy = sph->y[j] - yi;
+                sum += SphPoly6(ddx*ddx + ddy*ddy);
+            }
+        }
+        float density = sum + SPH_POLY6*(sum4[0] + sum4[1] + sum4[2] + sum4[3]);
+        sph->density[i] = density;
+        sph->pressure[i] = SDL_max(SPH_STIFFNESS*(density - sph->rest_density), 0.0f);
+    }
+}
+
+internal void SphForceJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    sph_t *sph = (sph_t*) data;
+    const f32x4 zero = {0};
+    const f32x4 h = {SPH_H, SPH_H, SPH_H, SPH_H};
+    const f32x4 tiny = {1e-6f, 1e-6f, 1e-6f, 1e-6f};
+    for (int i=begin; i < end; i++)
+    {
+        float xi = sph->x[i], yi = sph->y[i];
+        float vxi = sph->dx[i], vyi = sph->dy[i];
+        float pi = sph->pressure[i];
+        f32x4 x4 = {xi, xi, xi, xi}, y4 = {yi, yi, yi, yi};
+        f32x4 vx4 = {vxi, vxi, vxi, vxi}, vy4 = {vyi, vyi, vyi, vyi};
+        f32x4 p4 = {pi, pi, pi, pi};
+        f32x4 fx4 = zero, fy4 = zero;
+        float fx = 0, fy = 0;
+        int cell = SphCell(sph, xi, yi);
+        int cell_row = cell / sph->cell_cols, cell_col = cell % sph->cell_cols;
+        for (int r=SDL_max(cell_row-1, 0); r <= SDL_min(cell_row+1, sph->cell_rows-1); r++)
+        {
+            int first = sph->cell_start[r*sph->cell_cols + SDL_max(cell_col-1, 0)];
+            int last  = sph->cell_start[r*sph->cell_cols + SDL_min(cell_col+1, sph->cell_cols-1) + 1];
+            int j = first;
+            for (; j+4 <= last; j += 4)
+            {
+                f32x4 ddx, ddy, vx, vy, pj, rhoj;
+                memcpy(&ddx, &sph->x[j], sizeof(ddx));
+                memcpy(&ddy, &sph->y[j], sizeof(ddy));
+                memcpy(&vx, &sph->dx[j], sizeof(vx));
+                memcpy(&vy, &sph->dy[j], sizeof(vy));
+                memcpy(&pj, &sph->pressure[j], sizeof(pj));
+                memcpy(&rhoj, &sph->density[j], sizeof(rhoj));
+                ddx -= x4;
+                ddy -= y4;
+                f32x4 r = SqrtF32x4(ddx*ddx + ddy*ddy);
+                i32x4 in_range = (r < h) & (r > tiny); // skips particle i itself
+                f32x4 q = h - r;
+                // Pressure: spiky gradient, pushes i away from j
+                f32x4 push = (SPH_SPIKY_GRAD*0.5f) * (p4 + pj) * q*q / (rhoj*(r + tiny));
+                // Viscosity: pulls i's velocity toward j's
+                f32x4 visc = (SPH_VISCOSITY*SPH_VISC_LAP) * q / rhoj;
+                f32x4 ax = push*ddx + visc*(vx - vx4);
+                f32x4 ay = push*ddy + visc*(vy - vy4);
+                fx4 += (f32x4)((i32x4)ax & in_range);
+                fy4 += (f32x4)((i32x4)ay & in_range);
+            }
+            for (; j < last; j++)
+            {
+                float ddx = sph->x[j] - xi, ddy = sph->y[j] - yi;
+                float r = SDL_sqrtf(ddx*ddx + ddy*ddy);
+                if ((r >= SPH_H) || (r <= 1e-6f)) continue;
+                float q = SPH_H - r;
+                float push = (SPH_SPIKY_GRAD*0.5f) * (pi + sph->pressure[j]) * q*q / (sph->density[j]*(r + 1e-6f));
+                float visc = (SPH_VISCOSITY*SPH_VISC_LAP) * q / sph->density[j];
+                fx += push*ddx + visc*(sph->dx[j] - vxi);
+                fy += push*ddy + visc*(sph->dy[j] - vyi);
+            }
+        }
+        fx += fx4[0] + fx4[1] + fx4[2] + fx4[3];
+        fy += fy4[0] + fy4[1] + fy4[2] + fy4[3];
+
+        // Integrate: one tick, same gravity as the projectiles
+        momentum_t p = {xi, yi, vxi, vyi};
+        p.dx += fx/sph->density[i] + GRAVITY;
+        p.dy += fy/sph->density[i];
+        p.x += p.dx;
+        p.y += p.dy;
+        // Bounce off the walls. Mirror rather than clamp: particles clamped
+        // onto the same spot would have no direction to push each other.
+        float bottom = sph->rows - 1, right = sph->cols - 1;
+        if (p.x < 0)      { p.x = -p.x;             p.dx = -p.dx*SPH_WALL_DAMPING; }
+        if (p.x > bottom) { p.x = 2*bottom - p.x;   p.dx = -p.dx*SPH_WALL_DAMPING; }
+        if (p.y < 0)      { p.y = -p.y;             p.dy = -p.dy*SPH_WALL_DAMPING; }
+        if (p.y > right)  { p.y = 2*right - p.y;    p.dy = -p.dy*SPH_WALL_DAMPING; }
+        p.x = SDL_clamp(p.x, 0, bottom);
+        p.y = SDL_clamp(p.y, 0, right);
+        sph->sorted[i] = p;
+    }
+}
+
+/**
+ *  \brief Advance the fluid one tick
+ *
+ *  Afterward `particles`, `density` and `pressure` are in cell order.
+ */
+internal void SphStep(sph_t *sph, thread_pool_t *pool)
+{
+    SphSortIntoCells(sph);
+    ParallelFor(pool, sph->count, 1024, SphDensityJob, sph);
+    ParallelFor(pool, sph->count, 1024, SphForceJob, sph);
+    momentum_t *tmp = sph->particles;
+    sph->particles = sph->sorted;
+    sph->sorted = tmp;
+}
+
+/**
+ *  \brief Pour a block of fluid at rest spacing, top-left at row,col
+ */
+internal void SphAddBlock(sph_t *sph, float row, float col, int rows, int cols)
+{
+    for (int i=0; i < rows; i++)
+        for (int j=0; j < cols; j++)
+        {
+            momentum_t particle = {row + i*SPH_SPACING, col + j*SPH_SPACING, 0, 0};
+            SphAdd(sph, particle);
+        }
+}
+
+/**
+ *  \brief Headless benchmark: a dam break
+ *
+ *  momentum.exe --sph [particles] [ticks]
+ */
+internal int SphBenchmark(int argc, char **argv)
+{
+    int count = (argc > 0) ? atoi(argv[0]) : 100000;
+    int ticks = (argc > 1) ? atoi(argv[1]) : 300;
+
+    // Fluid starts as a square in the left half of a box twice its size
+    int side = (int)SDL_sqrt((double)count);
+    thread_pool_t pool;
+    ThreadPoolInit(&pool, 0);
+    sph_t sph;
+    arena_t arena = {0};
+    ARENA_SIZED(&arena, SphInit(&sph, 2*side, 2*side, side*side, &arena));
+    SphAddBlock(&sph, side, 0, side, side);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int tick=0; tick < ticks; tick++)
+    {
+        SphStep(&sph, &pool);
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    double mean_density = 0;
+    float max_speed2 = 0;
+    for (int i=0; i < sph.count; i++)
+    {
+        momentum_t p = sph.particles[i];
+        mean_density += sph.density[i];
+        max_speed2 = SDL_max(max_speed2, p.dx*p.dx + p.dy*p.dy);
+    }
+    mean_density /= sph.count;
+    printf("%d fluid particles on %d threads: %.2f ms per tick "
+           "(mean density %.2f x rest, max speed %.2f px/tick)\n",
+            sph.count, pool.num_threads, 1000.0*seconds/ticks,
+            mean_density/sph.rest_density, SDL_sqrtf(max_speed2));
+    ArenaFree(&arena);
+    ThreadPoolFree(&pool);
+    return 0;
+}
+
+// -----------------
+// | Stable Fluids |
+// -----------------
+
+// A velocity field on a grid, one cell per pixel (Stam's "stable fluids"):
+// advect the velocity along itself by tracing each cell back in time, then
+// project out the divergence so the flow is incompressible. The projection
+// needs a pressure that solves a Poisson equation; a geometric multigrid
+// V-cycle shrinks its error by a fixed factor no matter how big the grid, so
+// a few V-cycles per tick are enough even on 4k grids. Particles feel the
+// field as a drag toward the local flow velocity.
+//
+// Each coarser level halves the rows and columns, rounding up, so when a
+// level has an odd count its last coarse row (or column) covers just one
+// fine one. Cells keep their true size: the Poisson stencil weighs each
+// neighbor by the face they share over the distance between their centers,
+// restriction averages by area, and prolongation interpolates between true
+// centers. Odd sizes then converge as well as powers of two.
+#define STABLE_FLUID_VCYCLES 2  // V-cycles per tick
+#define STABLE_FLUID_SMOOTH 2   // Gauss-Seidel sweeps before and after each coarsening
+#define STABLE_FLUID_COARSEST 4 // stop coarsening at this many cells on a side
+#define STABLE_FLUID_DAMPING 0.999f // fraction of velocity kept each tick
+#define STABLE_FLUID_DRAG 0.05f // how fast particles pick up the flow velocity
+#define STABLE_FLUID_MAX_LEVELS 16
+
+typedef struct
+{
+    int rows, cols;
+    float *p;   // pressure (level 0) or pressure correction (coarser levels)
+    float *rhs; // divergence (level 0) or restricted residual
+    float *res; // residual
+
+    // Geometry, in full-resolution cells
+    float *row_size, *col_size; // height of each row, width of each column
+    float *row_link, *col_link; // 1 / distance to the next row's (column's) center
+    float *row_up, *col_up;     // each row's (column's) center in coarse rows (columns)
+} mg_level_t;
+
+typedef struct
+{
+    int rows, cols;
+    float *u, *v;           // velocity: rows per tick, cols per tick
+    float *u_prev, *v_prev; // velocity before advection
+    int num_levels;
+    mg_level_t levels[STABLE_FLUID_MAX_LEVELS]; // 0 is full resolution
+} stable_fluid_t;
+
+typedef struct
+{
+    stable_fluid_t *fluid;
+    mg_level_t *level;
+    mg_level_t *coarse;
+    int color; // red-black Gauss-Seidel: sweep cells with (row+col)%2 == color
+} stable_fluid_job_t;
+
+/**
+ *  \brief Sizes of a level's rows (or columns), and the links between centers
+ *
+ *  \param count  Rows in the level
+ *  \param scale  Full-resolution rows per level row
+ *  \param extent Full-resolution rows in all
+ */
+internal void MultigridSizes(float *size, float *link, int count, int scale, int extent)
+{
+    for (int i=0; i < count; i++) size[i] = (float)(SDL_min((i+1)*scale, extent) - i*scale);
+    for (int i=0; i+1 < count; i++) link[i] = 2 / (size[i] + size[i+1]);
+}
+
+/**
+ *  \brief Where each fine row's center falls in coarse rows, for interpolation
+ *
+ *  Coarse row R covers fine rows 2R and 2R+1; a result of R + t lies t of the
+ *  way from coarse center R to coarse center R+1.
+ */
+internal void MultigridCenters(float *up, const float *fine_size, int fine_count,
+        const float *coarse_size, int coarse_count)
+{
+    float fine_start = 0;
+    for (int i=0; i < fine_count; i++)
+    {
+        float center = fine_start + 0.5f*fine_size[i];
+        fine_start += fine_size[i];
+        // Coarse centers either side
+        int R = i/2;
+        float coarse_start = 0;
+        for (int j=0; j < R; j++) coarse_start += coarse_size[j];
+        float coarse_center = coarse_start + 0.5f*coarse_size[R];
+        if (center < coarse_center)
+        {
+            if (R == 0) { up[i] = 0; continue; }
+            R--;
+            coarse_start -= coarse_size[R];
+            coarse_center = coarse_start + 0.5f*coarse_size[R];
+        }
+        if (R == coarse_count-1) { up[i] = (float)R; continue; }
+        float next_center = coarse_start + coarse_size[R] + 0.5f*coarse_size[R+1];
+        up[i] = R + (center - coarse_center) / (next_center - coarse_center);
+    }
+}
+
+internal void StableFluidInit(stable_fluid_t *fluid, int rows, int cols, arena_t *arena)
+{
+    memset(fluid, 0, sizeof(*fluid));
+    fluid->rows = rows;
+    fluid->cols = cols;
+    size_t cells = (size_t)rows*cols;
+    fluid->u = (float*) ArenaPush(arena, cells * sizeof(float));
+    fluid->v = (float*) ArenaPush(arena, cells * sizeof(float));
+    fluid->u_prev = (float*) ArenaPush(arena, cells * sizeof(float));
+    fluid->v_prev = (float*) ArenaPush(arena, cells * sizeof(float));
+
+    while (fluid->num_levels < STABLE_FLUID_MAX_LEVELS)
+    {
+        mg_level_t *level = &fluid->levels[fluid->num_levels++];
+        level->rows = rows;
+        level->cols = cols;
+        level->p   = (float*) ArenaPush(arena, (size_t)rows*cols * sizeof(float));
+        level->rhs = (float*) ArenaPush(arena, (size_t)rows*cols * sizeof(float));
+        level->res = (float*) ArenaPush(arena, (size_t)rows*cols * sizeof(float));
+        level->row_size = (float*) ArenaPush(arena, rows * sizeof(float));
+        level->col_size = (float*) ArenaPush(arena, cols * sizeof(float));
+        level->row_link = (float*) ArenaPush(arena, rows * sizeof(float));
+        level->col_link = (float*) ArenaPush(arena, cols * sizeof(float));
+        level->row_up = (float*) ArenaPush(arena, rows * sizeof(float));
+        level->col_up = (float*) ArenaPush(arena, cols * sizeof(float));
+        if ((rows <= STABLE_FLUID_COARSEST) || (cols <= STABLE_FLUID_COARSEST)) break;
+        rows = (rows+1)/2;
+        cols = (cols+1)/2;
+    }
+    if (!arena->base) return; // only counting
+
+    for (int l=0; l < fluid->num_levels; l++)
+    {
+        mg_level_t *level = &fluid->levels[l];
+        MultigridSizes(level->row_size, level->row_link, level->rows, 1 << l, fluid->rows);
+        MultigridSizes(level->col_size, level->col_link, level->cols, 1 << l, fluid->cols);
+    }
+    for (int l=0; l+1 < fluid->num_levels; l++)
+    {
+        mg_level_t *fine = &fluid->levels[l], *coarse = &fluid->levels[l+1];
+        MultigridCenters(fine->row_up, fine->row_size, fine->rows, coarse->row_size, coarse->rows);
+        MultigridCenters(fine->col_up, fine->col_size, fine->cols, coarse->col_size, coarse->cols);
+    }
+}
+
+/**
+ *  \brief Bilinear sample of a field at fractional row x, col y
+ */
+inline internal float SampleField(const float *field, int rows, int cols, float x, float y)
+{
+    x = SDL_clamp(x, 0, rows-1);
+    y = SDL_clamp(y, 0, cols-1);
+    int r = SDL_min((int)x, rows-2 < 0 ? 0 : rows-2);
+    int c = SDL_min((int)y, cols-2 < 0 ? 0 : cols-2);
+    float fx = x - r, fy = y - c;
+    const float *f = &field[r*cols + c];
+    float top = f[0] + fy*(f[1] - f[0]);
+    float bottom = f[cols] + fy*(f[cols+1] - f[cols]);
+    return top + fx*(bottom - top);
+}
+
+internal void AdvectJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    stable_fluid_t *fluid = ((stable_fluid_job_t*) data)->fluid;
+    int rows = fluid->rows, cols = fluid->cols;
+    for (int row=begin; row < end; row++)
+        for (int col=0; col < cols; col++)
+        {
+            int i = row*cols + col;
+            // Where did the fluid now in this cell come from one tick ago?
+            float x = row - fluid->u_prev[i];
+            float y = col - fluid->v_prev[i];
+            fluid->u[i] = STABLE_FLUID_DAMPING*SampleField(fluid->u_prev, rows, cols, x, y);
+            fluid->v[i] = STABLE_FLUID_DAMPING*SampleField(fluid->v_prev, rows, cols, x, y);
+        }
+}
+
+internal void DivergenceJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    stable_fluid_t *fluid = ((stable_fluid_job_t*) data)->fluid;
+    mg_level_t *level = &fluid->levels[0];
+    int rows = fluid->rows, cols = fluid->cols;
+    for (int row=begin; row < end; row++)
+        for (int col=0; col < cols; col++)
+        {
+            int i = row*cols + col;
+            // Walls: nothing flows in from outside
+            float down  = (row+1 < rows) ? fluid->u[i+cols] : 0;
+            float up    = (row > 0)      ? fluid->u[i-cols] : 0;
+            float right = (col+1 < cols) ? fluid->v[i+1]    : 0;
+            float left  = (col > 0)      ? fluid->v[i-1]    : 0;
+            level->rhs[i] = 0.5f*((down - up) + (right - left));
+            level->p[i] = 0;
+        }
+}
+
+/**
+ *  \brief Pressure flux into one cell from its neighbors inside the grid
+ *
+ *  Each neighbor pushes with k*(neighbor - p), k being the face they share
+ *  over the distance between centers. Returns the flux without the -p terms;
+ *  `k_sum` gets the sum of k. Walls are solid, so nothing pushes through them.
+ */
+inline internal float MultigridInflow(const mg_level_t *level, int row, int col, float *k_sum)
+{
+    int rows = level->rows, cols = level->cols;
+    int i = row*cols + col;
+    const float *p = level->p;
+    float height = level->row_size[row], width = level->col_size[col];
+    float sum = 0, k = 0, link;
+    if (row > 0)      { link = width*level->row_link[row-1];  sum += link*p[i-cols]; k += link; }
+    if (row+1 < rows) { link = width*level->row_link[row];    sum += link*p[i+cols]; k += link; }
+    if (col > 0)      { link = height*level->col_link[col-1]; sum += link*p[i-1];    k += link; }
+    if (col+1 < cols) { link = height*level->col_link[col];   sum += link*p[i+1];    k += link; }
+    *k_sum = k;
+    return sum;
+}
+
+/**
+ *  \brief Red-black Gauss-Seidel sweep of one color
+ *
+ *  Solves inflow - k_sum*p = area*rhs (see MultigridInflow()). Away from the
+ *  last two rows and columns every cell is full size and every k is 1.
+ */
+internal void SmoothJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    stable_fluid_job_t *job = (stable_fluid_job_t*) data;
+    mg_level_t *level = job->level;
+    int rows = level->rows, cols = level->cols;
+    float *p = level->p;
+    float area = level->row_size[0]*level->col_size[0];
+    for (int row=begin; row < end; row++)
+    {
+        bool inner_row = (row > 0) && (row+2 < rows);
+        int col = (row + job->color) & 1;
+        for (; col < cols; col += 2)
+        {
+            int i = row*cols + col;
+            if (inner_row && (col > 0) && (col+2 < cols))
+            {
+                p[i] = (p[i-cols] + p[i+cols] + p[i-1] + p[i+1] - area*level->rhs[i]) / 4;
+                continue;
+            }
+            float k;
+            float inflow = MultigridInflow(level, row, col, &k);
+            p[i] = (inflow - level->row_size[row]*level->col_size[col]*level->rhs[i]) / k;
+        }
+    }
+}
+
+internal void ResidualJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    mg_level_t *level = ((stable_fluid_job_t*) data)->level;
+    int rows = level->rows, cols = level->cols;
+    float *p = level->p;
+    float area = level->row_size[0]*level->col_size[0];
+    for (int row=begin; row < end; row++)
+    {
+        bool inner_row = (row > 0) && (row+2 < rows);
+        for (int col=0; col < cols; col++)
+        {
+            int i = row*cols + col;
+            if (inner_row && (col > 0) && (col+2 < cols))
+            {
+                float lap = (p[i-cols] - p[i]) + (p[i+cols] - p[i]) + (p[i-1] - p[i]) + (p[i+1] - p[i]);
+                level->res[i] = level->rhs[i] - lap/area;
+                continue;
+            }
+            float k;
+            float inflow = MultigridInflow(level, row, col, &k);
+            level->res[i] = level->rhs[i] - (inflow - k*p[i])/(level->row_size[row]*level->col_size[col]);
+        }
+    }
+}
+
+/**
+ *  \brief Coarse rhs = area-weighted average of the fine residuals it covers
+ */
+internal void RestrictJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    stable_fluid_job_t *job = (stable_fluid_job_t*) data;
+    mg_level_t *fine = job->level, *coarse = job->coarse;
+    for (int row=begin; row < end; row++)
+        for (int col=0; col < coarse->cols; col++)
+        {
+            float sum = 0;
+            for (int r=2*row; r < SDL_min(2*row+2, fine->rows); r++)
+                for (int c=2*col; c < SDL_min(2*col+2, fine->cols); c++)
+                {
+                    sum += fine->row_size[r]*fine->col_size[c]*fine->res[r*fine->cols + c];
+                }
+            coarse->rhs[row*coarse->cols + col] = sum / (coarse->row_size[row]*coarse->col_size[col]);
+            coarse->p[row*coarse->cols + col] = 0;
+        }
+}
+
+/**
+ *  \brief Fine p += coarse correction, bilinear between coarse cell centers
+ */
+internal void ProlongJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    stable_fluid_job_t *job = (stable_fluid_job_t*) data;
+    mg_level_t *fine = job->level, *coarse = job->coarse;
+    for (int row=begin; row < end; row++)
+        for (int col=0; col < fine->cols; col++)
+        {
+            float x = fine->row_up[row], y = fine->col_up[col];
+            fine->p[row*fine->cols + col] += SampleField(coarse->p, coarse->rows, coarse->cols, x, y);
+        }
+}
+
+/**
+ *  \brief Subtract the area-weighted mean of a level's rhs
+ *
+ *  Walls all round make the Poisson problem solvable only for an rhs that
+ *  integrates to zero; any mean left over is a floor the residual cannot go
+ *  under.
+ */
+internal void MultigridRemoveMean(mg_level_t *level)
+{
+    double sum = 0, area = 0;
+    for (int row=0; row < level->rows; row++)
+        for (int col=0; col < level->cols; col++)
+        {
+            double cell = (double)level->row_size[row]*level->col_size[col];
+            sum += cell*level->rhs[row*level->cols + col];
+            area += cell;
+        }
+    float mean = (float)(sum / area);
+    for (int i=0; i < level->rows*level->cols; i++) level->rhs[i] -= mean;
+}
+
+internal void MultigridVCycle(stable_fluid_t *fluid, thread_pool_t *pool, int l)
+{
+    mg_level_t *level = &fluid->levels[l];
+    stable_fluid_job_t job = {fluid, level, NULL, 0};
+    int sweeps = (l == fluid->num_levels-1) ? 32 : STABLE_FLUID_SMOOTH; // coarsest: just solve it
+    for (int s=0; s < 2*sweeps; s++)
+    {
+        job.color = s & 1;
+        ParallelFor(pool, level->rows, 16, SmoothJob, &job);
+    }
+    if (l == fluid->num_levels-1) return;
+
+    ParallelFor(pool, level->rows, 16, ResidualJob, &job);
+    job.coarse = &fluid->levels[l+1];
+    ParallelFor(pool, job.coarse->rows, 16, RestrictJob, &job);
+    MultigridRemoveMean(job.coarse);
+    MultigridVCycle(fluid, pool, l+1);
+    ParallelFor(pool, level->rows, 16, ProlongJob, &job);
+
+    for (int s=0; s < 2*STABLE_FLUID_SMOOTH; s++)
+    {
+        job.color = (s & 1) ^ 1; // reverse order on the way up
+        ParallelFor(pool, level->rows, 16, SmoothJob, &job);
+    }
+}
+
+internal void ProjectJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    stable_fluid_t *fluid = ((stable_fluid_job_t*) data)->fluid;
+    int rows = fluid->rows, cols = fluid->cols;
+    float *p = fluid->levels[0].p;
+    for (int row=begin; row < end; row++)
+        for (int col=0; col < cols; col++)
+        {
+            int i = row*cols + col;
+            // Pressure behind a wall equals the pressure in front of it
+            float down  = (row+1 < rows) ? p[i+cols] : p[i];
+            float up    = (row > 0)      ? p[i-cols] : p[i];
+            float right = (col+1 < cols) ? p[i+1]    : p[i];
+            float left  = (col > 0)      ? p[i-1]    : p[i];
+            fluid->u[i] -= 0.5f*(down - up);
+            fluid->v[i] -= 0.5f*(right - left);
+            // Nothing flows through the walls
+            if ((row == 0) || (row == rows-1)) fluid->u[i] = 0;
+            if ((col == 0) || (col == cols-1)) fluid->v[i] = 0;
+        }
+}
+
+/**
+ *  \brief Root-mean-square Poisson residual at full resolution (for testing)
+ */
+internal float StableFluidResidual(stable_fluid_t *fluid, thread_pool_t *pool)
+{
+    mg_level_t *level = &fluid->levels[0];
+    stable_fluid_job_t job = {fluid, level, NULL, 0};
+    ParallelFor(pool, level->rows, 16, ResidualJob, &job);
+    double sum = 0;
+    for (int i=0; i < level->rows*level->cols; i++) sum += level->res[i]*level->res[i];
+    return (float)SDL_sqrt(sum/(level->rows*level->cols));
+}
+
+/**
+ *  \brief Make the velocity field divergence-free
+ */
+internal void StableFluidProject(stable_fluid_t *fluid, thread_pool_t *pool, int vcycles)
+{
+    stable_fluid_job_t job = {fluid, NULL, NULL, 0};
+    ParallelFor(pool, fluid->rows, 16, DivergenceJob, &job);
+    MultigridRemoveMean(&fluid->levels[0]);
+    for (int c=0; c < vcycles; c++) MultigridVCycle(fluid, pool, 0);
+    ParallelFor(pool, fluid->rows, 16, ProjectJob, &job);
+}
+
+/**
+ *  \brief Advance the velocity field one tick
+ */
+internal void StableFluidStep(stable_fluid_t *fluid, thread_pool_t *pool)
+{
+    float *tmp;
+    tmp = fluid->u; fluid->u = fluid->u_prev; fluid->u_prev = tmp;
+    tmp = fluid->v; fluid->v = fluid->v_prev; fluid->v_prev = tmp;
+    stable_fluid_job_t job = {fluid, NULL, NULL, 0};
+    ParallelFor(pool, fluid->rows, 16, AdvectJob, &job);
+    StableFluidProject(fluid, pool, STABLE_FLUID_VCYCLES);
+}
+
+/**
+ *  \brief Push velocity into the field over a rectangle (a fan)
+ */
+internal void StableFluidAddVelocity(stable_fluid_t *fluid, rect_t rect, float du, float dv)
+{
+    for (int row=SDL_max(rect.x, 0); row < SDL_min(rect.x + rect.h, fluid->rows); row++)
+        for (int col=SDL_max(rect.y, 0); col < SDL_min(rect.y + rect.w, fluid->cols); col++)
+        {
+            fluid->u[row*fluid->cols + col] += du;
+            fluid->v[row*fluid->cols + col] += dv;
+        }
+}
+
+/**
+ *  \brief Drag a particle toward the flow velocity where it is
+ */
+inline internal void StableFluidDrag(stable_fluid_t *fluid, momentum_t *particle)
+{
+    float u = SampleField(fluid->u, fluid->rows, fluid->cols, particle->x, particle->y);
+    float v = SampleField(fluid->v, fluid->rows, fluid->cols, particle->x, particle->y);
+    particle->dx += STABLE_FLUID_DRAG*(u - particle->dx);
+    particle->dy += STABLE_FLUID_DRAG*(v - particle->dy);
+}
+
+/**
+ *  \brief Drag every projectile in the simulation grid toward the flow
+ *
+ *  The field must be SCREEN_HEIGHT x SCREEN_WIDTH. Projectiles only move up
+ *  and down in the grid, so only their vertical velocity matters.
+ */
+internal void StableFluidDragGrid(stable_fluid_t *fluid, u32 *frame, momentum_t *momentum_buffer)
+{
+    assert((fluid->rows == SCREEN_HEIGHT) && (fluid->cols == SCREEN_WIDTH));
+    for (int row=0; row < SCREEN_HEIGHT; row++)
+        for (int col=0; col < SCREEN_WIDTH; col++)
+        {
+            if (ColorAt(row, col, frame) != PROJECTILE_COLOR) continue;
+            StableFluidDrag(fluid, &momentum_buffer[row*SCREEN_WIDTH + col]);
+        }
+}
+
+/**
+ *  \brief Headless benchmark: multigrid convergence and ms per tick
+ *
+ *  momentum.exe --stable-fluids [size] [ticks]
+ */
+internal int StableFluidBenchmark(int argc, char **argv)
+{
+    int size  = (argc > 0) ? atoi(argv[0]) : 1024;
+    int ticks = (argc > 1) ? atoi(argv[1]) : 20;
+
+    thread_pool_t pool;
+    ThreadPoolInit(&pool, 0);
+    stable_fluid_t fluid;
+    arena_t arena = {0};
+    ARENA_SIZED(&arena, StableFluidInit(&fluid, size, size, &arena));
+
+    // A jet across the middle with a swirl of noise, so there is divergence
+    for (int i=0; i < size*size; i++)
+    {
+        u32 seed = RngU32(1, 0, i, 0);
+        fluid.u[i] = ((int)(seed & 0xFFFF) - 0x8000) * (1.0f/0x8000);
+        fluid.v[i] = ((int)(seed >> 16) - 0x8000) * (1.0f/0x8000);
+    }
+
+    // Convergence: residual after each V-cycle of one projection
+    stable_fluid_job_t job = {&fluid, NULL, NULL, 0};
+    ParallelFor(&pool, fluid.rows, 16, DivergenceJob, &job);
+    MultigridRemoveMean(&fluid.levels[0]);
+    float residual = StableFluidResidual(&fluid, &pool);
+    printf("%dx%d, %d levels. Residual: %.3g", size, size, fluid.num_levels, residual);
+    float first = residual;
+    int vcycles = 6;
+    for (int c=0; c < vcycles; c++)
+    {
+        MultigridVCycle(&fluid, &pool, 0);
+        float next = StableFluidResidual(&fluid, &pool);
+        printf(" -> %.3g", next);
+        residual = next;
+    }
+    if (residual > 0) printf(" (%.1fx per V-cycle)", SDL_pow(first / residual, 1.0 / vcycles));
+    printf("\n");
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int tick=0; tick < ticks; tick++)
+    {
+        rect_t fan = {size/2 - 4, 0, 8, 8};
+        StableFluidAddVelocity(&fluid, fan, 0, 1);
+        StableFluidStep(&fluid, &pool);
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    printf("%d threads, %d V-cycles per tick: %.2f ms per tick\n",
+            pool.num_threads, STABLE_FLUID_VCYCLES, 1000.0*seconds/ticks);
+    ArenaFree(&arena);
+    ThreadPoolFree(&pool);
+    return 0;
+}
+
+// ---------------------
+// | Lattice Boltzmann |
+// ---------------------
+
+// Wind tunnel: a D2Q9 lattice Boltzmann flow, one lattice cell per pixel.
+// Anything drawn in the world buffers is a solid obstacle. The flow is driven
+// left to right by a body force, wraps around left/right, and the top and
+// bottom are walls.
+//
+// Streaming and collision are fused into one pass over a single set of
+// distributions using the AA pattern: even steps collide in place and store
+// each population in its opposite slot; odd steps pull from the neighbors,
+// collide and push back out to the neighbors. Either way every cell reads and
+// writes the same memory locations, which no other cell touches, so the pass
+// is in place and any order (cache blocks, threads) is safe.
+#define LBM_TAU 0.6f      // relaxation time, viscosity is (LBM_TAU - 0.5)/3
+#define LBM_FORCE 1e-5f   // body force pushing the flow toward +cols
+#define LBM_BLOCK_ROWS 32 // cache block size
+#define LBM_BLOCK_COLS 256
+
+// D2Q9 directions as (row, col) steps, and the opposite of each
+static const int lbm_dr[9]  = {0, 0, 1, 0, -1, 1,  1, -1, -1};
+static const int lbm_dc[9]  = {0, 1, 0, -1, 0, 1, -1, -1,  1};
+static const int lbm_opp[9] = {0, 3, 4, 1,  2, 7,  8,  5,  6};
+
+typedef struct
+{
+    int rows, cols;
+    float *f[9];     // distributions, one array per direction
+    u8 *solid;       // 1 for obstacle cells
+    u8 *near_solid;  // 1 if the cell or any of its eight neighbors is solid
+    u8 *obstacles;   // scratch for LbmSetObstacles()
+    int parity;      // 0: next step is even, 1: next step is odd
+    u64 steps;
+} lbm_t;
+
+/**
+ *  \brief BGK collision of four cells at once, with the body force
+ */
+inline internal void LbmCollide(f32x4 f[9])
+{
+    const f32x4 omega = {1/LBM_TAU, 1/LBM_TAU, 1/LBM_TAU, 1/LBM_TAU};
+    f32x4 rho = f[0]+f[1]+f[2]+f[3]+f[4]+f[5]+f[6]+f[7]+f[8];
+    f32x4 inv_rho = 1.0f/rho;
+    f32x4 ux = (f[2]+f[5]+f[6] - f[4]-f[7]-f[8]) * inv_rho;
+    f32x4 uy = (f[1]+f[5]+f[8] - f[3]-f[6]-f[7]) * inv_rho + (LBM_TAU*LBM_FORCE)*inv_rho;
+    f32x4 usq = 1.5f*(ux*ux + uy*uy);
+    f32x4 w0 = (4.0f/9)*rho, w1 = (1.0f/9)*rho, w2 = (1.0f/36)*rho;
+    f32x4 cu;
+    f[0] += omega*(w0*(1 - usq) - f[0]);
+    cu = uy;      f[1] += omega*(w1*(1 + 3*cu + 4.5f*cu*cu - usq) - f[1]);
+    cu = ux;      f[2] += omega*(w1*(1 + 3*cu + 4.5f*cu*cu - usq) - f[2]);
+    cu = -uy;     f[3] += omega*(w1*(1 + 3*cu + 4.5f*cu*cu - usq) - f[3]);
+    cu = -ux;     f[4] += omega*(w1*(1 + 3*cu + 4.5f*cu*cu - usq) - f[4]);
+    cu = ux + uy; f[5] += omega*(w2*(1 + 3*cu + 4.5f*cu*cu - usq) - f[5]);
+    cu = ux - uy; f[6] += omega*(w2*(1 + 3*cu + 4.5f*cu*cu - usq) - f[6]);
+    cu = -ux-uy;  f[7] += omega*(w2*(1 + 3*cu + 4.5f*cu*cu - usq) - f[7]);
+    cu = uy - ux; f[8] += omega*(w2*(1 + 3*cu + 4.5f*cu*cu - usq) - f[8]);
+}
+
+/**
+ *  \brief Set a cell to fluid at rest
+ */
+internal void LbmRest(lbm_t *lbm, int i)
+{
+    const float w[9] = {4.0f/9, 1.0f/9, 1.0f/9, 1.0f/9, 1.0f/9, 1.0f/36, 1.0f/36, 1.0f/36, 1.0f/36};
+    for (int d=0; d < 9; d++) lbm->f[d][i] = w[d];
+}
+
+internal void LbmInit(lbm_t *lbm, int rows, int cols, arena_t *arena)
+{
+    memset(lbm, 0, sizeof(*lbm));
+    lbm->rows = rows;
+    lbm->cols = cols;
+    size_t cells = (size_t)rows*cols;
+    // The arena's slack keeps SIMD loads past the last cell inside
+    for (int d=0; d < 9; d++) lbm->f[d] = (float*) ArenaPush(arena, cells * sizeof(float));
+    lbm->solid = (u8*) ArenaPush(arena, cells);
+    lbm->near_solid = (u8*) ArenaPush(arena, cells);
+    lbm->obstacles = (u8*) ArenaPush(arena, cells);
+    if (!arena->base) return; // only counting
+    for (size_t i=0; i < cells; i++) LbmRest(lbm, (int)i);
+}
+
+/**
+ *  \brief Mark obstacles; must be called between an odd and an even step
+ *
+ *  \param solid    1 for each obstacle cell, rows x cols
+ *
+ *  Cells that stop being solid come back as fluid at rest.
+ */
+internal void LbmSetSolid(lbm_t *lbm, const u8 *solid)
+{
+    assert(lbm->parity == 0);
+    int rows = lbm->rows, cols = lbm->cols;
+    for (int i=0; i < rows*cols; i++)
+    {
+        if (lbm->solid[i] && !solid[i]) LbmRest(lbm, i);
+        lbm->solid[i] = solid[i];
+    }
+    for (int row=0; row < rows; row++)
+        for (int col=0; col < cols; col++)
+        {
+            u8 by_solid = (row == 0) || (row == rows-1); // next to a wall
+            for (int d=0; d < 9; d++)
+            {
+                int r = row + lbm_dr[d];
+                int c = (col + lbm_dc[d] + cols) % cols;
+                if ((r >= 0) && (r < rows)) by_solid |= solid[r*cols + c];
+            }
+            lbm->near_solid[row*cols + col] = by_solid;
+        }
+}
+
+/**
+ *  \brief Obstacles from a world buffer: anything that is not empty space
+ *
+ *  The lattice must be SCREEN_HEIGHT x SCREEN_WIDTH.
+ */
+internal void LbmSetObstacles(lbm_t *lbm, const u32 *frame, const u32 *frame2)
+{
+    assert((lbm->rows == SCREEN_HEIGHT) && (lbm->cols == SCREEN_WIDTH));
+    u8 *solid = lbm->obstacles;
+    for (int i=0; i < SCREEN_WIDTH*SCREEN_HEIGHT; i++)
+    {
+        solid[i] = (frame[i] != EMPTY_SPACE) || (frame2[i] != EMPTY_SPACE);
+    }
+    LbmSetSolid(lbm, solid);
+}
+
+inline internal bool LbmIsSolid(lbm_t *lbm, int row, int col)
+{
+    if ((row < 0) || (row >= lbm->rows)) return true; // walls
+    return lbm->solid[row*lbm->cols + (col + lbm->cols) % lbm->cols];
+}
+
+/**
+ *  \brief One cell, even step: collide in place, store reversed
+ */
+inline internal void LbmEvenCell(lbm_t *lbm, int i)
+{
+    f32x4 f[9];
+    for (int d=0; d < 9; d++) { float x = lbm->f[d][i]; f32x4 v = {x, x, x, x}; f[d] = v; }
+    LbmCollide(f);
+    for (int d=0; d < 9; d++) lbm->f[lbm_opp[d]][i] = f[d][0];
+}
+
+/**
+ *  \brief One cell, odd step: pull from neighbors, collide, push to neighbors
+ *
+ *  Populations that would cross into a solid bounce straight back (halfway
+ *  bounce-back): they are read from and written to this cell instead.
+ */
+inline internal void LbmOddCell(lbm_t *lbm, int row, int col)
+{
+    int cols = lbm->cols;
+    f32x4 f[9];
+    for (int d=0; d < 9; d++)
+    {
+        int r = row - lbm_dr[d], c = col - lbm_dc[d];
+        float x = LbmIsSolid(lbm, r, c) ? lbm->f[d][row*cols + col]
+                                        : lbm->f[lbm_opp[d]][r*cols + (c + cols) % cols];
+        f32x4 v = {x, x, x, x};
+        f[d] = v;
+    }
+    LbmCollide(f);
+    for (int d=0; d < 9; d++)
+    {
+        int r = row + lbm_dr[d], c = col + lbm_dc[d];
+        if (LbmIsSolid(lbm, r, c)) lbm->f[lbm_opp[d]][row*cols + col] = f[d][0];
+        else lbm->f[d][r*cols + (c + cols) % cols] = f[d][0];
+    }
+}
+
+internal void LbmBlockJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    lbm_t *lbm = (lbm_t*) data;
+    int rows = lbm->rows, cols = lbm->cols;
+    int blocks_across = (cols + LBM_BLOCK_COLS-1)/LBM_BLOCK_COLS;
+    for (int b=begin; b < end; b++)
+    {
+        int row0 = (b / blocks_across)*LBM_BLOCK_ROWS;
+        int col0 = (b % blocks_across)*LBM_BLOCK_COLS;
+        int row1 = SDL_min(row0 + LBM_BLOCK_ROWS, rows);
+        int col1 = SDL_min(col0 + LBM_BLOCK_COLS, cols);
+        for (int row=row0; row < row1; row++)
+        {
+            int col = col0;
+            while (col < col1)
+            {
+                int i = row*cols + col;
+                u32 any_solid;
+                // Four cells at a time away from obstacles and the wrap-around
+                if ((col >= 1) && (col + 4 <= SDL_min(col1, cols-1)) &&
+                    (memcpy(&any_solid, lbm->parity ? &lbm->near_solid[i] : &lbm->solid[i], 4),
+                     any_solid == 0))
+                {
+                    f32x4 f[9];
+                    if (lbm->parity == 0)
+                    {
+                        for (int d=0; d < 9; d++) memcpy(&f[d], &lbm->f[d][i], sizeof(f32x4));
+                        LbmCollide(f);
+                        for (int d=0; d < 9; d++) memcpy(&lbm->f[lbm_opp[d]][i], &f[d], sizeof(f32x4));
+                    }
+                    else
+                    {
+                        for (int d=0; d < 9; d++)
+                        {
+                            int j = i - lbm_dr[d]*cols - lbm_dc[d];
+                            memcpy(&f[d], &lbm->f[lbm_opp[d]][j], sizeof(f32x4));
+                        }
+                        LbmCollide(f);
+                        for (int d=0; d < 9; d++)
+                        {
+                            int j = i + lbm_dr[d]*cols + lbm_dc[d];
+                            memcpy(&lbm->f[d][j], &f[d], sizeof(f32x4));
+                        }
+                    }
+                    col += 4;
+                }
+                else
+                {
+                    if (!lbm->solid[i])
+                    {
+                        if (lbm->parity == 0) LbmEvenCell(lbm, i);
+                        else LbmOddCell(lbm, row, col);
+                    }
+                    col++;
+                }
+            }
+        }
+    }
+}
+
+/**
+ *  \brief Advance the flow one step
+ */
+internal void LbmStep(lbm_t *lbm, thread_pool_t *pool)
+{
+    int blocks = ((lbm->rows + LBM_BLOCK_ROWS-1)/LBM_BLOCK_ROWS) *
+                 ((lbm->cols + LBM_BLOCK_COLS-1)/LBM_BLOCK_COLS);
+    ParallelFor(pool, blocks, 1, LbmBlockJob, lbm);
+    lbm->parity ^= 1;
+    lbm->steps++;
+}
+
+/**
+ *  \brief Flow velocity in a cell, in cells per step
+ */
+internal void LbmVelocity(lbm_t *lbm, int row, int col, float *u, float *v)
+{
+    int i = row*lbm->cols + col;
+    float f[9];
+    for (int d=0; d < 9; d++)
+    {
+        // After an even step each population sits in its opposite slot
+        f[d] = lbm->parity ? lbm->f[lbm_opp[d]][i] : lbm->f[d][i];
+    }
+    float rho = f[0]+f[1]+f[2]+f[3]+f[4]+f[5]+f[6]+f[7]+f[8];
+    *u = (f[2]+f[5]+f[6] - f[4]-f[7]-f[8]) / rho;
+    *v = (f[1]+f[5]+f[8] - f[3]-f[6]-f[7]) / rho;
+}
+
+/**
+ *  \brief Headless benchmark: flow past a cylinder, reports MLUPS
+ *
+ *  momentum.exe --lbm [rows] [cols] [steps]
+ */
+internal int LbmBenchmark(int argc, char **argv)
+{
+    int rows  = (argc > 0) ? atoi(argv[0]) : 1024;
+    int cols  = (argc > 1) ? atoi(argv[1]) : 2048;
+    int steps = (argc > 2) ? atoi(argv[2]) : 100;
+    steps += steps & 1; // whole even/odd pairs
+
+    thread_pool_t pool;
+    ThreadPoolInit(&pool, 0);
+    lbm_t lbm;
+    arena_t arena = {0};
+    ARENA_SIZED(&arena, LbmInit(&lbm, rows, cols, &arena));
+    u8 *solid = (u8*) calloc((size_t)rows*cols, 1);
+    assert(solid);
+    int radius = rows/8;
+    for (int row=0; row < rows; row++)
+        for (int col=0; col < cols; col++)
+        {
+            int dr = row - rows/2, dc = col - cols/4;
+            solid[row*cols + col] = (dr*dr + dc*dc <= radius*radius);
+        }
+    LbmSetSolid(&lbm, solid);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int s=0; s < steps; s++) LbmStep(&lbm, &pool);
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    float u, v;
+    LbmVelocity(&lbm, rows/2, 3*cols/4, &u, &v);
+    printf("%dx%d D2Q9, %d steps on %d threads: %.1f MLUPS (wake velocity %.2g, %.2g)\n",
+            cols, rows, steps, pool.num_threads,
+            (double)rows*cols*steps / seconds / 1e6, u, v);
+    free(solid);
+    ArenaFree(&arena);
+    ThreadPoolFree(&pool);
+    return 0;
+}
+
+// ------------------
+// | Heat Diffusion |
+// ------------------
+
+// A temperature per pixel that spreads each tick (explicit 5-point stencil,
+// insulated edges) and slowly leaks away. Projectiles heat the cell they are
+// in and rise while it is hot; the player is a cold plate.
+//
+// HeatStep() runs several ticks per pass over memory (temporal blocking).
+// Each thread takes a tile plus a halo of one cell per tick on every side,
+// and advances it tick after tick in two small scratch buffers, so the halo
+// shrinks by a cell per tick and only the tile itself goes back out. Halo
+// cells get computed by neighboring tiles too; that redundant work is cheap
+// next to streaming the whole grid through memory once per tick.
+#define HEAT_ALPHA 0.2f          // diffusion per tick, stable up to 0.25
+#define HEAT_KEEP 0.995f         // fraction not lost to the air each tick
+#define HEAT_SOURCE 0.05f        // added by a projectile each tick
+#define HEAT_BUOYANCY 0.02f      // upward acceleration per unit of temperature
+#define HEAT_TIME_BLOCK 8        // most ticks per pass over memory
+#define HEAT_TILE_ROWS 64
+#define HEAT_TILE_COLS 256       // tile plus halo, twice over, fits an L2
+#define HEAT_SCRATCH_ROWS (HEAT_TILE_ROWS + 2*HEAT_TIME_BLOCK)
+#define HEAT_SCRATCH_COLS (HEAT_TILE_COLS + 2*HEAT_TIME_BLOCK)
+
+typedef struct
+{
+    int rows, cols;
+    float *t, *next;
+    int num_threads;
+    float *scratch[MAX_THREADS][2]; // ping-pong, tile plus halo each
+} heat_t;
+
+typedef struct
+{
+    heat_t *heat;
+    int ticks;
+} heat_job_t;
+
+internal void HeatInit(heat_t *heat, int rows, int cols, int num_threads, arena_t *arena)
+{
+    memset(heat, 0, sizeof(*heat));
+    heat->rows = rows;
+    heat->cols = cols;
+    heat->num_threads = num_threads;
+    heat->t = (float*) ArenaPush(arena, (size_t)rows*cols * sizeof(float));
+    heat->next = (float*) ArenaPush(arena, (size_t)rows*cols * sizeof(float));
+    for (int t=0; t < num_threads; t++)
+        for (int k=0; k < 2; k++)
+        {
+            heat->scratch[t][k] = (float*) ArenaPush(arena,
+                    HEAT_SCRATCH_ROWS*HEAT_SCRATCH_COLS * sizeof(float));
+        }
+}
+
+/**
+ *  \brief One tick of a run of `n` cells in a row
+ *
+ *  Pointers are at the run's first cell. mid[-1] and mid[n] are read unless
+ *  the run touches that edge of the grid, where the cell sees itself instead
+ *  and no heat flows out.
+ */
+internal void HeatSpan(float *out, const float *up, const float *mid, const float *down,
+        int n, bool left_edge, bool right_edge)
+{
+    const f32x4 alpha = {HEAT_ALPHA, HEAT_ALPHA, HEAT_ALPHA, HEAT_ALPHA};
+    const f32x4 keep = {HEAT_KEEP, HEAT_KEEP, HEAT_KEEP, HEAT_KEEP};
+    const f32x4 four = {4, 4, 4, 4};
+    int first = 0, last = n;
+    if (left_edge)
+    {
+        float right = (n > 1) ? mid[1] : mid[0];
+        out[0] = HEAT_KEEP*(mid[0] + HEAT_ALPHA*(up[0] + down[0] + right - 3*mid[0]));
+        first = 1;
+    }
+    if (right_edge && (last > first))
+    {
+        last = n-1;
+        out[last] = HEAT_KEEP*(mid[last] + HEAT_ALPHA*(up[last] + down[last] + mid[last-1] - 3*mid[last]));
+    }
+    int col = first;
+    for (; col + 4 <= last; col += 4)
+    {
+        f32x4 u, d, l, c, r, o;
+        memcpy(&u, up + col, sizeof(u));
+        memcpy(&d, down + col, sizeof(d));
+        memcpy(&l, mid + col - 1, sizeof(l));
+        memcpy(&c, mid + col, sizeof(c));
+        memcpy(&r, mid + col + 1, sizeof(r));
+        o = keep*(c + alpha*(u + d + l + r - four*c));
+        memcpy(out + col, &o, sizeof(o));
+    }
+    for (; col < last; col++)
+    {
+        out[col] = HEAT_KEEP*(mid[col] + HEAT_ALPHA*(up[col] + down[col] + mid[col-1] + mid[col+1] - 4*mid[col]));
+    }
+}
+
+internal void HeatTileJob(void *data, int begin, int end, int thread)
+{
+    heat_job_t *job = (heat_job_t*) data;
+    heat_t *heat = job->heat;
+    int rows = heat->rows, cols = heat->cols, ticks = job->ticks;
+    int tiles_across = (cols + HEAT_TILE_COLS - 1) / HEAT_TILE_COLS;
+    for (int tile=begin; tile < end; tile++)
+    {
+        int r0 = (tile / tiles_across) * HEAT_TILE_ROWS, r1 = SDL_min(r0 + HEAT_TILE_ROWS, rows);
+        int c0 = (tile % tiles_across) * HEAT_TILE_COLS, c1 = SDL_min(c0 + HEAT_TILE_COLS, cols);
+        int row_base = r0 - ticks, col_base = c0 - ticks; // grid cell of scratch 0,0
+        for (int s=1; s <= ticks; s++)
+        {
+            // Tick s is valid on the tile plus (ticks - s) halo cells
+            int halo = ticks - s;
+            int lo = SDL_max(r0 - halo, 0), hi = SDL_min(r1 + halo, rows);
+            int left = SDL_max(c0 - halo, 0), right = SDL_min(c1 + halo, cols);
+            const float *src = heat->scratch[thread][(s-1) & 1];
+            float *dst = heat->scratch[thread][s & 1];
+            for (int g=lo; g < hi; g++)
+            {
+                int up = SDL_max(g-1, 0), down = SDL_min(g+1, rows-1);
+                const float *src_up, *src_mid, *src_down;
+                if (s == 1)
+                {
+                    src_up = heat->t + (size_t)up*cols + left;
+                    src_mid = heat->t + (size_t)g*cols + left;
+                    src_down = heat->t + (size_t)down*cols + left;
+                }
+                else
+                {
+                    src_up = src + (up - row_base)*HEAT_SCRATCH_COLS + (left - col_base);
+                    src_mid = src + (g - row_base)*HEAT_SCRATCH_COLS + (left - col_base);
+                    src_down = src + (down - row_base)*HEAT_SCRATCH_COLS + (left - col_base);
+                }
+                float *out = (s == ticks) ? heat->next + (size_t)g*cols + left
+                           : dst + (g - row_base)*HEAT_SCRATCH_COLS + (left - col_base);
+                HeatSpan(out, src_up, src_mid, src_down, right - left, left == 0, right == cols);
+            }
+        }
+    }
+}
+
+/**
+ *  \brief Diffuse for `ticks` ticks, HEAT_TIME_BLOCK ticks per pass
+ */
+internal void HeatStep(heat_t *heat, thread_pool_t *pool, int ticks)
+{
+    assert(pool->num_threads <= heat->num_threads);
+    int tiles = ((heat->rows + HEAT_TILE_ROWS - 1) / HEAT_TILE_ROWS)
+              * ((heat->cols + HEAT_TILE_COLS - 1) / HEAT_TILE_COLS);
+    while (ticks > 0)
+    {
+        heat_job_t job = {heat, SDL_min(ticks, HEAT_TIME_BLOCK)};
+        ParallelFor(pool, tiles, 1, HeatTileJob, &job);
+        float *tmp = heat->t;
+        heat->t = heat->next;
+        heat->next = tmp;
+        ticks -= job.ticks;
+    }
+}
+
+/**
+ *  \brief Projectiles heat their cell and float up on it; the player cools
+ */
+internal void HeatCouple(heat_t *heat, u32 *frame, momentum_t *momentum_buffer, rect_t player)
+{
+    assert((heat->rows == SCREEN_HEIGHT) && (heat->cols == SCREEN_WIDTH));
+    for (int row=0; row < SCREEN_HEIGHT; row++)
+        for (int col=0; col < SCREEN_WIDTH; col++)
+        {
+            if (ColorAt(row, col, frame) != PROJECTILE_COLOR) continue;
+            int i = row*SCREEN_WIDTH + col;
+            heat->t[i] += HEAT_SOURCE;
+            momentum_buffer[i].dx -= HEAT_BUOYANCY*heat->t[i];
+        }
+    for (int row=SDL_max(player.x, 0); row < SDL_min(player.x + player.h, SCREEN_HEIGHT); row++)
+        for (int col=SDL_max(player.y, 0); col < SDL_min(player.y + player.w, SCREEN_WIDTH); col++)
+        {
+            heat->t[row*SCREEN_WIDTH + col] = 0;
+        }
+}
+
+/**
+ *  \brief Headless benchmark: a hot spot spreading, one tick per pass or blocked
+ *
+ *  momentum.exe --heat [rows] [cols] [ticks] [ticks per pass]
+ */
+internal int HeatBenchmark(int argc, char **argv)
+{
+    int rows  = (argc > 0) ? atoi(argv[0]) : 4096;
+    int cols  = (argc > 1) ? atoi(argv[1]) : 4096;
+    int ticks = (argc > 2) ? atoi(argv[2]) : 64;
+    int block = (argc > 3) ? atoi(argv[3]) : HEAT_TIME_BLOCK;
+    block = SDL_max(1, SDL_min(block, HEAT_TIME_BLOCK));
+
+    thread_pool_t pool;
+    ThreadPoolInit(&pool, 0);
+    heat_t heat;
+    arena_t arena = {0};
+    ARENA_SIZED(&arena, HeatInit(&heat, rows, cols, pool.num_threads, &arena));
+    heat.t[(rows/2)*cols + cols/2] = 1e6f;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int done=0; done < ticks; done += block) HeatStep(&heat, &pool, SDL_min(block, ticks - done));
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    double total = 0;
+    for (size_t i=0; i < (size_t)rows*cols; i++) total += heat.t[i];
+    printf("%dx%d heat, %d ticks at %d per pass on %d threads: %.2f Gcell-ticks/s (total %.6g)\n",
+            cols, rows, ticks, block, pool.num_threads,
+            (double)rows*cols*ticks / seconds / 1e9, total);
+    ArenaFree(&arena);
+    ThreadPoolFree(&pool);
+    return 0;
+}
+
+// -----------------
+// | Particle Mesh |
+// -----------------
+
+// Long-range forces (gravity, or electrostatics with the sign flipped) for
+// huge particle counts. Each step:
+//  1. deposit particle mass onto an n x n periodic grid (cloud-in-cell)
+//  2. solve Poisson's equation for the potential with a real-to-complex FFT
+//  3. interpolate the force (minus the potential gradient) back to particles
+// Every stage runs on the thread pool. Deposits go to per-thread grids that
+// are summed afterward, like the heatmap counts.
+#define PM_G 0.0005f // attraction strength (4 pi G), negative to repel
+#define CLOUD_COLOR 0xFFFFE0A0 // opaque pale yellow
+
+typedef struct
+{
+    float re, im;
+} complex_t;
+
+// ---Radix-2 FFT---
+
+typedef struct
+{
+    int n;
+    complex_t *twiddle; // e^(-2 pi i k/n) for k < n/2
+    int *bit_reverse;
+} fft_t;
+
+internal void FftInit(fft_t *fft, int n, arena_t *arena)
+{
+    assert((n >= 2) && ((n & (n-1)) == 0)); // power of two
+    fft->n = n;
+    fft->twiddle = (complex_t*) ArenaPush(arena, n/2 * sizeof(complex_t));
+    fft->bit_reverse = (int*) ArenaPush(arena, n * sizeof(int));
+    if (!arena->base) return; // only counting
+    for (int k=0; k < n/2; k++)
+    {
+        double angle = -2*3.14159265358979323846*k/n;
+        fft->twiddle[k].re = (float)SDL_cos(angle);
+        fft->twiddle[k].im = (float)SDL_sin(angle);
+    }
+    int bits = 0;
+    while ((1 << bits) < n) bits++;
+    for (int i=0; i < n; i++)
+    {
+        int r = 0;
+        for (int b=0; b < bits; b++) r |= ((i >> b) & 1) << (bits-1-b);
+        fft->bit_reverse[i] = r;
+    }
+}
+
+/**
+ *  \brief In-place complex FFT of length fft->n, unscaled either way
+ */
+internal void Fft(fft_t *fft, complex_t *data, bool inverse)
+{
+    int n = fft->n;
+    for (int i=0; i < n; i++)
+    {
+        int j = fft->bit_reverse[i];
+        if (i < j) { complex_t t = data[i]; data[i] = data[j]; data[j] = t; }
+    }
+    for (int len=2; len <= n; len *= 2)
+    {
+        int half = len/2, stride = n/len;
+        for (int i=0; i < n; i += len)
+            for (int j=0; j < half; j++)
+            {
+                complex_t w = fft->twiddle[j*stride];
+                if (inverse) w.im = -w.im;
+                complex_t a = data[i+j], b = data[i+j+half];
+                complex_t wb = {w.re*b.re - w.im*b.im, w.re*b.im + w.im*b.re};
+                data[i+j].re = a.re + wb.re;
+                data[i+j].im = a.im + wb.im;
+                data[i+j+half].re = a.re - wb.re;
+                data[i+j+half].im = a.im - wb.im;
+            }
+    }
+}
+
+// ---Particle mesh---
+
+typedef struct
+{
+    int n;                         // grid is n x n, periodic
+    int num_threads;
+    float *deposit[MAX_THREADS];   // per-thread mass
+    float *rho;                    // mass, then potential (in place)
+    complex_t *spectrum;           // n rows of n/2+1 (real input: half is enough)
+    float *green;                  // potential per unit mass, n rows of n/2+1
+    float *force_x, *force_y;      // minus the potential gradient
+    complex_t *scratch[MAX_THREADS]; // one row or column per thread
+    fft_t fft;
+} pm_t;
+
+typedef struct
+{
+    pm_t *pm;
+    momentum_t *particles;
+} pm_job_t;
+
+internal void PmInit(pm_t *pm, int n, int num_threads, arena_t *arena)
+{
+    memset(pm, 0, sizeof(*pm));
+    pm->n = n;
+    pm->num_threads = num_threads;
+    size_t cells = (size_t)n*n;
+    int half = n/2 + 1;
+    for (int t=0; t < num_threads; t++)
+    {
+        pm->deposit[t] = (float*) ArenaPush(arena, cells * sizeof(float));
+        pm->scratch[t] = (complex_t*) ArenaPush(arena, n * sizeof(complex_t));
+    }
+    pm->rho = (float*) ArenaPush(arena, cells * sizeof(float));
+    pm->force_x = (float*) ArenaPush(arena, cells * sizeof(float));
+    pm->force_y = (float*) ArenaPush(arena, cells * sizeof(float));
+    pm->spectrum = (complex_t*) ArenaPush(arena, (size_t)n*half * sizeof(complex_t));
+    pm->green = (float*) ArenaPush(arena, (size_t)n*half * sizeof(float));
+    FftInit(&pm->fft, n, arena);
+    if (!arena->base) return; // only counting
+
+    // Inverse of the 5-point Laplacian in Fourier space, times -PM_G, with the
+    // 1/n^2 the unscaled inverse FFTs leave behind folded in.
+    for (int r=0; r < n; r++)
+        for (int k=0; k < half; k++)
+        {
+            double sr = SDL_sin(3.14159265358979323846*r/n);
+            double sk = SDL_sin(3.14159265358979323846*k/n);
+            double k2 = 4*(sr*sr + sk*sk);
+            pm->green[r*half + k] = (k2 > 0) ? (float)(-PM_G/(k2*n*n)) : 0;
+        }
+}
+
+/**
+ *  \brief Cloud-in-cell: cell and weights of the four grid points around x,y
+ */
+inline internal void PmCloud(int n, float x, float y, int *r0, int *c0, int *r1, int *c1, float *fx, float *fy)
+{
+    *r0 = (int)x; *c0 = (int)y;
+    *fx = x - *r0; *fy = y - *c0;
+    *r0 &= n-1; *c0 &= n-1;
+    *r1 = (*r0 + 1) & (n-1);
+    *c1 = (*c0 + 1) & (n-1);
+}
+
+internal void PmDepositJob(void *data, int begin, int end, int thread)
+{
+    pm_job_t *job = (pm_job_t*) data;
+    int n = job->pm->n;
+    float *grid = job->pm->deposit[thread];
+    for (int i=begin; i < end; i++)
+    {
+        int r0, c0, r1, c1;
+        float fx, fy;
+        PmCloud(n, job->particles[i].x, job->particles[i].y, &r0, &c0, &r1, &c1, &fx, &fy);
+        grid[r0*n + c0] += (1-fx)*(1-fy);
+        grid[r0*n + c1] += (1-fx)*fy;
+        grid[r1*n + c0] += fx*(1-fy);
+        grid[r1*n + c1] += fx*fy;
+    }
+}
+
+internal void PmMergeJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    pm_t *pm = ((pm_job_t*) data)->pm;
+    for (int i=begin; i < end; i++)
+    {
+        float sum = 0;
+        for (int t=0; t < pm->num_threads; t++)
+        {
+            sum += pm->deposit[t][i];
+            pm->deposit[t][i] = 0;
+        }
+        pm->rho[i] = sum;
+    }
+}
+
+/**
+ *  \brief Real-to-complex FFT of rows 2*pair and 2*pair+1 at once
+ *
+ *  Two real rows ride in one complex FFT as real and imaginary parts, then
+ *  get separated using the symmetry of a real signal's spectrum.
+ */
+internal void PmRowsForwardJob(void *data, int begin, int end, int thread)
+{
+    pm_t *pm = ((pm_job_t*) data)->pm;
+    int n = pm->n, half = n/2 + 1;
+    complex_t *z = pm->scratch[thread];
+    for (int pair=begin; pair < end; pair++)
+    {
+        float *a = &pm->rho[(2*pair)*n], *b = &pm->rho[(2*pair+1)*n];
+        for (int j=0; j < n; j++) { z[j].re = a[j]; z[j].im = b[j]; }
+        Fft(&pm->fft, z, false);
+        complex_t *x = &pm->spectrum[(2*pair)*half], *y = &pm->spectrum[(2*pair+1)*half];
+        for (int k=0; k < half; k++)
+        {
+            complex_t zk = z[k], zn = z[(n-k) & (n-1)];
+            x[k].re = 0.5f*(zk.re + zn.re);
+            x[k].im = 0.5f*(zk.im - zn.im);
+            y[k].re = 0.5f*(zk.im + zn.im);
+            y[k].im = -0.5f*(zk.re - zn.re);
+        }
+    }
+}
+
+/**
+ *  \brief Column FFT, multiply by the Green's function, inverse column FFT
+ */
+internal void PmColumnsJob(void *data, int begin, int end, int thread)
+{
+    pm_t *pm = ((pm_job_t*) data)->pm;
+    int n = pm->n, half = n/2 + 1;
+    complex_t *z = pm->scratch[thread];
+    for (int k=begin; k < end; k++)
+    {
+        for (int r=0; r < n; r++) z[r] = pm->spectrum[r*half + k];
+        Fft(&pm->fft, z, false);
+        for (int r=0; r < n; r++)
+        {
+            float g = pm->green[r*half + k];
+            z[r].re *= g;
+            z[r].im *= g;
+        }
+        Fft(&pm->fft, z, true);
+        for (int r=0; r < n; r++) pm->spectrum[r*half + k] = z[r];
+    }
+}
+
+/**
+ *  \brief Complex-to-real inverse FFT of two rows at once, into `rho`
+ */
+internal void PmRowsInverseJob(void *data, int begin, int end, int thread)
+{
+    pm_t *pm = ((pm_job_t*) data)->pm;
+    int n = pm->n, half = n/2 + 1;
+    complex_t *z = pm->scratch[thread];
+    for (int pair=begin; pair < end; pair++)
+    {
+        complex_t *x = &pm->spectrum[(2*pair)*half], *y = &pm->spectrum[(2*pair+1)*half];
+        for (int k=0; k < n; k++)
+        {
+            // Upper half of a real signal's spectrum mirrors the lower half
+            complex_t xk = (k < half) ? x[k] : x[n-k];
+            complex_t yk = (k < half) ? y[k] : y[n-k];
+            if (k >= half) { xk.im = -xk.im; yk.im = -yk.im; }
+            z[k].re = xk.re - yk.im;
+            z[k].im = xk.im + yk.re;
+        }
+        Fft(&pm->fft, z, true);
+        float *a = &pm->rho[(2*pair)*n], *b = &pm->rho[(2*pair+1)*n];
+        for (int j=0; j < n; j++) { a[j] = z[j].re; b[j] = z[j].im; }
+    }
+}
+
+internal void PmGradientJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    pm_t *pm = ((pm_job_t*) data)->pm;
+    int n = pm->n;
+    const float *phi = pm->rho;
+    for (int r=begin; r < end; r++)
+    {
+        int up = ((r-1) & (n-1))*n, down = ((r+1) & (n-1))*n;
+        for (int c=0; c < n; c++)
+        {
+            int left = (c-1) & (n-1), right = (c+1) & (n-1);
+            pm->force_x[r*n + c] = -0.5f*(phi[down + c] - phi[up + c]);
+            pm->force_y[r*n + c] = -0.5f*(phi[r*n + right] - phi[r*n + left]);
+        }
+    }
+}
+
+internal void PmKickDriftJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    pm_job_t *job = (pm_job_t*) data;
+    pm_t *pm = job->pm;
+    int n = pm->n;
+    for (int i=begin; i < end; i++)
+    {
+        momentum_t p = job->particles[i];
+        int r0, c0, r1, c1;
+        float fx, fy;
+        PmCloud(n, p.x, p.y, &r0, &c0, &r1, &c1, &fx, &fy);
+        float w00 = (1-fx)*(1-fy), w01 = (1-fx)*fy, w10 = fx*(1-fy), w11 = fx*fy;
+        p.dx += w00*pm->force_x[r0*n + c0] + w01*pm->force_x[r0*n + c1]
+              + w10*pm->force_x[r1*n + c0] + w11*pm->force_x[r1*n + c1];
+        p.dy += w00*pm->force_y[r0*n + c0] + w01*pm->force_y[r0*n + c1]
+              + w10*pm->force_y[r1*n + c0] + w11*pm->force_y[r1*n + c1];
+        p.x += p.dx;
+        p.y += p.dy;
+        // Wrap around, and keep clear of n itself after float rounding
+        p.x -= n*SDL_floorf(p.x/n);
+        p.y -= n*SDL_floorf(p.y/n);
+        if (p.x >= n) p.x = 0;
+        if (p.y >= n) p.y = 0;
+        job->particles[i] = p;
+    }
+}
+
+/**
+ *  \brief Advance particles one tick under their own gravity
+ *
+ *  \param particles    Positions in grid cells, inside [0, n)
+ */
+internal void PmStep(pm_t *pm, thread_pool_t *pool, momentum_t *particles, int count)
+{
+    assert(pool->num_threads <= pm->num_threads);
+    pm_job_t job = {pm, particles};
+    int n = pm->n;
+    ParallelFor(pool, count, 1 << 16, PmDepositJob, &job);
+    ParallelFor(pool, n*n, 1 << 14, PmMergeJob, &job);
+    ParallelFor(pool, n/2, 4, PmRowsForwardJob, &job);
+    ParallelFor(pool, n/2 + 1, 4, PmColumnsJob, &job);
+    ParallelFor(pool, n/2, 4, PmRowsInverseJob, &job);
+    ParallelFor(pool, n, 8, PmGradientJob, &job);
+    ParallelFor(pool, count, 1 << 16, PmKickDriftJob, &job);
+}
+
+/**
+ *  \brief Headless benchmark: a cloud collapsing under its own gravity
+ *
+ *  momentum.exe --pm [particles] [grid] [ticks]
+ */
+internal int PmBenchmark(int argc, char **argv)
+{
+    int count = (argc > 0) ? atoi(argv[0]) : 10000000;
+    int n     = (argc > 1) ? atoi(argv[1]) : 512;
+    int ticks = (argc > 2) ? atoi(argv[2]) : 10;
+
+    thread_pool_t pool;
+    ThreadPoolInit(&pool, 0);
+    pm_t pm;
+    arena_t arena = {0};
+    ARENA_SIZED(&arena, PmInit(&pm, n, pool.num_threads, &arena));
+    momentum_t *particles = (momentum_t*) calloc(count, sizeof(momentum_t));
+    assert(particles);
+    for (int i=0; i < count; i++)
+    {
+        float r[2];
+        for (int k=0; k < 2; k++) r[k] = RngUnit(RngU32(1, 0, i, k));
+        // A square cloud in the middle half of the box
+        momentum_t p = {n*(0.25f + 0.5f*r[0]), n*(0.25f + 0.5f*r[1]), 0, 0};
+        particles[i] = p;
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int tick=0; tick < ticks; tick++) PmStep(&pm, &pool, particles, count);
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    printf("%d particles on a %dx%d mesh, %d threads: %.1f ms per tick\n",
+            count, n, n, pool.num_threads, 1000.0*seconds/ticks);
+    free(particles);
+    ArenaFree(&arena);
+    ThreadPoolFree(&pool);
+    return 0;
+}
+
+// ----------------------
+// | Cellular Automaton |
+// ----------------------
+
+// Life-like rules (B3/S23 is Conway's Life) on a bit-packed layer: one bit
+// per cell, 64 cells to a word, and four words to a vector so each bitwise
+// instruction updates 256 cells (64 or 128 on narrower SIMD). Neighbor counts
+// come from bit-sliced adders: the eight neighbor masks are summed into four
+// bit planes (1s, 2s, 4s, 8s) with full adders made of AND/XOR/OR, and the
+// rule is a handful of masks over those planes. Threads take bands of rows.
+//
+// Rows carry a dead word on either side and the grid a dead row above and
+// below, so every cell sees neighbors without edge cases. Indexing is size_t:
+// grids of billions of cells fit if memory does (1 bit each, two buffers).
+#define LIFE_COLOR 0xFF60C0FF // opaque sky blue
+
+typedef struct
+{
+    int rows, cols;
+    int words;          // u64 words per row, a whole number of vectors
+    size_t stride;      // words per stored row: dead word, words, dead word
+    u64 *cells, *next;  // (rows+2) x stride, border always dead
+    u16 birth, survive; // bit n: rule fires with n live neighbors
+} life_t;
+
+/**
+ *  \brief Parse a rule string like "B3/S23" (case-insensitive)
+ *
+ *  \return false if the string is not of that form
+ */
+internal bool LifeParseRule(const char *rule, u16 *birth, u16 *survive)
+{
+    *birth = 0;
+    *survive = 0;
+    if ((*rule != 'B') && (*rule != 'b')) return false;
+    for (rule++; (*rule >= '0') && (*rule <= '8'); rule++) *birth |= 1 << (*rule - '0');
+    if (*rule++ != '/') return false;
+    if ((*rule != 'S') && (*rule != 's')) return false;
+    for (rule++; (*rule >= '0') && (*rule <= '8'); rule++) *survive |= 1 << (*rule - '0');
+    return *rule == '\0';
+}
+
+internal void LifeInit(life_t *life, int rows, int cols, const char *rule, arena_t *arena)
+{
+    memset(life, 0, sizeof(*life));
+    life->rows = rows;
+    life->cols = cols;
+    life->words = ((cols + 255) / 256) * 4;
+    life->stride = life->words + 2;
+    size_t size = (size_t)(rows + 2) * life->stride;
+    life->cells = (u64*) ArenaPush(arena, size * sizeof(u64));
+    life->next = (u64*) ArenaPush(arena, size * sizeof(u64));
+    bool parsed = LifeParseRule(rule, &life->birth, &life->survive);
+    assert(parsed);
+    (void)parsed;
+}
+
+/**
+ *  \brief Word holding a cell, and the cell's bit in it
+ */
+inline internal u64 *LifeWord(const life_t *life, u64 *cells, int row, int col, u64 *bit)
+{
+    *bit = (u64)1 << (col & 63);
+    return &cells[(size_t)(row + 1)*life->stride + 1 + (col >> 6)];
+}
+
+inline internal bool LifeAt(const life_t *life, int row, int col)
+{
+    u64 bit;
+    return (*LifeWord(life, life->cells, row, col, &bit) & bit) != 0;
+}
+
+inline internal void LifeSet(life_t *life, int row, int col, bool alive)
+{
+    u64 bit;
+    u64 *word = LifeWord(life, life->cells, row, col, &bit);
+    *word = alive ? (*word | bit) : (*word & ~bit);
+}
+
+/**
+ *  \brief Four words of a row, starting one word left (-1), at (0), or right (+1)
+ */
+#define LIFE_LOAD(v, row, w) memcpy(&(v), (row) + (w), sizeof(v))
+
+inline internal void LifeFullAdd(u64x4 a, u64x4 b, u64x4 c, u64x4 *sum, u64x4 *carry)
+{
+    u64x4 ab = a ^ b;
+    *sum = ab ^ c;
+    *carry = (a & b) | (ab & c);
+}
+
+internal void LifeRowsJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    life_t *life = (life_t*) data;
+    const u64x4 zero = {0}, ones = ~zero;
+    // Rule as masks: with n neighbors a dead cell becomes born[n], a live one
+    // stays alive if keep[n]; counts with neither never set a bit
+    u64x4 born[9], keep[9];
+    for (int n=0; n < 9; n++)
+    {
+        born[n] = ((life->birth >> n) & 1) ? ones : zero;
+        keep[n] = ((life->survive >> n) & 1) ? ones : zero;
+    }
+    u16 any = life->birth | life->survive;
+    // Bits past the last column stay dead
+    int full_words = life->cols / 64;
+    u64 partial = (life->cols & 63) ? (((u64)1 << (life->cols & 63)) - 1) : 0;
+
+    for (int row=begin; row < end; row++)
+    {
+        const u64 *up = life->cells + (size_t)row*life->stride + 1;
+        const u64 *mid = up + life->stride, *down = mid + life->stride;
+        u64 *out = life->next + (size_t)(row + 1)*life->stride + 1;
+        for (int w=0; w < life->words; w += 4)
+        {
+            // Column c's west neighbor is bit c-1: shift up, carry in from the left word
+            u64x4 n[8], a, a_west, a_east, c, c_west, c_east, b, b_west, b_east;
+            LIFE_LOAD(a, up, w);   LIFE_LOAD(a_west, up, w-1);   LIFE_LOAD(a_east, up, w+1);
+            LIFE_LOAD(c, mid, w);  LIFE_LOAD(c_west, mid, w-1);  LIFE_LOAD(c_east, mid, w+1);
+            LIFE_LOAD(b, down, w); LIFE_LOAD(b_west, down, w-1); LIFE_LOAD(b_east, down, w+1);
+            n[0] = (a << 1) | (a_west >> 63);
+            n[1] = a;
+            n[2] = (a >> 1) | (a_east << 63);
+            n[3] = (c << 1) | (c_west >> 63);
+            n[4] = (c >> 1) | (c_east << 63);
+            n[5] = (b << 1) | (b_west >> 63);
+            n[6] = b;
+            n[7] = (b >> 1) | (b_east << 63);
+
+            // Eight one-bit numbers down to a four-bit count
+            u64x4 s0, s1, s2, c0, c1, c2, ones_bit, c3, t, c4, twos_bit;
+            LifeFullAdd(n[0], n[1], n[2], &s0, &c0);
+            LifeFullAdd(n[3], n[4], n[5], &s1, &c1);
+            s2 = n[6] ^ n[7];
+            c2 = n[6] & n[7];
+            LifeFullAdd(s0, s1, s2, &ones_bit, &c3);
+            LifeFullAdd(c0, c1, c2, &t, &c4);
+            twos_bit = t ^ c3;
+            u64x4 c5 = t & c3;
+            u64x4 fours_bit = c4 ^ c5;
+            u64x4 eights_bit = c4 & c5;
+
+            u64x4 next = zero;
+            for (int count=0; count < 9; count++)
+            {
+                if (!((any >> count) & 1)) continue;
+                u64x4 eq = ((count & 1) ? ones_bit : ~ones_bit)
+                         & ((count & 2) ? twos_bit : ~twos_bit)
+                         & ((count & 4) ? fours_bit : ~fours_bit)
+                         & ((count & 8) ? eights_bit : ~eights_bit);
+                next |= eq & ((c & keep[count]) | (~c & born[count]));
+            }
+            memcpy(out + w, &next, sizeof(next));
+        }
+        if (full_words < life->words)
+        {
+            out[full_words] &= partial;
+            for (int w=full_words+1; w < life->words; w++) out[w] = 0;
+        }
+    }
+}
+
+internal void LifeStep(life_t *life, thread_pool_t *pool)
+{
+    ParallelFor(pool, life->rows, 16, LifeRowsJob, life);
+    u64 *tmp = life->cells;
+    life->cells = life->next;
+    life->next = tmp;
+}
+
+/**
+ *  \brief Live cells, by popcount
+ */
+internal size_t LifePopulation(const life_t *life)
+{
+    size_t count = 0;
+    for (int row=0; row < life->rows; row++)
+    {
+        const u64 *words = life->cells + (size_t)(row + 1)*life->stride + 1;
+        for (int w=0; w < life->words; w++) count += __builtin_popcountll(words[w]);
+    }
+    return count;
+}
+
+/**
+ *  \brief Headless benchmark: random soup under a rule
+ *
+ *  momentum.exe --life [rows] [cols] [generations] [rule]
+ */
+internal int LifeBenchmark(int argc, char **argv)
+{
+    int rows  = (argc > 0) ? atoi(argv[0]) : 16384;
+    int cols  = (argc > 1) ? atoi(argv[1]) : 16384;
+    int gens  = (argc > 2) ? atoi(argv[2]) : 20;
+    const char *rule = (argc > 3) ? argv[3] : "B3/S23";
+    u16 birth, survive;
+    if (!LifeParseRule(rule, &birth, &survive))
+    {
+        printf("Rule should look like B3/S23, not %s\n", rule);
+        return 1;
+    }
+
+    thread_pool_t pool;
+    ThreadPoolInit(&pool, 0);
+    life_t life;
+    arena_t arena = {0};
+    ARENA_SIZED(&arena, LifeInit(&life, rows, cols, rule, &arena));
+    for (int row=0; row < rows; row++)
+    {
+        u64 *words = life.cells + (size_t)(row + 1)*life.stride + 1;
+        for (int w=0; w < (cols + 63)/64; w++)
+        {
+            u64 bits = (u64)RngU32(1, 0, row, 2*w) << 32 | RngU32(1, 0, row, 2*w + 1);
+            words[w] = bits & (bits >> 1); // about a quarter alive
+        }
+        if (cols & 63) words[cols/64] &= ((u64)1 << (cols & 63)) - 1;
+    }
+    size_t before = LifePopulation(&life);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int gen=0; gen < gens; gen++) LifeStep(&life, &pool);
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    printf("%s on %dx%d, %d generations on %d threads: %.2f Gcell-gens/s (population %zu -> %zu)\n",
+            rule, cols, rows, gens, pool.num_threads,
+            (double)rows*cols*gens / seconds / 1e9, before, LifePopulation(&life));
+    ArenaFree(&arena);
+    ThreadPoolFree(&pool);
+    return 0;
+}
+
+// --------------
+// | World Hash |
+// --------------
+
+// A 64-bit hash of the simulation state, updated every tick: projectile
+// pixels, the momentum of every projectile, and the player. Two runs that
+// print the same hash sequence evolved bit-identically, so an optimized
+// kernel can be checked against the reference by comparing hash sequences
+// instead of diffing buffers.
+//
+// Each tile keeps its own hash and the world hash is a sum over tiles, so a
+// tick only rehashes dirty tiles: ones holding projectiles now or at the
+// last update. Finding them is a quick OR over the tile's pixels; an empty
+// tile that stayed empty keeps its hash without being read further. Momentum
+// under empty pixels is stale scratch and is left out.
+#define HASH_TILES (SCREEN_TILE_ROWS*SCREEN_TILE_COLS)
+
+typedef struct
+{
+    u64 tile[HASH_TILES];
+    bool occupied[HASH_TILES]; // tile had projectiles at the last update
+    rect_t player;
+    u64 player_hash;
+    u64 world;                 // sum of every tile's and the player's term
+    int dirty;                 // tiles rehashed by the last update
+} world_hash_t;
+
+/**
+ *  \brief splitmix64 finalizer: every input bit affects every output bit
+ */
+inline internal u64 HashMix(u64 h)
+{
+    h ^= h >> 30; h *= 0xBF58476D1CE4E5B9;
+    h ^= h >> 27; h *= 0x94D049BB133111EB;
+    h ^= h >> 31;
+    return h;
+}
+
+inline internal u64 HashFloats(float a, float b)
+{
+    u32 bits[2];
+    memcpy(&bits[0], &a, sizeof(float));
+    memcpy(&bits[1], &b, sizeof(float));
+    return ((u64)bits[0] << 32) | bits[1];
+}
+
+/**
+ *  \brief What a tile (or the player) adds to the world hash
+ */
+inline internal u64 HashTerm(u64 index, u64 hash)
+{
+    return HashMix(hash + index*0x9E3779B97F4A7C15);
+}
+
+internal bool TileOccupied(const u32 *frame, int tile_row, int tile_col)
+{
+    int row_end = SDL_min((tile_row+1)*TILE_SIZE, SCREEN_HEIGHT);
+    int col = tile_col*TILE_SIZE;
+    int num_bytes = SDL_min(TILE_SIZE, SCREEN_WIDTH - col) * sizeof(u32);
+    u8x16 any = {0};
+    u8 any_tail = 0;
+    for (int row=tile_row*TILE_SIZE; row < row_end; row++)
+    {
+        const u8 *bytes = (const u8*) &frame[row*SCREEN_WIDTH + col];
+        int i = 0;
+        for (; i+16 <= num_bytes; i += 16)
+        {
+            u8x16 channels;
+            memcpy(&channels, bytes+i, 16);
+            any |= channels;
+        }
+        for (; i < num_bytes; i++) any_tail |= bytes[i];
+    }
+    u64 any_lanes[2];
+    memcpy(any_lanes, &any, 16);
+    return (any_lanes[0] | any_lanes[1] | any_tail) != 0;
+}
+
+internal u64 HashTile(const u32 *frame, const momentum_t *momentum, int tile_row, int tile_col)
+{
+    u64 h = 0;
+    int row_end = SDL_min((tile_row+1)*TILE_SIZE, SCREEN_HEIGHT);
+    int col_end = SDL_min((tile_col+1)*TILE_SIZE, SCREEN_WIDTH);
+    for (int row=tile_row*TILE_SIZE; row < row_end; row++)
+        for (int col=tile_col*TILE_SIZE; col < col_end; col++)
+        {
+            int i = row*SCREEN_WIDTH + col;
+            if (frame[i] == EMPTY_SPACE) continue;
+            h = HashMix(h ^ (((u64)i << 32) | frame[i]));
+            h = HashMix(h ^ HashFloats(momentum[i].x, momentum[i].y));
+            h = HashMix(h ^ HashFloats(momentum[i].dx, momentum[i].dy));
+        }
+    return h;
+}
+
+/**
+ *  \brief Start over: the next update rehashes everything
+ */
+internal void WorldHashReset(world_hash_t *hash)
+{
+    memset(hash, 0, sizeof(*hash));
+    for (int t=0; t < HASH_TILES; t++)
+    {
+        hash->occupied[t] = true; // forces a rehash
+        hash->world += HashTerm(t, 0);
+    }
+    hash->player_hash = 0;
+    hash->world += HashTerm(HASH_TILES, 0);
+}
+
+/**
+ *  \brief Rehash dirty tiles and the player if it moved
+ *
+ *  \return The world hash after this tick
+ */
+internal u64 WorldHashUpdate(world_hash_t *hash, const u32 *frame, const momentum_t *momentum, rect_t player)
+{
+    hash->dirty = 0;
+    for (int tile_row=0; tile_row < SCREEN_TILE_ROWS; tile_row++)
+        for (int tile_col=0; tile_col < SCREEN_TILE_COLS; tile_col++)
+        {
+            int t = tile_row*SCREEN_TILE_COLS + tile_col;
+            bool occupied = TileOccupied(frame, tile_row, tile_col);
+            if (!occupied && !hash->occupied[t]) continue;
+            u64 h = occupied ? HashTile(frame, momentum, tile_row, tile_col) : 0;
+            hash->world += HashTerm(t, h) - HashTerm(t, hash->tile[t]);
+            hash->tile[t] = h;
+            hash->occupied[t] = occupied;
+            hash->dirty++;
+        }
+    if (memcmp(&player, &hash->player, sizeof(rect_t)) != 0)
+    {
+        u64 h = HashMix(((u64)(u32)player.x << 32) | (u32)player.y);
+        h = HashMix(h ^ (((u64)(u32)player.w << 32) | (u32)player.h));
+        hash->world += HashTerm(HASH_TILES, h) - HashTerm(HASH_TILES, hash->player_hash);
+        hash->player_hash = h;
+        hash->player = player;
+    }
+    return hash->world;
+}
+
+/**
+ *  \brief Headless scenarios: print the world hash every tick, or check a golden sequence
+ *
+ *  momentum.exe --hash [plain|lod|heat] [ticks] [golden file]
+ *
+ *  Without a golden file, prints one hash per line; save that as the golden
+ *  file. With one, reports the first tick that differs. Every tick also
+ *  checks the incremental hash against a full rehash.
+ */
+internal int HashScenario(int argc, char **argv)
+{
+    const char *scenario = (argc > 0) ? argv[0] : "plain";
+    int ticks = (argc > 1) ? atoi(argv[1]) : 1000;
+    const char *golden_path = (argc > 2) ? argv[2] : NULL;
+    bool lod_enabled = (strcmp(scenario, "lod") == 0);
+    bool heat_enabled = (strcmp(scenario, "heat") == 0);
+    if (!lod_enabled && !heat_enabled && (strcmp(scenario, "plain") != 0))
+    {
+        printf("Unknown scenario %s: use plain, lod or heat\n", scenario);
+        return 1;
+    }
+
+    char *golden = NULL;
+    if (golden_path)
+    {
+        SDL_RWops *file = SDL_RWFromFile(golden_path, "rb");
+        if (!file)
+        {
+            printf("Cannot open %s\n", golden_path);
+            return 1;
+        }
+        size_t size = (size_t)SDL_RWsize(file);
+        golden = (char*) calloc(size + 1, 1);
+        assert(golden);
+        SDL_RWread(file, golden, 1, size);
+        SDL_RWclose(file);
+    }
+
+    size_t pixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+    u32 *frame = (u32*) calloc(pixels, sizeof(u32));
+    u32 *frame_next = (u32*) calloc(pixels, sizeof(u32));
+    momentum_t *momentum = (momentum_t*) calloc(pixels, sizeof(momentum_t));
+    momentum_t *momentum_next = (momentum_t*) calloc(pixels, sizeof(momentum_t));
+    assert(frame && frame_next && momentum && momentum_next);
+    thread_pool_t pool;
+    ThreadPoolInit(&pool, 0);
+    heat_t heat;
+    arena_t arena = {0};
+    ARENA_SIZED(&arena, HeatInit(&heat, SCREEN_HEIGHT, SCREEN_WIDTH, pool.num_threads, &arena));
+    lod_t lod = {0};
+    rect_t player = {SCREEN_HEIGHT-2, 0, 1, 1};
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    world_hash_t hash, full;
+    WorldHashReset(&hash);
+
+    int status = 0;
+    const char *line = golden;
+    for (int tick=0; tick < ticks; tick++)
+    {
+        // Fire every few ticks while the player paces back and forth
+        if (tick % 7 == 0)
+        {
+            LODSettle(frame, frame_next, momentum, momentum_next, &lod);
+            InitProjectile(frame, momentum);
+        }
+        if (tick % 3 == 0) player.y = (tick / 3) % SCREEN_WIDTH;
+        if (lod_enabled)
+        {
+            DrawProjectileLOD(frame, frame_next, momentum, momentum_next, &lod, LODFocus(player));
+        }
+        else
+        {
+            FillRect(entire_screen, EMPTY_SPACE, frame_next);
+            DrawProjectile(frame, frame_next, momentum, momentum_next);
+        }
+        u32 *tmp_pix = frame; frame = frame_next; frame_next = tmp_pix;
+        momentum_t *tmp_mom = momentum; momentum = momentum_next; momentum_next = tmp_mom;
+        if (heat_enabled)
+        {
+            HeatCouple(&heat, frame, momentum, player);
+            HeatStep(&heat, &pool, 1);
+        }
+
+        u64 h = WorldHashUpdate(&hash, frame, momentum, player);
+        WorldHashReset(&full);
+        if (WorldHashUpdate(&full, frame, momentum, player) != h)
+        {
+            printf("tick %d: incremental hash %016llx, full rehash %016llx\n",
+                    tick, (unsigned long long)h, (unsigned long long)full.world);
+            status = 1;
+            break;
+        }
+        if (!golden)
+        {
+            printf("%016llx\n", (unsigned long long)h);
+            continue;
+        }
+        char *end;
+        unsigned long long expected = strtoull(line, &end, 16);
+        if (end == line)
+        {
+            printf("Golden file ends at tick %d\n", tick);
+            status = 1;
+            break;
+        }
+        line = end;
+        if (expected != h)
+        {
+            printf("tick %d: hash %016llx, golden %016llx\n", tick, (unsigned long long)h, expected);
+            status = 1;
+            break;
+        }
+    }
+    if (golden && (status == 0)) printf("%s: matches %s\n", scenario, golden_path);
+
+    free(golden);
+    free(frame); free(frame_next);
+    free(momentum); free(momentum_next);
+    ArenaFree(&arena);
+    ThreadPoolFree(&pool);
+    return status;
+}
+
+// -------------------------
+// | Shared Memory Export |
+// -------------------------
+
+// Publish `projectile_buffer` and `momentum` every tick in a named shared
+// memory segment, so other processes can watch the world without copies.
+//
+// The segment holds a header and two frame slots. The sim writes the slot
+// readers are not being pointed at, then publishes it as the latest. Each
+// slot has its own seqlock: a sequence number that is odd while the slot is
+// being written. A reader notes the latest slot and its (even) sequence,
+// reads the frame in place, and keeps what it read if the sequence has not
+// moved. Readers have a whole tick before the sim comes back around to their
+// slot, and the sim never waits on a reader.
+#define SHM_MAGIC 0x4D4F4D53 // "MOMS"
+#define SHM_VERSION 1
+
+typedef struct
+{
+    SDL_atomic_t sequence; // odd while the sim is writing this slot
+    u32 pad;
+    u64 tick;              // tick this slot holds, valid with the sequence
+} shm_slot_t;
+
+typedef struct
+{
+    u32 magic, version;
+    u32 rows, cols;
+    u32 pixels_offset[2];   // from the start of the segment: rows*cols ARGB
+    u32 momentum_offset[2]; // from the start of the segment: rows*cols momentum_t
+    SDL_atomic_t latest;    // slot holding the newest complete frame
+    shm_slot_t slots[2];
+} shm_header_t;
+
+typedef struct
+{
+    shm_header_t *header;
+    size_t size;
+#ifdef _WIN32
+    HANDLE mapping;
+#else
+    char name[64];
+    bool owner; // created the segment, so unlinks it on close
+#endif
+} shm_export_t;
+
+/**
+ *  \brief Map a named segment of `size` bytes, creating it if `create`
+ *
+ *  Names are plain words ("momentum"); POSIX gets a leading slash added.
+ */
+internal bool ShmMap(shm_export_t *shm, const char *name, size_t size, bool create)
+{
+    memset(shm, 0, sizeof(*shm));
+    shm->size = size;
+#ifdef _WIN32
+    if (create)
+    {
+        shm->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                (DWORD)((u64)size >> 32), (DWORD)size, name);
+    }
+    else
+    {
+        shm->mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+    }
+    if (!shm->mapping) return false;
+    shm->header = (shm_header_t*) MapViewOfFile(shm->mapping,
+            create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, create ? size : 0);
+    if (!shm->header)
+    {
+        CloseHandle(shm->mapping);
+        return false;
+    }
+#else
+    SDL_snprintf(shm->name, sizeof(shm->name), "/%s", name);
+    int fd = create ? shm_open(shm->name, O_CREAT | O_RDWR, 0644) : shm_open(shm->name, O_RDONLY, 0);
+    if (fd < 0) return false;
+    if (create && (ftruncate(fd, (off_t)size) != 0))
+    {
+        close(fd);
+        shm_unlink(shm->name);
+        return false;
+    }
+    if (!create)
+    {
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            close(fd);
+            return false;
+        }
+        shm->size = size = (size_t)info.st_size;
+    }
+    void *base = mmap(NULL, size, create ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the segment
+    if (base == MAP_FAILED)
+    {
+        if (create) shm_unlink(shm->name);
+        return false;
+    }
+    shm->header = (shm_header_t*) base;
+    shm->owner = create;
+#endif
+    return true;
+}
+
+internal void ShmUnmap(shm_export_t *shm)
+{
+    if (!shm->header) return;
+#ifdef _WIN32
+    UnmapViewOfFile(shm->header);
+    CloseHandle(shm->mapping);
+#else
+    munmap(shm->header, shm->size);
+    if (shm->owner) shm_unlink(shm->name);
+#endif
+    shm->header = NULL;
+}
+
+/**
+ *  \brief Create the segment for a rows x cols world
+ */
+internal bool ShmExportOpen(shm_export_t *shm, const char *name, int rows, int cols)
+{
+    size_t cells = (size_t)rows*cols;
+    size_t header_size = (sizeof(shm_header_t) + 63) & ~(size_t)63;
+    size_t slot_size = ((cells*(sizeof(u32) + sizeof(momentum_t))) + 63) & ~(size_t)63;
+    if (!ShmMap(shm, name, header_size + 2*slot_size, true)) return false;
+
+    shm_header_t *header = shm->header;
+    memset(header, 0, header_size);
+    header->rows = rows;
+    header->cols = cols;
+    for (int s=0; s < 2; s++)
+    {
+        header->pixels_offset[s] = (u32)(header_size + s*slot_size);
+        header->momentum_offset[s] = (u32)(header_size + s*slot_size + cells*sizeof(u32));
+    }
+    header->version = SHM_VERSION;
+    SDL_MemoryBarrierRelease();
+    header->magic = SHM_MAGIC; // last: readers check it before anything else
+    return true;
+}
+
+/**
+ *  \brief Copy a frame into the slot readers are not pointed at, then publish it
+ */
+internal void ShmExportPublish(shm_export_t *shm, const u32 *frame, const momentum_t *momentum, u64 tick)
+{
+    shm_header_t *header = shm->header;
+    int s = 1 - SDL_AtomicGet(&header->latest);
+    shm_slot_t *slot = &header->slots[s];
+    size_t cells = (size_t)header->rows*header->cols;
+
+    SDL_AtomicAdd(&slot->sequence, 1); // odd: writing
+    SDL_MemoryBarrierRelease();
+    memcpy((u8*)header + header->pixels_offset[s], frame, cells*sizeof(u32));
+    memcpy((u8*)header + header->momentum_offset[s], momentum, cells*sizeof(momentum_t));
+    slot->tick = tick;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicAdd(&slot->sequence, 1); // even: done
+    SDL_AtomicSet(&header->latest, s);
+}
+
+internal void ShmExportClose(shm_export_t *shm)
+{
+    ShmUnmap(shm);
+}
+
+/**
+ *  \brief Reader: the latest frame, in place, and the sequence to validate it with
+ *
+ *  \return Slot index, or -1 if the sim is mid-write (try again)
+ */
+internal int ShmReadBegin(const shm_header_t *header, int *sequence)
+{
+    int s = SDL_AtomicGet((SDL_atomic_t*)&header->latest);
+    *sequence = SDL_AtomicGet((SDL_atomic_t*)&header->slots[s].sequence);
+    SDL_MemoryBarrierAcquire();
+    return (*sequence & 1) ? -1 : s;
+}
+
+/**
+ *  \brief Reader: true if what was read from slot `s` since ShmReadBegin() is one whole frame
+ */
+internal bool ShmReadValid(const shm_header_t *header, int s, int sequence)
+{
+    SDL_MemoryBarrierAcquire();
+    return SDL_AtomicGet((SDL_atomic_t*)&header->slots[s].sequence) == sequence;
+}
+
+/**
+ *  \brief Headless reader: attach to a running sim and report what it sees
+ *
+ *  momentum.exe --shm-view [name] [frames]
+ */
+internal int ShmView(int argc, char **argv)
+{
+    const char *name = (argc > 0) ? argv[0] : "momentum";
+    int frames = (argc > 1) ? atoi(argv[1]) : 100;
+
+    shm_export_t shm;
+    if (!ShmMap(&shm, name, 0, false) || (shm.header->magic != SHM_MAGIC))
+    {
+        printf("No momentum world is being shared as %s\n", name);
+        if (shm.header) ShmUnmap(&shm);
+        return 1;
+    }
+    const shm_header_t *header = shm.header;
+    printf("%s: %dx%d, version %u\n", name, header->cols, header->rows, header->version);
+    int cells = header->rows * header->cols;
+    u64 last_tick = (u64)-1;
+    int torn = 0;
+    for (int seen=0; seen < frames; )
+    {
+        int sequence;
+        int s = ShmReadBegin(header, &sequence);
+        if ((s < 0) || (header->slots[s].tick == last_tick))
+        {
+            SDL_Delay(1);
+            continue;
+        }
+        const u32 *pixels = (const u32*)((const u8*)header + header->pixels_offset[s]);
+        const momentum_t *momentum = (const momentum_t*)((const u8*)header + header->momentum_offset[s]);
+        u64 tick = header->slots[s].tick;
+        int count = 0;
+        float fastest = 0;
+        for (int i=0; i < cells; i++)
+        {
+            if (pixels[i] != PROJECTILE_COLOR) continue;
+            count++;
+            fastest = SDL_max(fastest, SDL_fabsf(momentum[i].dx));
+        }
+        if (!ShmReadValid(header, s, sequence))
+        {
+            torn++; // the sim lapped us: read again
+            continue;
+        }
+        printf("tick %llu: %d projectiles, fastest %.2f px/tick\n", (unsigned long long)tick, count, fastest);
+        last_tick = tick;
+        seen++;
+    }
+    printf("%d torn reads retried\n", torn);
+    ShmUnmap(&shm);
+    return 0;
+}
+
+// -------------------
+// | Streaming World |
+// -------------------
+
+// Worlds bigger than RAM live in a file on disk, cut into TILE_SIZE x TILE_SIZE
+// tiles. Only a budget's worth of tiles are resident at once. Tiles are paged
+// in by a background I/O thread and the least-recently-used tile is written
+// back when the budget is full.
+#define STREAM_PREFETCH_TICKS 64 // look this far ahead along particle velocity
+#define STREAM_VIEW_MARGIN 1 // tiles kept resident around the viewport
+// Tiles a screen-sized viewport and its margin can touch, however it sits on
+// the tile grid: fewer and the viewport's own tiles evict each other forever
+#define STREAM_VIEW_SPAN(pixels) ((pixels + TILE_SIZE-2)/TILE_SIZE + 1 + 2*STREAM_VIEW_MARGIN)
+#define STREAM_VIEW_SLOTS (STREAM_VIEW_SPAN(SCREEN_HEIGHT) * STREAM_VIEW_SPAN(SCREEN_WIDTH))
+
+// Tile payload, as stored on disk
+typedef struct
+{
+    u32 color[TILE_SIZE*TILE_SIZE];
+    momentum_t momentum[TILE_SIZE*TILE_SIZE];
+} tile_t;
+
+// Residency of a tile slot. Only the sim thread makes a slot resident, at the
+// start of a step, so residency never changes under a step.
+#define SLOT_FREE     0 // slot holds nothing
+#define SLOT_LOADING  1 // owned by the I/O thread, do not touch
+#define SLOT_LOADED   2 // I/O done, resident from the next step
+#define SLOT_RESIDENT 3 // owned by the sim thread
+
+typedef struct
+{
+    SDL_atomic_t state; // SLOT_FREE, SLOT_LOADING, SLOT_LOADED or SLOT_RESIDENT
+    int tile;           // tile index held (or being loaded) by this slot
+    int evict_tile;     // tile to write back before loading, -1 if none
+    u32 last_used;      // tick this slot was last touched, for LRU
+    bool dirty;         // cur differs from the copy on disk
+    int count;          // projectiles in cur (upper bound)
+    int next_count;     // projectiles written to next this tick (upper bound)
+    int stale_count;    // projectiles left over in next from an older tick
+    tile_t *cur;        // projectile positions and momentum for PREV tick
+    tile_t *next;       // projectile positions and momentum for NEXT tick
+} tile_slot_t;
+
+typedef struct
+{
+    int rows, cols;           // world size in pixels
+    int tile_rows, tile_cols; // world size in tiles
+    int *slot_of_tile;        // slot index for each tile, -1 if on disk
+    tile_slot_t *slots;
+    int num_slots;            // residency budget in tiles
+    u32 tick;
+
+    // Stats
+    SDL_atomic_t page_ins;
+    SDL_atomic_t write_backs;
+    u32 holds;  // projectiles held in place because their next tile was on disk
+    u32 exits;  // projectiles that left the world
+    u32 merges; // projectiles lost landing on the same pixel as another
+
+    // ---Background I/O---
+    SDL_RWops *file;
+    SDL_Thread *io_thread;
+    SDL_mutex *io_lock;
+    SDL_cond *io_wake;
+    SDL_cond *io_idle;
+    int *io_queue; // ring of slot indices waiting for the I/O thread
+    int io_size;   // ring capacity: one more than the slots, so full != empty
+    int io_head, io_tail, io_pending;
+    bool io_quit;
+} stream_world_t;
+
+internal Sint64 TileOffset(int tile)
+{
+    return (Sint64)tile * (Sint64)sizeof(tile_t);
+}
+
+/**
+ *  \brief I/O thread: write back evicted tiles and page in requested tiles
+ *
+ *  Jobs run in the order they were queued, so a tile that is evicted and then
+ *  requested again is always written before it is read.
+ */
+internal int StreamIOThread(void *data)
+{
+    stream_world_t *world = (stream_world_t*) data;
+    for (;;)
+    {
+        SDL_LockMutex(world->io_lock);
+        while ((world->io_head == world->io_tail) && !world->io_quit)
+        {
+            SDL_CondWait(world->io_wake, world->io_lock);
+        }
+        if (world->io_head == world->io_tail) // quit and nothing left to do
+        {
+            SDL_UnlockMutex(world->io_lock);
+            return 0;
+        }
+        tile_slot_t *slot = &world->slots[world->io_queue[world->io_head]];
+        world->io_head = (world->io_head + 1) % world->io_size;
+        SDL_UnlockMutex(world->io_lock);
+
+        if (slot->evict_tile >= 0)
+        {
+            SDL_RWseek(world->file, TileOffset(slot->evict_tile), RW_SEEK_SET);
+            SDL_RWwrite(world->file, slot->cur, sizeof(tile_t), 1);
+            SDL_AtomicAdd(&world->write_backs, 1);
+            slot->evict_tile = -1;
+        }
+        // Tiles past the end of the file have never been written: all empty.
+        memset(slot->cur, 0, sizeof(tile_t));
+        if (SDL_RWseek(world->file, TileOffset(slot->tile), RW_SEEK_SET) >= 0)
+        {
+            SDL_RWread(world->file, slot->cur, sizeof(tile_t), 1);
+        }
+        int count = 0;
+        for (int i=0; i < TILE_SIZE*TILE_SIZE; i++)
+        {
+            count += (slot->cur->color[i] == PROJECTILE_COLOR);
+        }
+        slot->count = count;
+        slot->next_count = 0;
+        slot->stale_count = TILE_SIZE*TILE_SIZE; // next is garbage: clear it
+        slot->dirty = false;
+        SDL_AtomicAdd(&world->page_ins, 1);
+        SDL_AtomicSet(&slot->state, SLOT_LOADED);
+
+        SDL_LockMutex(world->io_lock);
+        if (--world->io_pending == 0) SDL_CondSignal(world->io_idle);
+        SDL_UnlockMutex(world->io_lock);
+    }
+}
+
+/**
+ *  \brief Open a world stored in a file on disk
+ *
+ *  \param world        World to initialize
+ *  \param path         File backing the world, created if it does not exist
+ *  \param rows         World height in pixels
+ *  \param cols         World width in pixels
+ *  \param budget_bytes Most memory to spend on resident tiles, raised if need
+ *                      be to the STREAM_VIEW_SLOTS a screen-sized viewport needs
+ *
+ *  \return true if the world is ready to use
+ */
+internal bool StreamWorldOpen(stream_world_t *world, const char *path,
+        int rows, int cols, size_t budget_bytes)
+{
+    memset(world, 0, sizeof(*world));
+    world->rows = rows;
+    world->cols = cols;
+    world->tile_rows = (rows + TILE_SIZE-1)/TILE_SIZE;
+    world->tile_cols = (cols + TILE_SIZE-1)/TILE_SIZE;
+    world->num_slots = (int)(budget_bytes / (2*sizeof(tile_t)));
+    int num_tiles = world->tile_rows * world->tile_cols;
+    world->num_slots = SDL_max(world->num_slots, SDL_min(STREAM_VIEW_SLOTS, num_tiles));
+
+    world->file = SDL_RWFromFile(path, "r+b");
+    if (!world->file) world->file = SDL_RWFromFile(path, "w+b");
+    if (!world->file) return false;
+
+    world->slot_of_tile = (int*) malloc(num_tiles * sizeof(int));
+    assert(world->slot_of_tile);
+    for (int t=0; t < num_tiles; t++) world->slot_of_tile[t] = -1;
+
+    world->slots = (tile_slot_t*) calloc(world->num_slots, sizeof(tile_slot_t));
+    assert(world->slots);
+    for (int s=0; s < world->num_slots; s++)
+    {
+        world->slots[s].cur  = (tile_t*) calloc(1, sizeof(tile_t));
+        world->slots[s].next = (tile_t*) calloc(1, sizeof(tile_t));
+        assert(world->slots[s].cur && world->slots[s].next);
+        world->slots[s].evict_tile = -1;
+    }
+
+    world->io_size = world->num_slots + 1;
+    world->io_queue = (int*) calloc(world->io_size, sizeof(int));
+    assert(world->io_queue);
+    world->io_lock = SDL_CreateMutex();
+    world->io_wake = SDL_CreateCond();
+    world->io_idle = SDL_CreateCond();
+    world->io_thread = SDL_CreateThread(StreamIOThread, "stream-io", world);
+    assert(world->io_thread);
+    return true;
+}
+
+/**
+ *  \brief Block until the I/O thread has finished every queued job
+ */
+internal void StreamWorldWait(stream_world_t *world)
+{
+    SDL_LockMutex(world->io_lock);
+    while (world->io_pending > 0)
+    {
+        SDL_CondWait(world->io_idle, world->io_lock);
+    }
+    SDL_UnlockMutex(world->io_lock);
+}
+
+/**
+ *  \brief Write every dirty resident tile to disk and release the world
+ */
+internal void StreamWorldClose(stream_world_t *world)
+{
+    StreamWorldWait(world);
+    SDL_LockMutex(world->io_lock);
+    world->io_quit = true;
+    SDL_CondSignal(world->io_wake);
+    SDL_UnlockMutex(world->io_lock);
+    SDL_WaitThread(world->io_thread, NULL);
+
+    for (int s=0; s < world->num_slots; s++)
+    {
+        tile_slot_t *slot = &world->slots[s];
+        if ((SDL_AtomicGet(&slot->state) == SLOT_RESIDENT) && slot->dirty)
+        {
+            SDL_RWseek(world->file, TileOffset(slot->tile), RW_SEEK_SET);
+            SDL_RWwrite(world->file, slot->cur, sizeof(tile_t), 1);
+        }
+        free(slot->cur);
+        free(slot->next);
+    }
+    SDL_RWclose(world->file);
+    SDL_DestroyCond(world->io_idle);
+    SDL_DestroyCond(world->io_wake);
+    SDL_DestroyMutex(world->io_lock);
+    free(world->io_queue);
+    free(world->slots);
+    free(world->slot_of_tile);
+}
+
+/**
+ *  \brief Ask for a tile to be resident soon. Never blocks.
+ *
+ *  A resident tile is marked as used this tick. A tile on disk is handed to
+ *  the I/O thread, evicting the least-recently-used tile if the budget is
+ *  full. Tiles touched this tick are never evicted, so if everything is in use
+ *  the request is dropped and the caller simply asks again next tick.
+ *
+ *  \return true if the tile is resident right now
+ */
+internal bool StreamWorldRequest(stream_world_t *world, int tile_row, int tile_col)
+{
+    if ((tile_row < 0) || (tile_col < 0) ||
+        (tile_row >= world->tile_rows) || (tile_col >= world->tile_cols))
+    {
+        return false;
+    }
+    int tile = tile_row*world->tile_cols + tile_col;
+    int s = world->slot_of_tile[tile];
+    if (s >= 0)
+    {
+        tile_slot_t *slot = &world->slots[s];
+        slot->last_used = world->tick;
+        return (SDL_AtomicGet(&slot->state) == SLOT_RESIDENT);
+    }
+
+    // Find a free slot, or else the least-recently-used resident slot.
+    int victim = -1;
+    for (int i=0; i < world->num_slots; i++)
+    {
+        tile_slot_t *slot = &world->slots[i];
+        int state = SDL_AtomicGet(&slot->state);
+        if (state == SLOT_FREE) { victim = i; break; }
+        if ((state == SLOT_RESIDENT) && (slot->last_used != world->tick) &&
+            ((victim < 0) || (slot->last_used < world->slots[victim].last_used)))
+        {
+            victim = i;
+        }
+    }
+    if (victim < 0) return false;
+
+    tile_slot_t *slot = &world->slots[victim];
+    slot->evict_tile = -1;
+    if (SDL_AtomicGet(&slot->state) == SLOT_RESIDENT)
+    {
+        world->slot_of_tile[slot->tile] = -1;
+        if (slot->dirty) slot->evict_tile = slot->tile;
+    }
+    slot->tile = tile;
+    slot->last_used = world->tick;
+    world->slot_of_tile[tile] = victim;
+    SDL_AtomicSet(&slot->state, SLOT_LOADING);
+
+    SDL_LockMutex(world->io_lock);
+    world->io_queue[world->io_tail] = victim;
+    world->io_tail = (world->io_tail + 1) % world->io_size;
+    world->io_pending++;
+    SDL_CondSignal(world->io_wake);
+    SDL_UnlockMutex(world->io_lock);
+    return false;
+}
+
+/**
+ *  \brief Keep the tiles under a viewport (plus a margin) resident
+ *
+ *  The tiles already there are marked used first, so the ones still on disk
+ *  never evict another tile of the same view.
+ *
+ *  \param view Viewport in world pixels (x is row, y is col)
+ */
+internal void StreamWorldTouchRect(stream_world_t *world, rect_t view)
+{
+    int top    = view.x/TILE_SIZE - STREAM_VIEW_MARGIN;
+    int left   = view.y/TILE_SIZE - STREAM_VIEW_MARGIN;
+    int bottom = (view.x + view.h - 1)/TILE_SIZE + STREAM_VIEW_MARGIN;
+    int right  = (view.y + view.w - 1)/TILE_SIZE + STREAM_VIEW_MARGIN;
+    for (int tr=SDL_max(top, 0); tr <= SDL_min(bottom, world->tile_rows-1); tr++)
+        for (int tc=SDL_max(left, 0); tc <= SDL_min(right, world->tile_cols-1); tc++)
+        {
+            int s = world->slot_of_tile[tr*world->tile_cols + tc];
+            if (s >= 0) world->slots[s].last_used = world->tick;
+        }
+    for (int tr=top; tr <= bottom; tr++)
+        for (int tc=left; tc <= right; tc++)
+        {
+            StreamWorldRequest(world, tr, tc);
+        }
+}
+
+/**
+ *  \brief Start a new projectile in the streamed world
+ *
+ *  \return true if launched, false if its tile is not resident yet (the tile
+ *          is requested, so try again next tick)
+ */
+internal bool StreamWorldLaunch(stream_world_t *world, int row, int col, momentum_t momentum)
+{
+    if (!StreamWorldRequest(world, row/TILE_SIZE, col/TILE_SIZE)) return false;
+    tile_slot_t *slot = &world->slots[world->slot_of_tile[(row/TILE_SIZE)*world->tile_cols + col/TILE_SIZE]];
+    int i = (row%TILE_SIZE)*TILE_SIZE + (col%TILE_SIZE);
+    if (slot->cur->color[i] != EMPTY_SPACE) return false;
+    slot->cur->color[i] = PROJECTILE_COLOR;
+    slot->cur->momentum[i] = momentum;
+    slot->count++;
+    slot->dirty = true;
+    return true;
+}
+
+/**
+ *  \brief Update projectiles in every resident tile
+ *
+ *  Same physics as DrawProjectile(). Tiles on disk are frozen in time. A
+ *  projectile headed into a tile that is still on disk is held in place for
+ *  this tick (its momentum is not updated) and the tile is requested, so the
+ *  step never waits on the disk. Tiles along each projectile's path are
+ *  prefetched STREAM_PREFETCH_TICKS ahead so holds should be rare.
+ */
+internal void StreamWorldStep(stream_world_t *world)
+{
+    // Take the tiles the I/O thread finished, and clear the NEXT buffers that
+    // still have old projectiles in them. Tiles with projectiles are in use
+    // this tick, so no prefetch below can evict them.
+    for (int s=0; s < world->num_slots; s++)
+    {
+        tile_slot_t *slot = &world->slots[s];
+        if (SDL_AtomicGet(&slot->state) == SLOT_LOADED) SDL_AtomicSet(&slot->state, SLOT_RESIDENT);
+        if (SDL_AtomicGet(&slot->state) != SLOT_RESIDENT) continue;
+        if (slot->stale_count > 0)
+        {
+            memset(slot->next->color, 0, sizeof(slot->next->color));
+            slot->stale_count = 0;
+        }
+        slot->next_count = 0;
+        if (slot->count > 0) slot->last_used = world->tick;
+    }
+
+    for (int s=0; s < world->num_slots; s++)
+    {
+        tile_slot_t *slot = &world->slots[s];
+        if (SDL_AtomicGet(&slot->state) != SLOT_RESIDENT) continue;
+        if (slot->count == 0) continue;
+
+        int tile_row = slot->tile / world->tile_cols;
+        int tile_col = slot->tile % world->tile_cols;
+        for (int i=0; i < TILE_SIZE*TILE_SIZE; i++)
+        {
+            if (slot->cur->color[i] != PROJECTILE_COLOR) continue;
+            int col = tile_col*TILE_SIZE + i%TILE_SIZE;
+            momentum_t momentum = slot->cur->momentum[i];
+            momentum.dx += GRAVITY;
+            momentum.x += momentum.dx;
+            int row_predict = (int)(momentum.x);
+            slot->dirty = true;
+
+            if ((row_predict < 0) || (row_predict >= world->rows))
+            {
+                world->exits++;
+                continue; // Erase the projectile: it left the world
+            }
+
+            // Prefetch tiles along the path (closed form of the step above).
+            float n = STREAM_PREFETCH_TICKS;
+            int row_ahead = (int)(momentum.x + n*momentum.dx + GRAVITY*n*(n+1)/2);
+            if (row_ahead < 0) row_ahead = 0;
+            if (row_ahead >= world->rows) row_ahead = world->rows-1;
+            if (row_ahead/TILE_SIZE != tile_row)
+            {
+                StreamWorldRequest(world, row_ahead/TILE_SIZE, tile_col);
+            }
+
+            int target = (row_predict/TILE_SIZE)*world->tile_cols + tile_col;
+            int t = world->slot_of_tile[target];
+            if ((t >= 0) && (SDL_AtomicGet(&world->slots[t].state) == SLOT_RESIDENT))
+            {
+                tile_slot_t *dst = &world->slots[t];
+                int j = (row_predict%TILE_SIZE)*TILE_SIZE + (col%TILE_SIZE);
+                world->merges += (dst->next->color[j] == PROJECTILE_COLOR);
+                dst->next->color[j] = PROJECTILE_COLOR;
+                dst->next->momentum[j] = momentum;
+                dst->next_count++;
+                dst->dirty = true;
+                dst->last_used = world->tick; // written: not to be evicted this tick
+            }
+            else // Hold: stay put until the tile arrives
+            {
+                StreamWorldRequest(world, row_predict/TILE_SIZE, tile_col);
+                world->merges += (slot->next->color[i] == PROJECTILE_COLOR);
+                slot->next->color[i] = PROJECTILE_COLOR;
+                slot->next->momentum[i] = slot->cur->momentum[i];
+                slot->next_count++;
+                world->holds++;
+            }
+        }
+    }
+
+    // Load next frame
+    for (int s=0; s < world->num_slots; s++)
+    {
+        tile_slot_t *slot = &world->slots[s];
+        if (SDL_AtomicGet(&slot->state) != SLOT_RESIDENT) continue;
+        tile_t *tmp = slot->cur;
+        slot->cur = slot->next;
+        slot->next = tmp;
+        slot->stale_count = slot->count;
+        slot->count = slot->next_count;
+    }
+    world->tick++;
+}
+
+/**
+ *  \brief Headless demo: sweep an emitter across a world bigger than the budget
+ *
+ *  momentum.exe --stream [path] [rows] [cols] [budget_mb] [ticks]
+ *
+ *  Afterwards reads the whole file back and fails unless every projectile
+ *  launched is accounted for (still in the world, left it, or landed on
+ *  another) and each one sits on the pixel under its position.
+ */
+internal int StreamDemo(int argc, char **argv)
+{
+    const char *path = (argc > 0) ? argv[0] : "momentum-world.bin";
+    int rows  = (argc > 1) ? atoi(argv[1]) : 4096;
+    int cols  = (argc > 2) ? atoi(argv[2]) : 4096;
+    int budget_mb = (argc > 3) ? atoi(argv[3]) : 16;
+    int ticks = (argc > 4) ? atoi(argv[4]) : 10000;
+
+    remove(path); // start from an empty world
+    stream_world_t world;
+    if (!StreamWorldOpen(&world, path, rows, cols, (size_t)budget_mb << 20))
+    {
+        printf("Cannot open %s\n", path);
+        return 1;
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    u32 launched = 0;
+    for (int tick=0; tick < ticks; tick++)
+    {
+        // Emitter (and the viewport on it) sweeps across the world like a
+        // raster scan, leaving falling projectiles behind it.
+        int col = tick % cols;
+        int row = (rows-1) - (int)(((Uint64)(tick / cols) * 2*TILE_SIZE) % rows);
+        rect_t view = {row - SCREEN_HEIGHT/2, col - SCREEN_WIDTH/2, SCREEN_WIDTH, SCREEN_HEIGHT};
+        StreamWorldTouchRect(&world, view);
+        momentum_t momentum = {(float)row, (float)col, BLAST, 0};
+        launched += StreamWorldLaunch(&world, row, col, momentum);
+        StreamWorldStep(&world);
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    printf("%d ticks in %.3f s: %u launched, %d page-ins, %d write-backs, %u holds, %d tiles resident max\n",
+            ticks, seconds, launched, SDL_AtomicGet(&world.page_ins),
+            SDL_AtomicGet(&world.write_backs), world.holds, world.num_slots);
+    StreamWorldClose(&world);
+
+    // Every tile is on disk now: count what is there, and where
+    SDL_RWops *file = SDL_RWFromFile(path, "rb");
+    tile_t *tile = (tile_t*) calloc(1, sizeof(tile_t));
+    assert(file && tile);
+    u32 found = 0, misplaced = 0;
+    for (int t=0; t < world.tile_rows * world.tile_cols; t++)
+    {
+        memset(tile, 0, sizeof(tile_t)); // never written: empty
+        SDL_RWread(file, tile, sizeof(tile_t), 1);
+        for (int i=0; i < TILE_SIZE*TILE_SIZE; i++)
+        {
+            if (tile->color[i] != PROJECTILE_COLOR) continue;
+            found++;
+            int row = (t / world.tile_cols)*TILE_SIZE + i/TILE_SIZE;
+            int col = (t % world.tile_cols)*TILE_SIZE + i%TILE_SIZE;
+            misplaced += ((int)tile->momentum[i].x != row) || ((int)tile->momentum[i].y != col);
+        }
+    }
+    SDL_RWclose(file);
+    free(tile);
+    bool conserved = (launched == found + world.exits + world.merges);
+    printf("%u in the world, %u left it, %u merged: %s; %u misplaced\n",
+            found, world.exits, world.merges, conserved ? "all accounted for" : "NOT CONSERVED", misplaced);
+    return (conserved && !misplaced) ? 0 : 1;
+}
+
+// ----------
+// | Rewind |
+// ----------
+
+// A bounded history for scrubbing backward. Every tick stores only the tiles
+// that changed, found by comparing the world hash's per-tile hashes with the
+// ones seen at the last capture, so a capture costs little more than the hash
+// update. Every REWIND_KEYFRAME_TICKS ticks a keyframe stores every occupied
+// tile instead. A past tick is restored by replaying from the keyframe before
+// it. The history lives in one allocation of the budget, made when rewind is
+// turned on: a ring of frame bytes, each frame contiguous, and a ring of
+// frames indexing it. When a frame does not fit, the oldest keyframe goes,
+// with its deltas. If the newest keyframe's run fills the budget by itself,
+// the history starts over from a keyframe.
+//
+// Covers what the hash covers: projectiles and the player.
+//
+// Frame: rect_t player, u16 tiles, then per tile: u16 tile, u16 count and
+// count x (u16 cell in the tile, momentum_t).
+#define REWIND_KEYFRAME_TICKS 64
+#define REWIND_MIN_FRAME (sizeof(rect_t) + sizeof(u16)) // nothing changed
+#define REWIND_INDEX_BYTES 128 // budget per index entry; a tick with a few changed tiles
+#define REWIND_MAX_FRAME (REWIND_MIN_FRAME + HASH_TILES*2*sizeof(u16) + \
+        SCREEN_WIDTH*SCREEN_HEIGHT*(sizeof(u16) + sizeof(momentum_t)))
+
+typedef struct
+{
+    u32 tick;
+    bool keyframe;
+    size_t offset, size; // where in the byte ring
+} rewind_frame_t;
+
+typedef struct
+{
+    size_t budget;           // most bytes to keep, 0 when off
+    size_t used;             // bytes of the frames kept
+    arena_t arena;           // everything below, carved when rewind is turned on
+    rewind_frame_t *frames;  // ring, oldest at head, ticks increasing
+    int head, count, capacity;
+    u8 *bytes;               // ring of frame bytes
+    size_t bytes_size;
+    u32 keyframe_tick;       // tick of the newest keyframe
+    u64 tile[HASH_TILES];    // tile hashes at the last capture
+    bool synced;             // tile[] is the world as of the last capture
+    u8 *scratch;             // the frame being captured, REWIND_MAX_FRAME bytes
+} rewind_t;
+
+inline internal rewind_frame_t *RewindFrame(rewind_t *rewind, int i)
+{
+    return &rewind->frames[(rewind->head + i) % rewind->capacity];
+}
+
+internal void RewindDropOldest(rewind_t *rewind)
+{
+    rewind->used -= RewindFrame(rewind, 0)->size;
+    rewind->head = (rewind->head + 1) % rewind->capacity;
+    rewind->count--;
+}
+
+internal void RewindDropNewest(rewind_t *rewind)
+{
+    rewind->used -= RewindFrame(rewind, rewind->count - 1)->size;
+    rewind->count--;
+}
+
+internal void RewindFree(rewind_t *rewind)
+{
+    ArenaFree(&rewind->arena);
+    memset(rewind, 0, sizeof(*rewind));
+}
+
+/**
+ *  \brief Carve the rings and scratch out of `arena`
+ *
+ *  The budget pays for the index as well as the bytes. Quiet ticks can
+ *  fill the index before the bytes; then the oldest run goes just the same.
+ */
+internal void RewindLayout(rewind_t *rewind, arena_t *arena)
+{
+    rewind->capacity = (int)SDL_max(rewind->budget / REWIND_INDEX_BYTES, 1);
+    rewind->bytes_size = rewind->budget - rewind->capacity*sizeof(rewind_frame_t);
+    rewind->frames = (rewind_frame_t*) ArenaPush(arena, rewind->capacity*sizeof(rewind_frame_t));
+    rewind->bytes = (u8*) ArenaPush(arena, rewind->bytes_size);
+    rewind->scratch = (u8*) ArenaPush(arena, REWIND_MAX_FRAME);
+}
+
+internal void RewindInit(rewind_t *rewind, size_t budget)
+{
+    RewindFree(rewind);
+    rewind->budget = budget;
+    if (!budget) return;
+    arena_t arena = {0};
+    RewindLayout(rewind, &arena); // size it
+    ArenaInit(&arena, arena.used);
+    RewindLayout(rewind, &arena);
+    rewind->arena = arena;
+}
+
+internal void RewindWrite(rewind_t *rewind, size_t *size, const void *data, size_t bytes)
+{
+    assert(*size + bytes <= REWIND_MAX_FRAME);
+    memcpy(rewind->scratch + *size, data, bytes);
+    *size += bytes;
+}
+
+/**
+ *  \brief Where a frame of `size` bytes goes after the newest, if it fits yet
+ */
+internal bool RewindPlace(rewind_t *rewind, size_t size, size_t *offset)
+{
+    *offset = 0;
+    if (!rewind->count) return size <= rewind->bytes_size;
+    if (rewind->count == rewind->capacity) return false;
+    const rewind_frame_t *oldest = RewindFrame(rewind, 0);
+    const rewind_frame_t *newest = RewindFrame(rewind, rewind->count - 1);
+    size_t end = newest->offset + newest->size;
+    if (end > oldest->offset) // kept bytes do not wrap: room after them, or before them
+    {
+        if (end + size <= rewind->bytes_size) { *offset = end; return true; }
+        return size <= oldest->offset;
+    }
+    *offset = end;
+    return end + size <= oldest->offset;
+}
+
+/**
+ *  \brief Record the world as of `tick`
+ *
+ *  \param hash Updated for this frame already
+ */
+internal void RewindCapture(rewind_t *rewind, const world_hash_t *hash,
+        const u32 *frame, const momentum_t *momentum, rect_t player, u32 tick)
+{
+    if (!rewind->budget) return;
+    // Captures after a restore overwrite the history that followed it
+    while (rewind->count && (RewindFrame(rewind, rewind->count - 1)->tick >= tick))
+    {
+        RewindDropNewest(rewind);
+        rewind->synced = false;
+    }
+
+    bool keyframe = !rewind->synced || !rewind->count || (tick - rewind->keyframe_tick >= REWIND_KEYFRAME_TICKS);
+    size_t size = 0;
+    u16 tiles = 0;
+    RewindWrite(rewind, &size, &player, sizeof(player));
+    RewindWrite(rewind, &size, &tiles, sizeof(tiles));
+    for (int t=0; t < HASH_TILES; t++)
+    {
+        if (keyframe ? !hash->occupied[t] : (hash->tile[t] == rewind->tile[t])) continue;
+        tiles++;
+        u16 tile = (u16)t;
+        size_t count_at = size + sizeof(tile);
+        u16 count = 0;
+        RewindWrite(rewind, &size, &tile, sizeof(tile));
+        RewindWrite(rewind, &size, &count, sizeof(count));
+        int tile_row = t / SCREEN_TILE_COLS, tile_col = t % SCREEN_TILE_COLS;
+        int row_end = SDL_min((tile_row+1)*TILE_SIZE, SCREEN_HEIGHT);
+        int col_end = SDL_min((tile_col+1)*TILE_SIZE, SCREEN_WIDTH);
+        for (int row=tile_row*TILE_SIZE; row < row_end; row++)
+            for (int col=tile_col*TILE_SIZE; col < col_end; col++)
+            {
+                int i = row*SCREEN_WIDTH + col;
+                if (frame[i] != PROJECTILE_COLOR) continue;
+                u16 cell = (u16)((row - tile_row*TILE_SIZE)*TILE_SIZE + (col - tile_col*TILE_SIZE));
+                RewindWrite(rewind, &size, &cell, sizeof(cell));
+                RewindWrite(rewind, &size, &momentum[i], sizeof(momentum_t));
+                count++;
+            }
+        memcpy(rewind->scratch + count_at, &count, sizeof(count));
+    }
+    memcpy(rewind->scratch + sizeof(player), &tiles, sizeof(tiles));
+
+    // Make room: whole keyframe runs go from the front, never the newest
+    size_t offset;
+    while (!RewindPlace(rewind, size, &offset))
+    {
+        int next_keyframe = 1;
+        while ((next_keyframe < rewind->count) && !RewindFrame(rewind, next_keyframe)->keyframe) next_keyframe++;
+        if (next_keyframe < rewind->count)
+        {
+            while (next_keyframe--) RewindDropOldest(rewind);
+        }
+        else if (keyframe && rewind->count)
+        {
+            while (rewind->count) RewindDropOldest(rewind); // this starts a new run anyway
+        }
+        else if (rewind->count)
+        {
+            // The newest run fills the budget: start over from a keyframe
+            while (rewind->count) RewindDropOldest(rewind);
+            rewind->synced = false;
+            RewindCapture(rewind, hash, frame, momentum, player, tick);
+            return;
+        }
+        else
+        {
+            rewind->synced = false; // one keyframe is over budget: keep nothing
+            return;
+        }
+    }
+    memcpy(rewind->tile, hash->tile, sizeof(rewind->tile));
+    rewind->synced = true;
+    if (keyframe) rewind->keyframe_tick = tick;
+
+    rewind_frame_t *entry = &rewind->frames[(rewind->head + rewind->count++) % rewind->capacity];
+    entry->tick = tick;
+    entry->keyframe = keyframe;
+    entry->offset = offset;
+    entry->size = size;
+    memcpy(rewind->bytes + offset, rewind->scratch, size);
+    rewind->used += size;
+}
+
+/**
+ *  \brief Put the projectiles and player back as they were at `tick`
+ *
+ *  Later history stays until the next capture, so a restore can also move
+ *  forward again.
+ *
+ *  \return false if `tick` is not in the history
+ */
+internal bool RewindRestore(rewind_t *rewind, u32 tick, u32 *frame, momentum_t *momentum, rect_t *player)
+{
+    int lo = 0, hi = rewind->count - 1, found = -1;
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        u32 at = RewindFrame(rewind, mid)->tick;
+        if (at == tick) { found = mid; break; }
+        if (at < tick) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    if (found < 0) return false;
+    int start = found;
+    while (!RewindFrame(rewind, start)->keyframe) start--; // the oldest frame is always a keyframe
+
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    FillRect(entire_screen, EMPTY_SPACE, frame);
+    for (int f=start; f <= found; f++)
+    {
+        const u8 *in = rewind->bytes + RewindFrame(rewind, f)->offset;
+        u16 tiles;
+        memcpy(player, in, sizeof(*player));
+        memcpy(&tiles, in + sizeof(*player), sizeof(tiles));
+        in += sizeof(*player) + sizeof(tiles);
+        for (int n=0; n < tiles; n++)
+        {
+            u16 tile, count;
+            memcpy(&tile, in, sizeof(tile));
+            memcpy(&count, in + sizeof(tile), sizeof(count));
+            in += sizeof(tile) + sizeof(count);
+            int tile_row = tile / SCREEN_TILE_COLS, tile_col = tile % SCREEN_TILE_COLS;
+            rect_t bounds = {tile_row*TILE_SIZE, tile_col*TILE_SIZE,
+                SDL_min(TILE_SIZE, SCREEN_WIDTH - tile_col*TILE_SIZE),
+                SDL_min(TILE_SIZE, SCREEN_HEIGHT - tile_row*TILE_SIZE)};
+            FillRect(bounds, EMPTY_SPACE, frame);
+            for (int p=0; p < count; p++)
+            {
+                u16 cell;
+                memcpy(&cell, in, sizeof(cell));
+                int row = tile_row*TILE_SIZE + cell / TILE_SIZE;
+                int col = tile_col*TILE_SIZE + cell % TILE_SIZE;
+                ColorSetUnsafe(row, col, PROJECTILE_COLOR, frame);
+                memcpy(&momentum[row*SCREEN_WIDTH + col], in + sizeof(cell), sizeof(momentum_t));
+                in += sizeof(cell) + sizeof(momentum_t);
+            }
+        }
+    }
+    rewind->synced = false; // the next capture starts a keyframe
+    return true;
+}
+
+
+
+// -----------
+// | Palette |
+// -----------
+
+// Everything the world draws comes from a handful of colors plus two ramps, so
+// a frame fits in one byte per pixel. The byte indexes a 256-entry palette and
+// is only widened to ARGB on the way into the texture: a quarter of the color
+// bytes are written and read per frame, until the very last pass.
+#define PALETTE_SIZE 256
+#define PALETTE_EMPTY 0
+#define PALETTE_PROJECTILE 1
+#define PALETTE_PLAYER 2
+#define PALETTE_FLUID 3
+#define PALETTE_CLOUD 4
+#define PALETTE_LIFE 5
+#define PALETTE_TRAIL 8         // first fading trail shade
+#define PALETTE_TRAIL_LEVELS 64
+#define PALETTE_RAMP (PALETTE_TRAIL + PALETTE_TRAIL_LEVELS) // first heat ramp level
+#define PALETTE_RAMP_LEVELS (PALETTE_SIZE - PALETTE_RAMP)
+
+/**
+ *  \brief Palette index of heat ramp level 0..255, 0 being nothing
+ */
+inline internal u8 PaletteRamp(int level)
+{
+    if (level == 0) return PALETTE_EMPTY;
+    return (u8)(PALETTE_RAMP + (level-1)*PALETTE_RAMP_LEVELS/255);
+}
+
+/**
+ *  \brief Palette index of a trail pixel
+ *
+ *  DecayTrail() scales every channel alike, so the alpha says how faded it is.
+ */
+inline internal u8 PaletteTrail(u32 color)
+{
+    u32 alpha = color >> 24;
+    if (alpha == 0) return PALETTE_EMPTY;
+    if (alpha == 0xFF) return PALETTE_PROJECTILE;
+    return (u8)(PALETTE_TRAIL + alpha*PALETTE_TRAIL_LEVELS/256);
+}
+
+/**
+ *  \brief Fill the palette, taking the heat ramp from a heatmap look-up table
+ */
+internal void PaletteInit(u32 palette[PALETTE_SIZE], const u32 ramp[256])
+{
+    memset(palette, 0, PALETTE_SIZE * sizeof(u32));
+    palette[PALETTE_EMPTY] = EMPTY_SPACE;
+    palette[PALETTE_PROJECTILE] = PROJECTILE_COLOR;
+    palette[PALETTE_PLAYER] = PLAYER_COLOR;
+    palette[PALETTE_FLUID] = FLUID_COLOR;
+    palette[PALETTE_CLOUD] = CLOUD_COLOR;
+    palette[PALETTE_LIFE] = LIFE_COLOR;
+    for (int k=0; k < PALETTE_TRAIL_LEVELS; k++)
+    {
+        // Middle of the alphas that map to this shade
+        u32 alpha = (u32)((2*k + 1) * 256 / (2*PALETTE_TRAIL_LEVELS));
+        palette[PALETTE_TRAIL + k] = (alpha << 24) | (alpha << 16);
+    }
+    for (int k=0; k < PALETTE_RAMP_LEVELS; k++)
+    {
+        palette[PALETTE_RAMP + k] = ramp[1 + k*255/PALETTE_RAMP_LEVELS];
+    }
+}
+
+/**
+ *  \brief Index `index` where `colors` is `color`, PALETTE_EMPTY elsewhere
+ *
+ *  With SSE2, sixteen pixels at a time: the compare masks are packed down
+ *  from 32 to 8 bits, saturation keeping all-ones all-ones.
+ */
+internal void PaletteMatch(const u32 *colors, u32 color, u8 index, u8 *indexes, int count)
+{
+    int i = 0;
+#ifdef __SSE2__
+    __m128i match = _mm_set1_epi32((int)color), fill = _mm_set1_epi8((char)index);
+    for (; i+16 <= count; i += 16)
+    {
+        __m128i masks[4];
+        for (int k=0; k < 4; k++)
+        {
+            masks[k] = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(colors + i + 4*k)), match);
+        }
+        __m128i bytes = _mm_packs_epi16(_mm_packs_epi32(masks[0], masks[1]),
+                                        _mm_packs_epi32(masks[2], masks[3]));
+        _mm_storeu_si128((__m128i*)(indexes + i), _mm_and_si128(bytes, fill));
+    }
+#endif
+    for (; i < count; i++) indexes[i] = (colors[i] == color) ? index : PALETTE_EMPTY;
+}
+
+/**
+ *  \brief Widen one row of palette indexes to ARGB
+ *
+ *  With AVX2 every eight pixels are one zero-extend and one gather from the
+ *  palette, which stays in L1. Without it, a plain look-up loop does as well
+ *  as building vectors one lane at a time.
+ */
+internal void PaletteExpandRow(const u32 *palette, const u8 *indexes, u32 *pixels, int count)
+{
+    int i = 0;
+#ifdef __AVX2__
+    for (; i+8 <= count; i += 8)
+    {
+        __m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(indexes + i)));
+        __m256i colors = _mm256_i32gather_epi32((const int*)palette, lanes, sizeof(u32));
+        _mm256_storeu_si256((__m256i*)(pixels + i), colors);
+    }
+#endif
+    for (; i < count; i++) pixels[i] = palette[indexes[i]];
+}
+
+// -------------
+// | Splatting |
+// -------------
+
+// Anti-aliased projectiles. Each projectile is a scale x scale square at its
+// float position, added into every texel it overlaps by how much of the texel
+// it covers. At scale 1 those are the bilinear weights of the four pixels
+// around it. Positions are worked out eight projectiles at a time. Every
+// thread adds into its own coverage buffer, and the buffers are then summed
+// into shades of the projectile color, like the heatmap. Each buffer flags
+// the runs of SPLAT_RUN texels it touched, so summing skips empty space.
+#define SPLAT_LANES 8
+#define SPLAT_RUN 32 // texels along a row per touched flag
+
+typedef struct
+{
+    int rows, cols; // texels
+    int runs;       // SPLAT_RUN runs per row, padded to a multiple of 8
+    int scale;      // texels per pixel
+    int num_threads;
+    float *coverage[MAX_THREADS]; // per-thread, rows x cols each
+    bool *touched[MAX_THREADS];   // per-thread, rows x runs each
+    u8 shade[256]; // palette index for each coverage level
+} splat_t;
+
+internal void SplatInit(splat_t *splat, int scale, int num_threads, arena_t *arena)
+{
+    memset(splat, 0, sizeof(*splat));
+    splat->rows = SCREEN_HEIGHT*scale;
+    splat->cols = SCREEN_WIDTH*scale;
+    splat->runs = (splat->cols + 8*SPLAT_RUN-1) / (8*SPLAT_RUN) * 8; // flags go eight to a u64
+    splat->scale = scale;
+    splat->num_threads = num_threads;
+    for (int t=0; t < num_threads; t++)
+    {
+        splat->coverage[t] = (float*) ArenaPush(arena, (size_t)splat->rows*splat->cols * sizeof(float));
+        splat->touched[t] = (bool*) ArenaPush(arena, (size_t)splat->rows*splat->runs * sizeof(bool));
+    }
+    // The trail shades are the projectile color at every alpha
+    for (u32 level=0; level < 256; level++) splat->shade[level] = PaletteTrail(level << 24);
+}
+
+/**
+ *  \brief Share of edge texel k (0..scale) covered by a square `fraction` into its first texel
+ */
+inline internal float SplatEdge(int k, int scale, float fraction)
+{
+    return (k == 0) ? 1 - fraction : (k == scale) ? fraction : 1;
+}
+
+/**
+ *  \brief Add one square, top left corner at texel (row + row_fraction, col + col_fraction)
+ */
+inline internal void SplatSquare(splat_t *splat, int thread,
+        int row, int col, float row_fraction, float col_fraction)
+{
+    int scale = splat->scale;
+    int k_begin = SDL_max(-row, 0), k_end = SDL_min(scale, splat->rows-1 - row);
+    int m_begin = SDL_max(-col, 0), m_end = SDL_min(scale, splat->cols-1 - col);
+    if (m_begin > m_end) return;
+    for (int k=k_begin; k <= k_end; k++)
+    {
+        float weight = SplatEdge(k, scale, row_fraction);
+        float first = weight * (1 - col_fraction), last = weight * col_fraction;
+        float *out = splat->coverage[thread] + (size_t)(row + k)*splat->cols + col;
+        for (int m=m_begin; m <= m_end; m++) out[m] += (m == 0) ? first : (m == scale) ? last : weight;
+        bool *touched = splat->touched[thread] + (size_t)(row + k)*splat->runs;
+        for (int run=(col + m_begin)/SPLAT_RUN; run <= (col + m_end)/SPLAT_RUN; run++) touched[run] = true;
+    }
+}
+
+typedef struct
+{
+    splat_t *splat;
+    const u32 *frame;
+    const momentum_t *momentum;
+    float back; // fraction of a tick to go back
+    u8 *indexes;
+} splat_job_t;
+
+/**
+ *  \brief Splat the projectiles of grid rows [begin, end)
+ */
+internal void SplatJob(void *data, int begin, int end, int thread)
+{
+    splat_job_t *job = (splat_job_t*) data;
+    splat_t *splat = job->splat;
+    f32x8 x = {0}, y = {0}, dx = {0};
+    int lanes = 0;
+    for (int i=begin*SCREEN_WIDTH; i <= end*SCREEN_WIDTH; i++)
+    {
+        bool last = (i == end*SCREEN_WIDTH);
+        if (!last && (job->frame[i] == PROJECTILE_COLOR))
+        {
+            x[lanes] = job->momentum[i].x;
+            y[lanes] = job->momentum[i].y;
+            dx[lanes] = job->momentum[i].dx;
+            lanes++;
+        }
+        if ((lanes < SPLAT_LANES) && !(last && lanes)) continue;
+
+        // Corners in texels, split into whole texels and fractions
+        f32x8 top = (x - job->back*dx) * (float)splat->scale;
+        f32x8 left = y * (float)splat->scale;
+        i32x8 row = __builtin_convertvector(top, i32x8); // truncates, so floor below zero:
+        row += (i32x8)(__builtin_convertvector(row, f32x8) > top);
+        i32x8 col = __builtin_convertvector(left, i32x8);
+        col += (i32x8)(__builtin_convertvector(col, f32x8) > left);
+        f32x8 row_fraction = top - __builtin_convertvector(row, f32x8);
+        f32x8 col_fraction = left - __builtin_convertvector(col, f32x8);
+        for (int lane=0; lane < lanes; lane++)
+        {
+            SplatSquare(splat, thread, row[lane], col[lane], row_fraction[lane], col_fraction[lane]);
+        }
+        lanes = 0;
+    }
+}
+
+/**
+ *  \brief Sum texel rows [begin, end) over the threads that added to them, and start over
+ */
+internal void SplatResolveJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    splat_job_t *job = (splat_job_t*) data;
+    splat_t *splat = job->splat;
+    const f32x4 zero = {0}, one = zero + 1;
+    for (int row=begin; row < end; row++)
+    {
+        u8 *out = job->indexes + (size_t)row*splat->cols;
+        memset(out, splat->shade[0], splat->cols);
+        for (int run=0; run < splat->runs; run++)
+        {
+            if (run % 8 == 0) // skip eight runs nobody touched at once
+            {
+                u64 any = 0;
+                for (int t=0; t < splat->num_threads; t++)
+                {
+                    u64 flags;
+                    memcpy(&flags, &splat->touched[t][(size_t)row*splat->runs + run], sizeof(flags));
+                    any |= flags;
+                }
+                if (!any)
+                {
+                    run += 7;
+                    continue;
+                }
+            }
+            float *runs[MAX_THREADS];
+            int num_runs = 0;
+            for (int t=0; t < splat->num_threads; t++)
+            {
+                bool *touched = &splat->touched[t][(size_t)row*splat->runs + run];
+                if (!*touched) continue;
+                *touched = false;
+                runs[num_runs++] = splat->coverage[t] + (size_t)row*splat->cols;
+            }
+            if (!num_runs) continue;
+
+            int col = run*SPLAT_RUN, col_end = SDL_min(col + SPLAT_RUN, splat->cols);
+            for (; col+4 <= col_end; col += 4)
+            {
+                f32x4 sum = zero;
+                for (int r=0; r < num_runs; r++)
+                {
+                    f32x4 coverage;
+                    memcpy(&coverage, runs[r] + col, sizeof(coverage));
+                    sum += coverage;
+                    memcpy(runs[r] + col, &zero, sizeof(zero));
+                }
+                i32x4 over = (sum > one); // overlapping projectiles: full, not more
+                sum = (f32x4)(((i32x4)sum & ~over) | ((i32x4)one & over));
+                i32x4 level = __builtin_convertvector(sum*255 + 0.5f, i32x4);
+                for (int k=0; k < 4; k++) out[col+k] = splat->shade[level[k]];
+            }
+            for (; col < col_end; col++)
+            {
+                float sum = 0;
+                for (int r=0; r < num_runs; r++)
+                {
+                    sum += runs[r][col];
+                    runs[r][col] = 0;
+                }
+                out[col] = splat->shade[(int)(SDL_min(sum, 1.0f)*255 + 0.5f)];
+            }
+        }
+    }
+}
+
+/**
+ *  \brief Splat every projectile in `frame`, `back` of a tick ago, into palette indexes
+ *
+ *  \param indexes  splat->rows x splat->cols
+ */
+internal void SplatProjectiles(splat_t *splat, thread_pool_t *pool, const u32 *frame,
+        const momentum_t *momentum, float back, u8 *indexes)
+{
+    assert(pool->num_threads <= splat->num_threads);
+    splat_job_t job = {splat, frame, momentum, back, indexes};
+    ParallelFor(pool, SCREEN_HEIGHT, 8, SplatJob, &job);
+    ParallelFor(pool, splat->rows, SDL_max((1 << 14) / splat->cols, 1), SplatResolveJob, &job);
+}
+
+// ----------------
+// | Fast-Forward |
+// ----------------
+
+// Gravity is constant, so a projectile's row after t ticks is a closed form
+// (see StepProjectile()) and projectiles only ever touch each other by landing
+// on the same pixel. Everything that can happen between now and the end of a
+// jump is a handful of events per projectile: leaving the screen, and meeting
+// another projectile in its column. Those go in a priority queue, ordered by
+// tick; popping them in order replays every removal DrawProjectile() would
+// make, and the survivors move straight to the end. Time between events costs
+// nothing.
+//
+// The rules, from DrawProjectile()'s row-major scan:
+//   - Projectiles landing on the same pixel: the one from the lowest row (last
+//     scanned) wins.
+//   - A projectile leaving the screen erases its old pixel after the ones
+//     above it have moved, so one that moved down into that pixel goes too.
+// Positions follow the closed form, so they match tick-by-tick stepping up to
+// float rounding, like the LOD coarse region.
+//
+// Projectiles never change column, so each column replays on its own. A full
+// column has SCREEN_HEIGHT exits and a meet per pair at most, which bounds the
+// queue; it and the rest of the scratch are carved from the world's arena.
+#define FF_EXIT 0 // projectile leaves the screen
+#define FF_MEET 1 // two projectiles land on the same pixel
+#define FF_COLUMN_EVENTS (SCREEN_HEIGHT + SCREEN_HEIGHT*(SCREEN_HEIGHT-1)/2)
+
+typedef struct
+{
+    momentum_t start; // state at the start of the jump
+    int col;
+    u32 exit;         // first tick off the screen, past the jump if never
+    bool alive;
+} ff_particle_t;
+
+typedef struct
+{
+    u32 tick;
+    int kind;  // FF_EXIT or FF_MEET
+    int a, b;  // projectiles; b only for FF_MEET
+} ff_event_t;
+
+typedef struct
+{
+    ff_event_t *events; // binary min-heap on tick
+    int count, capacity;
+} ff_queue_t;
+
+typedef struct
+{
+    ff_particle_t *particles; // every projectile on the screen, by column
+    int *column_start;        // SCREEN_WIDTH+1 offsets into particles
+    ff_queue_t queue;         // one column's events
+} fast_forward_t;
+
+internal void FastForwardInit(fast_forward_t *ff, arena_t *arena)
+{
+    ff->particles = (ff_particle_t*) ArenaPush(arena, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(ff_particle_t));
+    ff->column_start = (int*) ArenaPush(arena, (SCREEN_WIDTH + 1) * sizeof(int));
+    ff->queue.events = (ff_event_t*) ArenaPush(arena, FF_COLUMN_EVENTS * sizeof(ff_event_t));
+    ff->queue.count = 0;
+    ff->queue.capacity = FF_COLUMN_EVENTS;
+}
+
+internal void FastForwardPush(ff_queue_t *queue, ff_event_t event)
+{
+    assert(queue->count < queue->capacity);
+    int i = queue->count++;
+    while ((i > 0) && (queue->events[(i-1)/2].tick > event.tick))
+    {
+        queue->events[i] = queue->events[(i-1)/2];
+        i = (i-1)/2;
+    }
+    queue->events[i] = event;
+}
+
+internal ff_event_t FastForwardPop(ff_queue_t *queue)
+{
+    ff_event_t top = queue->events[0];
+    ff_event_t last = queue->events[--queue->count];
+    int i = 0;
+    for (;;)
+    {
+        int child = 2*i + 1;
+        if (child >= queue->count) break;
+        if ((child+1 < queue->count) && (queue->events[child+1].tick < queue->events[child].tick)) child++;
+        if (queue->events[child].tick >= last.tick) break;
+        queue->events[i] = queue->events[child];
+        i = child;
+    }
+    if (queue->count) queue->events[i] = last;
+    return top;
+}
+
+/**
+ *  \brief Row position `t` ticks after `start`, in closed form
+ */
+inline internal double FastForwardX(const momentum_t *start, u32 t)
+{
+    return start->x + (double)t*start->dx + GRAVITY*(double)t*(t+1)/2;
+}
+
+/**
+ *  \brief Pixel row `t` ticks after `start`, truncated like DrawProjectile()
+ *
+ *  Anything off the screen is -1, so it never matches a real row.
+ */
+inline internal int FastForwardRow(const momentum_t *start, u32 t)
+{
+    double x = FastForwardX(start, t);
+    if ((x <= -1) || (x >= SCREEN_HEIGHT)) return -1;
+    return (int)x;
+}
+
+/**
+ *  \brief First tick `when` in [lo, hi] passes, given it fails then passes for good
+ *
+ *  \return hi + 1 if it never passes
+ */
+#define FAST_FORWARD_SEARCH(lo, hi, when) \
+    u32 found = (hi) + 1; \
+    for (u32 search_lo = (lo), search_hi = (hi); search_lo <= search_hi;) \
+    { \
+        u32 t = search_lo + (search_hi - search_lo)/2; \
+        if (when) { found = t; if (t == 0) break; search_hi = t - 1; } \
+        else search_lo = t + 1; \
+    }
+
+/**
+ *  \brief First tick the projectile is off the screen, or `horizon` if none sooner
+ *
+ *  The path is a parabola: up the screen until the top of the arc, then down.
+ *  Going up it can only leave through the top, coming down only through the
+ *  bottom, and each side is a search over a monotone stretch. (Leaving
+ *  through the top and falling back in counts: stepping erases it.)
+ */
+internal u32 FastForwardExit(const momentum_t *start, u32 horizon)
+{
+    // Ticks [1, apex) rise, and the highest tick is apex - 1 or apex
+    double vertex = -(start->dx + GRAVITY/2) / GRAVITY;
+    u32 apex = (vertex < 1) ? 1 : (vertex >= horizon) ? horizon : (u32)vertex + 1;
+    {
+        FAST_FORWARD_SEARCH(1, apex - 1, FastForwardX(start, t) <= -1);
+        if (found < apex) return found;
+    }
+    if (FastForwardX(start, apex) <= -1) return apex;
+    if (apex >= horizon) return horizon;
+
+    // Falling from here on: find some tick past the bottom, then the first
+    u32 hi = apex + 1;
+    while (FastForwardX(start, hi) < SCREEN_HEIGHT)
+    {
+        if (hi >= horizon) return horizon;
+        hi = (hi - apex > horizon - hi) ? horizon : hi + 2*(hi - apex);
+    }
+    FAST_FORWARD_SEARCH(apex, hi, FastForwardX(start, t) >= SCREEN_HEIGHT);
+    return found;
+}
+
+/**
+ *  \brief First tick two projectiles in a column share a pixel, 0 if none before `limit`
+ *
+ *  Gravity cancels in their difference, which is linear in t, so they can only
+ *  meet in the short window where it is under one pixel.
+ */
+internal u32 FastForwardMeet(const momentum_t *a, const momentum_t *b, u32 limit)
+{
+    double gap = (double)a->x - b->x;
+    double closing = (double)a->dx - b->dx;
+    double lo = 1, hi = (double)limit - 1;
+    if (closing != 0)
+    {
+        double t1 = (-1 - gap) / closing, t2 = (1 - gap) / closing;
+        lo = SDL_max(lo, SDL_floor(SDL_min(t1, t2)) - 1);
+        hi = SDL_min(hi, SDL_floor(SDL_max(t1, t2)) + 2);
+    }
+    else if ((gap <= -1) || (gap >= 1)) return 0;
+    for (double t=lo; t <= hi; t++)
+    {
+        int row = FastForwardRow(a, (u32)t);
+        if ((row >= 0) && (row == FastForwardRow(b, (u32)t))) return (u32)t;
+    }
+    return 0;
+}
+
+/**
+ *  \brief Jump `ticks` ticks through the projectiles in closed form
+ */
+internal void FastForwardProjectiles(fast_forward_t *ff, u32 *frame, u32 *frame_next,
+        momentum_t *momentum, u32 ticks)
+{
+    // Gather, with each column's projectiles together
+    ff_particle_t *particles = ff->particles;
+    int *column_start = ff->column_start;
+    int count = 0;
+    for (int col=0; col < SCREEN_WIDTH; col++)
+    {
+        column_start[col] = count;
+        for (int row=0; row < SCREEN_HEIGHT; row++)
+        {
+            if (ColorAt(row, col, frame) != PROJECTILE_COLOR) continue;
+            ff_particle_t *p = &particles[count++];
+            p->start = MomentumAt(row, col, momentum);
+            p->col = col;
+            p->alive = true;
+        }
+    }
+    column_start[SCREEN_WIDTH] = count;
+
+    u32 horizon = (ticks < UINT32_MAX) ? ticks + 1 : ticks;
+    for (int i=0; i < count; i++) particles[i].exit = FastForwardExit(&particles[i].start, horizon);
+    ff_queue_t *queue = &ff->queue;
+    for (int col=0; col < SCREEN_WIDTH; col++)
+    {
+        // Every event in this column before the end of the jump
+        queue->count = 0;
+        for (int i=column_start[col]; i < column_start[col+1]; i++)
+        {
+            if (particles[i].exit <= ticks)
+            {
+                ff_event_t exit = {particles[i].exit, FF_EXIT, i, -1};
+                FastForwardPush(queue, exit);
+            }
+            for (int j=i+1; j < column_start[col+1]; j++)
+            {
+                u32 limit = SDL_min(SDL_min(particles[i].exit, particles[j].exit), horizon);
+                u32 tick = FastForwardMeet(&particles[i].start, &particles[j].start, limit);
+                if (tick == 0) continue;
+                ff_event_t meet = {tick, FF_MEET, i, j};
+                FastForwardPush(queue, meet);
+            }
+        }
+
+        // Replay them in order. Removals only cancel events, never make new ones.
+        while (queue->count)
+        {
+            ff_event_t event = FastForwardPop(queue);
+            ff_particle_t *a = &particles[event.a];
+            if (event.kind == FF_MEET)
+            {
+                if (!a->alive || !particles[event.b].alive) continue;
+                // Everyone landing here this tick: the one from the lowest row wins
+                int row = FastForwardRow(&a->start, event.tick);
+                int winner = -1, winner_row = -1;
+                for (int i=column_start[col]; i < column_start[col+1]; i++)
+                {
+                    ff_particle_t *p = &particles[i];
+                    if (!p->alive || (FastForwardRow(&p->start, event.tick) != row)) continue;
+                    int from = FastForwardRow(&p->start, event.tick - 1);
+                    if (from > winner_row) { winner = i; winner_row = from; }
+                    p->alive = false;
+                }
+                particles[winner].alive = true;
+            }
+            else
+            {
+                if (!a->alive) continue;
+                a->alive = false;
+                // Its old pixel is erased after everything above it moved in
+                int row = FastForwardRow(&a->start, event.tick - 1);
+                for (int i=column_start[col]; i < column_start[col+1]; i++)
+                {
+                    ff_particle_t *p = &particles[i];
+                    if (!p->alive || (p->exit <= event.tick)) continue;
+                    if ((FastForwardRow(&p->start, event.tick) == row)
+                            && (FastForwardRow(&p->start, event.tick - 1) < row))
+                    {
+                        p->alive = false;
+                    }
+                }
+            }
+        }
+    }
+
+    // Survivors straight to the end
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    FillRect(entire_screen, EMPTY_SPACE, frame);
+    FillRect(entire_screen, EMPTY_SPACE, frame_next);
+    for (int i=0; i < count; i++)
+    {
+        ff_particle_t *p = &particles[i];
+        if (!p->alive || (p->exit <= ticks)) continue;
+        momentum_t moved = p->start;
+        moved.x = (float)FastForwardX(&p->start, ticks);
+        moved.dx = (float)(p->start.dx + GRAVITY*ticks);
+        int row = FastForwardRow(&p->start, ticks);
+        ColorSetUnsafe(row, p->col, PROJECTILE_COLOR, frame);
+        MomentumSetUnsafe(row, p->col, moved, momentum);
+    }
+}
+
+// -------------
+// | World API |
+// -------------
+
+// Everything one simulation needs, behind the opaque handle in momentum.h.
+// The front end (or any other client) drives it with WorldStep() and friends.
+#define CLOUD_COUNT 20000 // dust particles in the gravity cloud
+#define CLOUD_MESH 128    // next power of two past the screen; the extra wraps offscreen
+
+struct world_t
+{
+    thread_pool_t pool;
+    u64 seed;
+    u32 tick;
+    bool modes[WORLD_MODE_COUNT];
+
+    rect_t player;
+    u32 *player_buffer;
+    u32 *projectile_buffer, *projectile_buffer_next;
+    momentum_t *momentum, *momentum_next;
+
+    lod_t lod;
+    trail_t trail;
+    heatmap_t heatmap;
+    sph_t fluid;
+    stable_fluid_t wind;
+    lbm_t tunnel;
+    heat_t heat;
+    life_t life;
+    pm_t cloud_mesh;
+    momentum_t *cloud;
+    world_hash_t hash;
+    shm_export_t shm;
+    rewind_t rewind;
+    splat_t splat; // at the config's smooth_scale
+    fast_forward_t fast_forward; // scratch for WorldFastForward()
+    arena_t arena; // holds this struct, the screen-sized buffers and every mode's state
+
+    // Scratch for WorldRender(): each mode draws over the one before
+    u32 *layers[2];
+    u32 palette[PALETTE_SIZE]; // colors of WorldRenderIndexed()
+};
+
+/**
+ *  \brief Carve the world, its screen-sized buffers and its modes out of `arena`
+ *
+ *  In the order a tick touches them: projectiles and momentum read, then
+ *  written, then the layers drawn over them, then the optional modes.
+ */
+internal world_t *WorldLayout(arena_t *arena, int num_threads, int smooth_scale)
+{
+    size_t pixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+    world_t *world = (world_t*) ArenaPush(arena, sizeof(world_t));
+    u32 *projectile_buffer = (u32*) ArenaPush(arena, pixels * sizeof(u32));
+    momentum_t *momentum = (momentum_t*) ArenaPush(arena, pixels * sizeof(momentum_t));
+    u32 *projectile_buffer_next = (u32*) ArenaPush(arena, pixels * sizeof(u32));
+    momentum_t *momentum_next = (momentum_t*) ArenaPush(arena, pixels * sizeof(momentum_t));
+    u32 *player_buffer = (u32*) ArenaPush(arena, pixels * sizeof(u32));
+    u32 *trail = (u32*) ArenaPush(arena, pixels * sizeof(u32));
+    u32 *layer0 = (u32*) ArenaPush(arena, pixels * sizeof(u32));
+    u32 *layer1 = (u32*) ArenaPush(arena, pixels * sizeof(u32));
+
+    // While counting there is no world yet for the modes to fill in
+    world_t counting;
+    world_t *modes = world ? world : &counting;
+    HeatmapInit(&modes->heatmap, SCREEN_HEIGHT, SCREEN_WIDTH, num_threads, arena);
+    SphInit(&modes->fluid, SCREEN_HEIGHT, SCREEN_WIDTH, SCREEN_WIDTH * SCREEN_HEIGHT / 2, arena);
+    StableFluidInit(&modes->wind, SCREEN_HEIGHT, SCREEN_WIDTH, arena);
+    LbmInit(&modes->tunnel, SCREEN_HEIGHT, SCREEN_WIDTH, arena);
+    HeatInit(&modes->heat, SCREEN_HEIGHT, SCREEN_WIDTH, num_threads, arena);
+    LifeInit(&modes->life, SCREEN_HEIGHT, SCREEN_WIDTH, "B3/S23", arena);
+    PmInit(&modes->cloud_mesh, CLOUD_MESH, num_threads, arena);
+    SplatInit(&modes->splat, smooth_scale, num_threads, arena);
+    FastForwardInit(&modes->fast_forward, arena);
+    momentum_t *cloud = (momentum_t*) ArenaPush(arena, CLOUD_COUNT * sizeof(momentum_t));
+    if (!world) return NULL; // only counting
+    world->projectile_buffer = projectile_buffer;
+    world->momentum = momentum;
+    world->projectile_buffer_next = projectile_buffer_next;
+    world->momentum_next = momentum_next;
+    world->player_buffer = player_buffer;
+    world->trail.pixels = trail;
+    world->layers[0] = layer0;
+    world->layers[1] = layer1;
+    world->cloud = cloud;
+    world->arena = *arena;
+    return world;
+}
+
+world_t *WorldCreate(const world_config_t *config)
+{
+    world_config_t defaults = {0, 0x6D6F6D656E74756D, 5}; // seed: "momentum"
+    if (!config) config = &defaults;
+    int num_threads = ThreadPoolSize(config->threads);
+    int smooth_scale = (config->smooth_scale > 0) ? config->smooth_scale : 5;
+    arena_t arena = {0};
+    WorldLayout(&arena, num_threads, smooth_scale); // size it
+    ArenaInit(&arena, arena.used);
+    world_t *world = WorldLayout(&arena, num_threads, smooth_scale);
+    ThreadPoolInit(&world->pool, num_threads);
+    world->seed = config->seed;
+
+    // Start player at bottom left: a 1x1 rectangle
+    rect_t player = {0,0,1,1}; // row,col,w,h
+    world->player = player;
+    MoveRect(&world->player, (SCREEN_HEIGHT-1)-player.h, 0);
+    FillRect(world->player, PLAYER_COLOR, world->player_buffer);
+
+    PaletteInit(world->palette, world->heatmap.lut);
+    WorldHashReset(&world->hash);
+    return world;
+}
+
+void WorldDestroy(world_t *world)
+{
+    RewindFree(&world->rewind);
+    ShmExportClose(&world->shm);
+    ThreadPoolFree(&world->pool);
+    arena_t arena = world->arena; // the world lives in it
+    ArenaFree(&arena);
+}
+
+/**
+ *  \brief Add the current tick to the rewind history, if it is on
+ */
+internal void WorldCapture(world_t *world)
+{
+    if (!world->rewind.budget) return;
+    WorldHashUpdate(&world->hash, world->projectile_buffer, world->momentum, world->player);
+    RewindCapture(&world->rewind, &world->hash, world->projectile_buffer, world->momentum,
+            world->player, world->tick);
+}
+
+void WorldStep(world_t *world)
+{
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    rect_t player = world->player;
+    thread_pool_t *pool = &world->pool;
+    bool *modes = world->modes;
+
+    if (modes[WORLD_LOD])
+    {
+        // Draw projectiles for next frame, full detail near the player
+        DrawProjectileLOD(world->projectile_buffer, world->projectile_buffer_next,
+                world->momentum, world->momentum_next, &world->lod, LODFocus(player));
+    }
+    else
+    {
+        // Erase old artwork
+        FillRect(entire_screen, EMPTY_SPACE, world->projectile_buffer_next);
+
+        // Draw projectiles for next frame
+        DrawProjectile(world->projectile_buffer, world->projectile_buffer_next,
+                world->momentum, world->momentum_next);
+    }
+
+    // Load next position frame
+    u32 *tmp_pix = world->projectile_buffer;
+    world->projectile_buffer = world->projectile_buffer_next;
+    world->projectile_buffer_next = tmp_pix;
+    // Load next momentum frame
+    momentum_t *tmp_mom = world->momentum;
+    world->momentum = world->momentum_next;
+    world->momentum_next = tmp_mom;
+
+    u32 *frame = world->projectile_buffer;
+    if (modes[WORLD_TRAILS])
+    {
+        DecayTrail(&world->trail);
+        StampTrail(frame, &world->trail);
+    }
+    if (modes[WORLD_HEATMAP])
+    {
+        HeatmapScatterGrid(&world->heatmap, pool, frame);
+    }
+    if (modes[WORLD_WIND])
+    {
+        rect_t fan = {player.x - 2, player.y - 2, player.w + 4, player.h + 4};
+        StableFluidAddVelocity(&world->wind, fan, -0.2f, 0);
+        StableFluidStep(&world->wind, pool);
+        StableFluidDragGrid(&world->wind, frame, world->momentum);
+        if (modes[WORLD_FLUID])
+        {
+            for (int i=0; i < world->fluid.count; i++) StableFluidDrag(&world->wind, &world->fluid.particles[i]);
+        }
+    }
+    if (modes[WORLD_FLUID])
+    {
+        SphStep(&world->fluid, pool);
+    }
+    if (modes[WORLD_TUNNEL])
+    {
+        LbmSetObstacles(&world->tunnel, frame, world->player_buffer);
+        LbmStep(&world->tunnel, pool); // even
+        LbmStep(&world->tunnel, pool); // odd
+    }
+    if (modes[WORLD_HEAT])
+    {
+        HeatCouple(&world->heat, frame, world->momentum, player);
+        HeatStep(&world->heat, pool, 1);
+    }
+    if (modes[WORLD_CLOUD])
+    {
+        PmStep(&world->cloud_mesh, pool, world->cloud, CLOUD_COUNT);
+    }
+    if (modes[WORLD_LIFE])
+    {
+        // One generation per tick, with every projectile a live cell
+        for (int i=0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
+        {
+            if (frame[i] == PROJECTILE_COLOR) LifeSet(&world->life, i / SCREEN_WIDTH, i % SCREEN_WIDTH, true);
+        }
+        LifeStep(&world->life, pool);
+    }
+    if (world->shm.header)
+    {
+        ShmExportPublish(&world->shm, frame, world->momentum, world->tick);
+    }
+    world->tick++;
+    WorldCapture(world);
+}
+
+void WorldLaunch(world_t *world)
+{
+    if (world->modes[WORLD_FLUID])
+    {
+        SphAddBlock(&world->fluid, 0, SCREEN_WIDTH/2 - 5, 10, 10);
+        return;
+    }
+    // New projectile is at this tick: the coarse region must be too
+    LODSettle(world->projectile_buffer, world->projectile_buffer_next,
+            world->momentum, world->momentum_next, &world->lod);
+    InitProjectile(world->projectile_buffer, world->momentum);
+}
+
+void WorldMovePlayer(world_t *world, int rows, int cols)
+{
+    rect_t *player = &world->player;
+    FillRect(*player, EMPTY_SPACE, world->player_buffer);
+    if ((rows > 0) && ((player->x + player->h) < (SCREEN_HEIGHT-1))) // not at bottom yet
+    {
+        MoveRect(player, player->x+player->h, player->y);
+    }
+    if ((rows < 0) && (player->x > (0 + player->h))) // not at top yet
+    {
+        MoveRect(player, player->x-player->h, player->y);
+    }
+    if ((cols < 0) && (player->y > 0))
+    {
+        MoveRect(player, player->x, player->y-player->w);
+    }
+    if ((cols > 0) && (player->y < (SCREEN_WIDTH - player->w)))
+    {
+        MoveRect(player, player->x, player->y+player->w);
+    }
+    FillRect(*player, PLAYER_COLOR, world->player_buffer);
+}
+
+void WorldSetMode(world_t *world, world_mode_t mode, int enabled)
+{
+    assert((mode >= 0) && (mode < WORLD_MODE_COUNT));
+    if (enabled && !world->modes[mode])
+    {
+        switch (mode)
+        {
+            case WORLD_LIFE:
+                // Start from a random soup
+                for (int row=0; row < SCREEN_HEIGHT; row++)
+                    for (int col=0; col < SCREEN_WIDTH; col++)
+                    {
+                        u32 bits = RngU32(world->seed, world->tick, row*SCREEN_WIDTH + col, 0);
+                        LifeSet(&world->life, row, col, (bits & 3) == 0);
+                    }
+                break;
+
+            case WORLD_CLOUD:
+                // Start a fresh cloud: a square of dust at rest mid-screen
+                for (int i=0; i < CLOUD_COUNT; i++)
+                {
+                    momentum_t *dust = &world->cloud[i];
+                    dust->x = SCREEN_HEIGHT/4 + RngUnit(RngU32(world->seed, world->tick, i, 0)) * SCREEN_HEIGHT/2;
+                    dust->y = SCREEN_WIDTH/4 + RngUnit(RngU32(world->seed, world->tick, i, 1)) * SCREEN_WIDTH/2;
+                    dust->dx = 0;
+                    dust->dy = 0;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+    if (mode == WORLD_LOD) // catch up, and resync if it stays on
+    {
+        LODSettle(world->projectile_buffer, world->projectile_buffer_next,
+                world->momentum, world->momentum_next, &world->lod);
+    }
+    world->modes[mode] = (enabled != 0);
+}
+
+int WorldMode(const world_t *world, world_mode_t mode)
+{
+    assert((mode >= 0) && (mode < WORLD_MODE_COUNT));
+    return world->modes[mode];
+}
+
+void WorldSize(const world_t *world, int *rows, int *cols)
+{
+    (void)world;
+    *rows = SCREEN_HEIGHT;
+    *cols = SCREEN_WIDTH;
+}
+
+void WorldPlayer(const world_t *world, int *row, int *col)
+{
+    *row = world->player.x;
+    *col = world->player.y;
+}
+
+uint32_t WorldTick(const world_t *world)
+{
+    return world->tick;
+}
+
+uint64_t WorldHash(world_t *world)
+{
+    return WorldHashUpdate(&world->hash, world->projectile_buffer, world->momentum, world->player);
+}
+
+void WorldRender(world_t *world, uint32_t *pixels, uint32_t *player_pixels)
+{
+    if (player_pixels)
+    {
+        memcpy(player_pixels, world->player_buffer, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(u32));
+    }
+    if (!pixels) return;
+
+    bool *modes = world->modes;
+    u32 *projectile_pixels = modes[WORLD_TRAILS] ? world->trail.pixels : world->projectile_buffer;
+    int next = 0; // scratch layer to draw into
+    if (modes[WORLD_HEATMAP])
+    {
+        HeatmapResolve(&world->heatmap, &world->pool, world->layers[next]);
+        projectile_pixels = world->layers[next];
+        next ^= 1;
+    }
+    if (modes[WORLD_TUNNEL])
+    {
+        // Color the flow by speed under whatever else is drawn
+        u32 *layer = world->layers[next];
+        for (int row=0; row < SCREEN_HEIGHT; row++)
+            for (int col=0; col < SCREEN_WIDTH; col++)
+            {
+                int i = row*SCREEN_WIDTH + col;
+                float u, v;
+                LbmVelocity(&world->tunnel, row, col, &u, &v);
+                int level = SDL_min((int)(SDL_sqrtf(u*u + v*v)*(255/0.05f)), 255);
+                layer[i] = projectile_pixels[i] ? projectile_pixels[i]
+                         : world->tunnel.solid[i] ? EMPTY_SPACE
+                         : world->heatmap.lut[level];
+            }
+        projectile_pixels = layer;
+        next ^= 1;
+    }
+    if (modes[WORLD_LIFE])
+    {
+        u32 *layer = world->layers[next];
+        for (int i=0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
+        {
+            layer[i] = projectile_pixels[i] ? projectile_pixels[i]
+                     : LifeAt(&world->life, i / SCREEN_WIDTH, i % SCREEN_WIDTH) ? LIFE_COLOR
+                     : EMPTY_SPACE;
+        }
+        projectile_pixels = layer;
+        next ^= 1;
+    }
+    if (modes[WORLD_HEAT])
+    {
+        // Glow by temperature under whatever else is drawn
+        u32 *layer = world->layers[next];
+        for (int i=0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
+        {
+            int level = SDL_min((int)(world->heat.t[i]*255), 255);
+            layer[i] = projectile_pixels[i] ? projectile_pixels[i]
+                     : level ? world->heatmap.lut[level] : EMPTY_SPACE;
+        }
+        projectile_pixels = layer;
+        next ^= 1;
+    }
+
+    // Particles draw on top of everything
+    memcpy(pixels, projectile_pixels, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(u32));
+    if (modes[WORLD_FLUID])
+    {
+        for (int i=0; i < world->fluid.count; i++)
+        {
+            ColorSetUnsafe((int)world->fluid.particles[i].x, (int)world->fluid.particles[i].y,
+                    FLUID_COLOR, pixels);
+        }
+    }
+    if (modes[WORLD_CLOUD])
+    {
+        for (int i=0; i < CLOUD_COUNT; i++)
+        {
+            int row = (int)world->cloud[i].x, col = (int)world->cloud[i].y;
+            if ((row < SCREEN_HEIGHT) && (col < SCREEN_WIDTH))
+            {
+                ColorSetUnsafe(row, col, CLOUD_COLOR, pixels);
+            }
+        }
+    }
+}
+
+const uint32_t *WorldPalette(const world_t *world)
+{
+    return world->palette;
+}
+
+void WorldRenderIndexed(world_t *world, uint8_t *indexes, uint8_t *player_indexes)
+{
+    int pixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+    if (player_indexes)
+    {
+        // The player buffer only ever holds the player rect
+        memset(player_indexes, PALETTE_EMPTY, pixels);
+        rect_t player = world->player;
+        for (int row=player.x; row < player.x + player.h; row++)
+        {
+            memset(player_indexes + row*SCREEN_WIDTH + player.y, PALETTE_PLAYER, player.w);
+        }
+    }
+    if (!indexes) return;
+
+    // Same layers as WorldRender(), but each one only fills in what is still
+    // empty, so they all draw in place
+    bool *modes = world->modes;
+    if (modes[WORLD_HEATMAP])
+    {
+        HeatmapResolveLevels(&world->heatmap, &world->pool, indexes);
+        for (int i=0; i < pixels; i++) indexes[i] = PaletteRamp(indexes[i]);
+    }
+    else if (modes[WORLD_TRAILS])
+    {
+        u8 shades[256]; // by alpha
+        for (u32 alpha=0; alpha < 256; alpha++) shades[alpha] = PaletteTrail(alpha << 24);
+        for (int i=0; i < pixels; i++) indexes[i] = shades[world->trail.pixels[i] >> 24];
+    }
+    else
+    {
+        PaletteMatch(world->projectile_buffer, PROJECTILE_COLOR, PALETTE_PROJECTILE, indexes, pixels);
+    }
+    if (modes[WORLD_TUNNEL])
+    {
+        for (int row=0; row < SCREEN_HEIGHT; row++)
+            for (int col=0; col < SCREEN_WIDTH; col++)
+            {
+                int i = row*SCREEN_WIDTH + col;
+                if (indexes[i] || world->tunnel.solid[i]) continue;
+                float u, v;
+                LbmVelocity(&world->tunnel, row, col, &u, &v);
+                indexes[i] = PaletteRamp(SDL_min((int)(SDL_sqrtf(u*u + v*v)*(255/0.05f)), 255));
+            }
+    }
+    if (modes[WORLD_LIFE])
+    {
+        for (int i=0; i < pixels; i++)
+        {
+            if (!indexes[i] && LifeAt(&world->life, i / SCREEN_WIDTH, i % SCREEN_WIDTH))
+            {
+                indexes[i] = PALETTE_LIFE;
+            }
+        }
+    }
+    if (modes[WORLD_HEAT])
+    {
+        for (int i=0; i < pixels; i++)
+        {
+            if (!indexes[i]) indexes[i] = PaletteRamp(SDL_min((int)(world->heat.t[i]*255), 255));
+        }
+    }
+
+    // Particles draw on top of everything
+    if (modes[WORLD_FLUID])
+    {
+        for (int i=0; i < world->fluid.count; i++)
+        {
+            int row = (int)world->fluid.particles[i].x, col = (int)world->fluid.particles[i].y;
+            indexes[row*SCREEN_WIDTH + col] = PALETTE_FLUID;
+        }
+    }
+    if (modes[WORLD_CLOUD])
+    {
+        for (int i=0; i < CLOUD_COUNT; i++)
+        {
+            int row = (int)world->cloud[i].x, col = (int)world->cloud[i].y;
+            if ((row < SCREEN_HEIGHT) && (col < SCREEN_WIDTH))
+            {
+                indexes[row*SCREEN_WIDTH + col] = PALETTE_CLOUD;
+            }
+        }
+    }
+}
+
+void WorldRenderInterpolated(world_t *world, float alpha, int scale, uint8_t *indexes)
+{
+    int rows = SCREEN_HEIGHT*scale, cols = SCREEN_WIDTH*scale;
+    bool plain = true; // only plain projectiles know where they were a tick ago
+    for (int mode=0; mode < WORLD_MODE_COUNT; mode++)
+    {
+        if ((mode != WORLD_LOD) && (mode != WORLD_SMOOTH) && world->modes[mode]) plain = false;
+    }
+    if (!plain)
+    {
+        // Scale up the whole frame instead; the layers are free scratch here
+        u8 *frame = (u8*) world->layers[0];
+        WorldRenderIndexed(world, frame, NULL);
+        for (int row=0; row < rows; row++)
+        {
+            const u8 *in = frame + (row/scale)*SCREEN_WIDTH;
+            u8 *out = indexes + (size_t)row*cols;
+            for (int col=0; col < SCREEN_WIDTH; col++) memset(out + col*scale, in[col], scale);
+        }
+        return;
+    }
+
+    float back = 1 - alpha; // fraction of a tick to go back
+    if (world->modes[WORLD_SMOOTH] && (scale == world->splat.scale))
+    {
+        SplatProjectiles(&world->splat, &world->pool, world->projectile_buffer, world->momentum,
+                back, indexes);
+        return;
+    }
+    memset(indexes, PALETTE_EMPTY, (size_t)rows*cols);
+    for (int i=0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
+    {
+        if (world->projectile_buffer[i] != PROJECTILE_COLOR) continue;
+        momentum_t momentum = world->momentum[i];
+        // A tick is "dx += GRAVITY; x += dx", so a tick ago it was at x - dx
+        int top = (int)SDL_floor((momentum.x - back*momentum.dx) * scale);
+        int left = (int)SDL_floor(momentum.y * scale);
+        int bottom = SDL_min(top + scale, rows), right = SDL_min(left + scale, cols);
+        top = SDL_max(top, 0);
+        left = SDL_max(left, 0);
+        if (right <= left) continue;
+        for (int row=top; row < bottom; row++)
+        {
+            memset(indexes + (size_t)row*cols + left, PALETTE_PROJECTILE, right - left);
+        }
+    }
+}
+
+void PaletteExpand(const uint32_t *palette, const uint8_t *indexes, int rows, int cols,
+        void *pixels, int pitch)
+{
+    for (int row=0; row < rows; row++)
+    {
+        PaletteExpandRow(palette, indexes + (size_t)row*cols, (u32*)((u8*)pixels + (size_t)row*pitch), cols);
+    }
+}
+
+int WorldGetParticles(const world_t *world, momentum_t *particles, int max)
+{
+    int count = 0;
+    for (int i=0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
+    {
+        if (world->projectile_buffer[i] != PROJECTILE_COLOR) continue;
+        if (count < max) particles[count] = world->momentum[i];
+        count++;
+    }
+    return count;
+}
+
+int WorldSetParticles(world_t *world, const momentum_t *particles, int count)
+{
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    FillRect(entire_screen, EMPTY_SPACE, world->projectile_buffer);
+    int placed = 0;
+    for (int i=0; i < count; i++)
+    {
+        momentum_t particle = particles[i];
+        // Truncation puts (-1,0) on row or column 0, as DrawProjectile() does
+        // for a projectile just above the top
+        if ((particle.x <= -1) || (particle.y <= -1)) continue;
+        int row = (int)particle.x, col = (int)particle.y;
+        if (ColorAt(row, col, world->projectile_buffer) != EMPTY_SPACE) continue; // off grid or taken
+        ColorSetUnsafe(row, col, PROJECTILE_COLOR, world->projectile_buffer);
+        MomentumSetUnsafe(row, col, particle, world->momentum);
+        placed++;
+    }
+    memset(&world->lod, 0, sizeof(world->lod)); // everything is new: resync
+    return placed;
+}
+
+int WorldShare(world_t *world, const char *name)
+{
+    ShmExportClose(&world->shm);
+    return ShmExportOpen(&world->shm, name, SCREEN_HEIGHT, SCREEN_WIDTH);
+}
+
+void WorldSetRewind(world_t *world, size_t budget_bytes)
+{
+    RewindInit(&world->rewind, budget_bytes);
+    WorldCapture(world); // the history starts here
+}
+
+int WorldRewindRange(world_t *world, uint32_t *first, uint32_t *last)
+{
+    rewind_t *rewind = &world->rewind;
+    if (!rewind->count) return 0;
+    *first = RewindFrame(rewind, 0)->tick;
+    *last = RewindFrame(rewind, rewind->count - 1)->tick;
+    return 1;
+}
+
+int WorldRewind(world_t *world, uint32_t tick)
+{
+    rect_t player = world->player;
+    if (!RewindRestore(&world->rewind, tick, world->projectile_buffer, world->momentum, &player)) return 0;
+    FillRect(world->player, EMPTY_SPACE, world->player_buffer);
+    world->player = player;
+    FillRect(world->player, PLAYER_COLOR, world->player_buffer);
+    memset(&world->lod, 0, sizeof(world->lod)); // everything is new: resync
+    world->tick = tick;
+    return 1;
+}
+
+/**
+ *  \brief Headless check: creating a world is one allocation, and a tick none
+ *
+ *  momentum.exe --allocs [ticks]
+ *
+ *  Turns on rewind, which may allocate once. Steps and renders with every
+ *  mode on, launching and now and then rewinding as it goes, then again
+ *  anti-aliased between ticks with only WORLD_SMOOTH on, now and then
+ *  fast-forwarding. Counts what goes
+ *  through CountedCalloc(), such as arenas, not SDL's thread pool.
+ */
+internal int AllocationCheck(int argc, char **argv)
+{
+    int ticks = (argc > 0) ? atoi(argv[0]) : 100;
+    int scale = 5; // WorldCreate(NULL) anti-aliases at this scale
+    size_t pixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+    u32 *argb = (u32*) calloc(pixels, sizeof(u32));
+    u8 *indexes = (u8*) calloc(pixels * scale*scale, 1);
+    assert(argb && indexes);
+
+    int before = SDL_AtomicGet(&allocations);
+    world_t *world = WorldCreate(NULL);
+    int create = SDL_AtomicGet(&allocations) - before;
+    before = SDL_AtomicGet(&allocations);
+    WorldSetRewind(world, 256 << 10);
+    int rewind = SDL_AtomicGet(&allocations) - before;
+
+    for (int mode=0; mode < WORLD_MODE_COUNT; mode++) WorldSetMode(world, (world_mode_t)mode, 1);
+    before = SDL_AtomicGet(&allocations);
+    for (int tick=0; tick < ticks; tick++)
+    {
+        if (tick % 10 == 0) WorldLaunch(world);
+        if (tick % 25 == 24) WorldRewind(world, WorldTick(world) - 5);
+        WorldStep(world);
+        WorldRender(world, argb, argb);
+        WorldRenderIndexed(world, indexes, indexes);
+    }
+    for (int mode=0; mode < WORLD_MODE_COUNT; mode++) WorldSetMode(world, (world_mode_t)mode, mode == WORLD_SMOOTH);
+    for (int tick=0; tick < ticks; tick++)
+    {
+        if (tick % 10 == 0) WorldLaunch(world);
+        if (tick % 25 == 24) WorldFastForward(world, 50);
+        WorldStep(world);
+        WorldRenderInterpolated(world, 0.5f, scale, indexes);
+    }
+    int step = SDL_AtomicGet(&allocations) - before;
+    WorldDestroy(world);
+    free(argb);
+    free(indexes);
+
+    printf("WorldCreate: %d allocations (want 1); WorldSetRewind: %d (want 1); "
+           "2 x %d ticks stepped and drawn: %d (want 0)\n", create, rewind, ticks, step);
+    return ((create == 1) && (rewind == 1) && (step == 0)) ? 0 : 1;
+}
+
+void WorldFastForward(world_t *world, uint32_t ticks)
+{
+    // Only plain projectiles have a closed form; anything else steps
+    for (int mode=0; mode < WORLD_MODE_COUNT; mode++)
+    {
+        if ((mode != WORLD_LOD) && (mode != WORLD_SMOOTH) && world->modes[mode])
+        {
+            for (u32 tick=0; tick < ticks; tick++) WorldStep(world);
+            return;
+        }
+    }
+    if (ticks == 0) return;
+    LODSettle(world->projectile_buffer, world->projectile_buffer_next,
+            world->momentum, world->momentum_next, &world->lod); // all from one tick
+    FastForwardProjectiles(&world->fast_forward, world->projectile_buffer, world->projectile_buffer_next,
+            world->momentum, ticks);
+    world->tick += ticks;
+    if (world->shm.header)
+    {
+        ShmExportPublish(&world->shm, world->projectile_buffer, world->momentum, world->tick - 1);
+    }
+    WorldCapture(world);
+}
+
+/**
+ *  \brief Headless check of fast-forward against stepping, then a long jump
+ *
+ *  momentum.exe --fast-forward [ticks] [projectiles]
+ *
+ *  Scatters projectiles over the screen with random speeds, so plenty of them
+ *  collide, and compares fast-forward with WorldStep() at several points along
+ *  the way. Then times a jump of `ticks` ticks.
+ */
+internal int FastForwardBenchmark(int argc, char **argv)
+{
+    u32 ticks = (argc > 0) ? (u32)atoi(argv[0]) : 1000000;
+    int seeded = (argc > 1) ? atoi(argv[1]) : 300;
+    int max = SCREEN_WIDTH * SCREEN_HEIGHT;
+    momentum_t *start = (momentum_t*) calloc(max, sizeof(momentum_t));
+    momentum_t *stepped = (momentum_t*) calloc(max, sizeof(momentum_t));
+    momentum_t *jumped = (momentum_t*) calloc(max, sizeof(momentum_t));
+    assert(start && stepped && jumped);
+    world_config_t config = {1, 7, 0};
+    ScatterParticles(config.seed, seeded, 3, start);
+
+    world_t *reference = WorldCreate(&config);
+    world_t *world = WorldCreate(&config);
+    WorldSetParticles(reference, start, seeded);
+    u32 checks[] = {1, 2, 5, 10, 25, 50, 100, 200, 400};
+    int differ = 0;
+    u32 done = 0;
+    float worst = 0;
+    for (int c=0; c < (int)SDL_arraysize(checks); c++)
+    {
+        for (; done < checks[c]; done++) WorldStep(reference);
+        WorldSetParticles(world, start, seeded);
+        WorldFastForward(world, checks[c]);
+        int count = WorldGetParticles(reference, stepped, max);
+        int count_jumped = WorldGetParticles(world, jumped, max);
+        bool same = (count == count_jumped);
+        for (int i=0; same && (i < count); i++)
+        {
+            // Rounding can tip a projectile over a row boundary, so compare positions
+            same = (SDL_fabsf(stepped[i].x - jumped[i].x) < 1e-3f) && (stepped[i].y == jumped[i].y);
+            worst = SDL_max(worst, SDL_fabsf(stepped[i].x - jumped[i].x));
+        }
+        printf("tick %4u: %4d stepped, %4d fast-forward%s\n", checks[c], count, count_jumped, same ? "" : "  DIFFER");
+        differ += !same;
+    }
+    printf("largest position difference %g rows\n", worst);
+
+    WorldSetParticles(world, start, seeded);
+    Uint64 begin = SDL_GetPerformanceCounter();
+    WorldFastForward(world, ticks);
+    double seconds = (double)(SDL_GetPerformanceCounter() - begin) / SDL_GetPerformanceFrequency();
+    printf("%u ticks of %d projectiles in %.3f ms, %d left\n",
+            ticks, seeded, 1e3*seconds, WorldGetParticles(world, jumped, max));
+
+    WorldDestroy(reference);
+    WorldDestroy(world);
+    free(start);
+    free(stepped);
+    free(jumped);
+    return differ ? 1 : 0;
+}
+
+/**
+ *  \brief Headless check of rewind: step a busy world, then jump around its past
+ *
+ *  momentum.exe --rewind [ticks] [budget KB]
+ *
+ *  Keeps every tick's world hash, then rewinds to ticks in a scrambled order
+ *  and checks the hash comes back the same.
+ */
+internal int RewindBenchmark(int argc, char **argv)
+{
+    int ticks = (argc > 0) ? atoi(argv[0]) : 5000;
+    size_t budget = (size_t)((argc > 1) ? atoi(argv[1]) : 1024) * 1024;
+
+    world_t *world = WorldCreate(NULL);
+    u64 *hashes = (u64*) calloc(ticks + 1, sizeof(u64));
+    assert(hashes);
+    WorldSetRewind(world, budget);
+    u32 first_tick = WorldTick(world);
+    hashes[0] = WorldHash(world);
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int tick=1; tick <= ticks; tick++)
+    {
+        if (tick % 3 == 0) WorldLaunch(world);
+        if (tick % 50 == 0) WorldMovePlayer(world, 0, (tick % 400 < 200) ? 1 : -1);
+        WorldStep(world);
+        hashes[tick] = WorldHash(world);
+    }
+    double step_seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    u32 first = 0, last = 0;
+    WorldRewindRange(world, &first, &last);
+    int kept = (int)(last - first + 1);
+    int wrong = 0;
+    start = SDL_GetPerformanceCounter();
+    for (int i=0; i < kept; i++)
+    {
+        u32 tick = first + (u32)(((u64)i * 7919) % kept); // every kept tick once, scrambled
+        if (!WorldRewind(world, tick) || (WorldHash(world) != hashes[tick - first_tick])) wrong++;
+    }
+    double rewind_seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    bool outside = WorldRewind(world, first - 1) || WorldRewind(world, last + 1);
+
+    // Scrub back a little and carry on: the history forks
+    bool forked = true;
+    if (kept > 10)
+    {
+        WorldRewind(world, last - 10);
+        WorldStep(world);
+        u32 fork_first = 0, fork_last = 0;
+        WorldRewindRange(world, &fork_first, &fork_last);
+        forked = (fork_last == last - 9);
+    }
+
+    printf("%d ticks (%.1f us each with capture); kept ticks %u-%u (%d) in %.0f KB of %.0f KB; "
+           "%.1f us per rewind; %d wrong%s%s\n",
+            ticks, 1e6 * step_seconds / ticks, first, last, kept,
+            world->rewind.used / 1024.0, budget / 1024.0, 1e6 * rewind_seconds / kept, wrong,
+            outside ? ", rewound outside the history" : "", forked ? "" : ", fork lost");
+    free(hashes);
+    WorldDestroy(world);
+    return (wrong || outside || !forked) ? 1 : 0;
+}
+
+/**
+ *  \brief Headless benchmark: indexed frames widened through the palette vs ARGB
+ *
+ *  momentum.exe --palette [frames]
+ *
+ *  Both end up in a buffer with padded rows, like a locked texture. Two worlds
+ *  step in lockstep, one drawn each way. Where only fixed colors show, the two
+ *  must match exactly. Ramps have fewer shades, so there the two only need to
+ *  cover the same pixels.
+ */
+internal int PaletteBenchmark(int argc, char **argv)
+{
+    int frames = (argc > 0) ? atoi(argv[0]) : 2000;
+    int pixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+    int pitch = (SCREEN_WIDTH + 16) * sizeof(u32); // textures often pad their rows
+    u32 *argb = (u32*) calloc(2 * pixels, sizeof(u32));
+    u8 *indexes = (u8*) calloc(2 * pixels, sizeof(u8));
+    u8 *textures = (u8*) calloc(4 * SCREEN_HEIGHT, pitch); // projectiles and player, each way
+    assert(argb && indexes && textures);
+
+    struct {const char *name; int mode; bool exact;} scenarios[] =
+    {
+        {"plain",   -1,            true},
+        {"life",    WORLD_LIFE,    true},
+        {"cloud",   WORLD_CLOUD,   true},
+        {"trails",  WORLD_TRAILS,  false},
+        {"heatmap", WORLD_HEATMAP, false},
+        {"heat",    WORLD_HEAT,    false},
+        {"tunnel",  WORLD_TUNNEL,  false},
+    };
+    int failures = 0;
+    for (int s=0; s < (int)SDL_arraysize(scenarios); s++)
+    {
+        world_t *worlds[2] = {WorldCreate(NULL), WorldCreate(NULL)};
+        for (int w=0; w < 2; w++)
+        {
+            if (scenarios[s].mode >= 0) WorldSetMode(worlds[w], (world_mode_t)scenarios[s].mode, true);
+        }
+        double seconds[2] = {0, 0};
+        int wrong = 0;
+        for (int frame=0; frame < frames; frame++)
+        {
+            for (int w=0; w < 2; w++)
+            {
+                if (frame % 3 == 0) WorldLaunch(worlds[w]);
+                if (frame % 50 == 0) WorldMovePlayer(worlds[w], 0, (frame % 400 < 200) ? 1 : -1);
+                WorldStep(worlds[w]);
+            }
+
+            Uint64 start = SDL_GetPerformanceCounter();
+            WorldRender(worlds[0], argb, argb + pixels);
+            for (int layer=0; layer < 2; layer++) // what SDL_UpdateTexture() does
+                for (int row=0; row < SCREEN_HEIGHT; row++)
+                {
+                    memcpy(textures + (layer*SCREEN_HEIGHT + row)*pitch,
+                            argb + layer*pixels + row*SCREEN_WIDTH, SCREEN_WIDTH * sizeof(u32));
+                }
+            seconds[0] += (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+            start = SDL_GetPerformanceCounter();
+            WorldRenderIndexed(worlds[1], indexes, indexes + pixels);
+            for (int layer=0; layer < 2; layer++)
+            {
+                PaletteExpand(WorldPalette(worlds[1]), indexes + layer*pixels, SCREEN_HEIGHT, SCREEN_WIDTH,
+                        textures + (2 + layer)*SCREEN_HEIGHT*pitch, pitch);
+            }
+            seconds[1] += (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+            for (int layer=0; layer < 2; layer++)
+                for (int row=0; row < SCREEN_HEIGHT; row++)
+                {
+                    const u32 *want = (const u32*)(textures + (layer*SCREEN_HEIGHT + row)*pitch);
+                    const u32 *got = (const u32*)(textures + ((2 + layer)*SCREEN_HEIGHT + row)*pitch);
+                    for (int col=0; col < SCREEN_WIDTH; col++)
+                    {
+                        bool same = scenarios[s].exact ? (want[col] == got[col])
+                                  : ((want[col] == EMPTY_SPACE) == (got[col] == EMPTY_SPACE));
+                        wrong += !same;
+                    }
+                }
+        }
+        printf("%-8s ARGB %.2f us, indexed %.2f us per frame; %d pixels wrong\n", scenarios[s].name,
+                1e6 * seconds[0] / frames, 1e6 * seconds[1] / frames, wrong);
+        if (wrong) failures++;
+        WorldDestroy(worlds[0]);
+        WorldDestroy(worlds[1]);
+    }
+    free(argb);
+    free(indexes);
+    free(textures);
+    return failures ? 1 : 0;
+}
+
+/**
+ *  \brief Headless check: interpolated frames join up from one tick to the next
+ *
+ *  momentum.exe --interpolate [ticks] [scale]
+ *
+ *  Drawn at alpha 0, a tick should look like the tick before drawn at alpha 1;
+ *  only launches, collisions and exits in between can tell them apart. For
+ *  scale, also counts how much a frame drawn once per tick changes. Also
+ *  times a frame.
+ */
+internal int InterpolateBenchmark(int argc, char **argv)
+{
+    int ticks = (argc > 0) ? atoi(argv[0]) : 2000;
+    int scale = (argc > 1) ? atoi(argv[1]) : 5;
+    size_t texels = (size_t)SCREEN_HEIGHT*scale * SCREEN_WIDTH*scale;
+    u8 *before = (u8*) calloc(texels, sizeof(u8));
+    u8 *after = (u8*) calloc(texels, sizeof(u8));
+    u8 *snapped = (u8*) calloc(texels, sizeof(u8));
+    assert(before && after && snapped);
+
+    world_t *world = WorldCreate(NULL);
+    u64 seams = 0, jumps = 0, drawn = 0; // texels that differ across a tick, and texels drawn
+    double seconds = 0;
+    for (int tick=0; tick < ticks; tick++)
+    {
+        if (tick % 3 == 0) WorldLaunch(world);
+        WorldRenderInterpolated(world, 1, scale, before);
+        WorldStep(world);
+        Uint64 start = SDL_GetPerformanceCounter();
+        WorldRenderInterpolated(world, 0, scale, after);
+        seconds += (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+        WorldRenderInterpolated(world, 1, scale, snapped);
+        for (size_t i=0; i < texels; i++)
+        {
+            seams += (before[i] != after[i]);
+            jumps += (before[i] != snapped[i]);
+            drawn += (after[i] != PALETTE_EMPTY);
+        }
+    }
+    printf("%d ticks at %dx: %.2f%% of drawn texels differ across a tick (%.2f%% a tick apart); "
+           "%.1f us per frame\n", ticks, scale, drawn ? 100.0 * seams / drawn : 0.0,
+            drawn ? 100.0 * jumps / drawn : 0.0, 1e6 * seconds / ticks);
+    WorldDestroy(world);
+    free(before);
+    free(after);
+    free(snapped);
+    return 0;
+}
+
+/**
+ *  \brief Headless benchmark: anti-aliased projectiles vs blocks
+ *
+ *  momentum.exe --splat [projectiles] [scale] [frames]
+ *
+ *  Also checks that a lone projectile anywhere still covers one square's
+ *  worth of texels once blended, up to the shades the palette has.
+ */
+internal int SplatBenchmark(int argc, char **argv)
+{
+    int count  = (argc > 0) ? atoi(argv[0]) : 5000;
+    int scale  = (argc > 1) ? atoi(argv[1]) : 5;
+    int frames = (argc > 2) ? atoi(argv[2]) : 500;
+    size_t texels = (size_t)SCREEN_HEIGHT*scale * SCREEN_WIDTH*scale;
+    u8 *indexes = (u8*) calloc(texels, sizeof(u8));
+    momentum_t *particles = (momentum_t*) calloc(count, sizeof(momentum_t));
+    assert(indexes && particles);
+
+    world_config_t config = {0, 1, scale};
+    world_t *world = WorldCreate(&config);
+    ScatterParticles(1, count, 2, particles);
+    int placed = WorldSetParticles(world, particles, count);
+    double seconds[2] = {0, 0};
+    for (int smooth=0; smooth < 2; smooth++)
+    {
+        WorldSetMode(world, WORLD_SMOOTH, smooth);
+        for (int frame=0; frame < frames; frame++)
+        {
+            Uint64 start = SDL_GetPerformanceCounter();
+            WorldRenderInterpolated(world, (frame % 4) / 4.0f, scale, indexes);
+            seconds[smooth] += (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+        }
+    }
+
+    // One projectile at a time, away from the edges
+    double worst = 0;
+    const u32 *palette = WorldPalette(world);
+    for (int trial=0; trial < 100; trial++)
+    {
+        momentum_t particle = {
+            10 + RngUnit(RngU32(2, 0, trial, 0)) * (SCREEN_HEIGHT-20),
+            10 + RngUnit(RngU32(2, 0, trial, 1)) * (SCREEN_WIDTH-20),
+            RngUnit(RngU32(2, 0, trial, 2)) - 0.5f, 0};
+        WorldSetParticles(world, &particle, 1);
+        WorldRenderInterpolated(world, RngUnit(RngU32(2, 0, trial, 3)), scale, indexes);
+        double alpha = 0;
+        for (size_t i=0; i < texels; i++) alpha += (palette[indexes[i]] >> 24) / 255.0;
+        worst = SDL_max(worst, SDL_fabs(alpha / (scale*scale) - 1));
+    }
+    printf("%d projectiles at %dx: blocks %.1f us, anti-aliased %.1f us per frame; "
+           "lone projectile coverage off by at most %.2f%%\n", placed, scale,
+            1e6 * seconds[0] / frames, 1e6 * seconds[1] / frames, 100 * worst);
+    WorldDestroy(world);
+    free(indexes);
+    free(particles);
+    return 0;
+}
+
+// ---------------------
+// | Batches of Worlds |
+// ---------------------
+
+// Thousands of small worlds stepped together, for sweeps. Worlds go in groups
+// of BATCH_LANES, and a group's buffers interleave its worlds: each field of
+// the momentum has its own array, with cell i of lane w at [i*BATCH_LANES + w],
+// and occupancy is one byte per cell with a bit per lane. A u64 load then
+// tests eight cells in every world of the group, so empty space is nearly
+// free, and a cell's x and dx across worlds are each one vector load, so its
+// physics runs as one vector op. Threads take whole groups.
+//
+// Each world steps exactly like DrawProjectile(), bit for bit, but with its
+// own gravity and blast. Only projectiles are simulated (no player or modes).
+#define BATCH_LANES 8
+
+typedef double f64x8 __attribute__((vector_size(64)));
+
+typedef struct
+{
+    u8 *occupied;          // bit w set where lane w has a projectile, per cell
+    float *x, *y, *dx, *dy; // momentum_t by field, cells x lanes
+} batch_frame_t;
+
+struct batch_t
+{
+    int worlds, groups;
+    thread_pool_t pool;
+    batch_frame_t frames[2]; // current and next, groups x cells x lanes
+    int current;
+    double *gravity;         // per world
+    float *blast;            // per world
+};
+
+#define BATCH_CELLS (SCREEN_WIDTH * SCREEN_HEIGHT)
+
+batch_t *BatchCreate(int worlds, int threads)
+{
+    batch_t *batch = (batch_t*) calloc(1, sizeof(batch_t));
+    assert(batch);
+    batch->worlds = worlds;
+    batch->groups = (worlds + BATCH_LANES-1) / BATCH_LANES;
+    size_t slots = (size_t)batch->groups * BATCH_CELLS * BATCH_LANES;
+    for (int f=0; f < 2; f++)
+    {
+        batch_frame_t *frame = &batch->frames[f];
+        frame->occupied = (u8*) calloc(slots / BATCH_LANES, 1);
+        frame->x  = (float*) calloc(slots, sizeof(float));
+        frame->y  = (float*) calloc(slots, sizeof(float));
+        frame->dx = (float*) calloc(slots, sizeof(float));
+        frame->dy = (float*) calloc(slots, sizeof(float));
+        assert(frame->occupied && frame->x && frame->y && frame->dx && frame->dy);
+    }
+    batch->gravity = (double*) calloc(batch->groups * BATCH_LANES, sizeof(double));
+    batch->blast = (float*) calloc(batch->groups * BATCH_LANES, sizeof(float));
+    assert(batch->gravity && batch->blast);
+    for (int w=0; w < batch->groups * BATCH_LANES; w++)
+    {
+        batch->gravity[w] = GRAVITY;
+        batch->blast[w] = (float)BLAST;
+    }
+    ThreadPoolInit(&batch->pool, threads);
+    return batch;
+}
+
+void BatchDestroy(batch_t *batch)
+{
+    for (int f=0; f < 2; f++)
+    {
+        batch_frame_t *frame = &batch->frames[f];
+        free(frame->occupied);
+        free(frame->x); free(frame->y);
+        free(frame->dx); free(frame->dy);
+    }
+    free(batch->gravity);
+    free(batch->blast);
+    ThreadPoolFree(&batch->pool);
+    free(batch);
+}
+
+/**
+ *  \brief Empty every world and put the physics back to GRAVITY and BLAST
+ */
+void BatchReset(batch_t *batch)
+{
+    size_t slots = (size_t)batch->groups * BATCH_CELLS * BATCH_LANES;
+    for (int f=0; f < 2; f++) memset(batch->frames[f].occupied, 0, slots / BATCH_LANES);
+    for (int w=0; w < batch->groups * BATCH_LANES; w++)
+    {
+        batch->gravity[w] = GRAVITY;
+        batch->blast[w] = (float)BLAST;
+    }
+}
+
+void BatchSetPhysics(batch_t *batch, int world, double gravity, float blast)
+{
+    assert((world >= 0) && (world < batch->worlds));
+    batch->gravity[world] = gravity;
+    batch->blast[world] = blast;
+}
+
+/**
+ *  \brief Slot of a world's cell: group, then cell, then lane
+ */
+inline internal size_t BatchSlot(int world, int row, int col)
+{
+    return ((size_t)(world / BATCH_LANES) * BATCH_CELLS + row*SCREEN_WIDTH + col) * BATCH_LANES
+        + world % BATCH_LANES;
+}
+
+inline internal momentum_t BatchMomentum(const batch_frame_t *frame, size_t slot)
+{
+    momentum_t momentum = {frame->x[slot], frame->y[slot], frame->dx[slot], frame->dy[slot]};
+    return momentum;
+}
+
+inline internal void BatchSetMomentum(batch_frame_t *frame, size_t slot, momentum_t momentum)
+{
+    frame->x[slot] = momentum.x;
+    frame->y[slot] = momentum.y;
+    frame->dx[slot] = momentum.dx;
+    frame->dy[slot] = momentum.dy;
+}
+
+int BatchLaunch(batch_t *batch, int world)
+{
+    assert((world >= 0) && (world < batch->worlds));
+    // Same spot and rules as InitProjectile()
+    int x = SCREEN_HEIGHT-1;
+    int y = SCREEN_WIDTH/2;
+    batch_frame_t *frame = &batch->frames[batch->current];
+    size_t slot = BatchSlot(world, x, y);
+    u8 bit = 1 << (world % BATCH_LANES);
+    if (frame->occupied[slot / BATCH_LANES] & bit) return 0;
+    momentum_t momentum = {(float)x, (float)y, batch->blast[world], 0};
+    frame->occupied[slot / BATCH_LANES] |= bit;
+    BatchSetMomentum(frame, slot, momentum);
+    return 1;
+}
+
+typedef struct
+{
+    batch_t *batch;
+    int ticks;
+} batch_job_t;
+
+internal void BatchGroupJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    batch_job_t *job = (batch_job_t*) data;
+    batch_t *batch = job->batch;
+    size_t group_slots = (size_t)BATCH_CELLS * BATCH_LANES;
+    for (int g=begin; g < end; g++)
+    {
+        f64x8 gravity;
+        memcpy(&gravity, &batch->gravity[g*BATCH_LANES], sizeof(gravity));
+        int current = batch->current;
+        for (int tick=0; tick < job->ticks; tick++)
+        {
+            const batch_frame_t *frame = &batch->frames[current];
+            batch_frame_t *frame_next = &batch->frames[current ^ 1];
+            const u8 *occupied = frame->occupied + (size_t)g*BATCH_CELLS;
+            const float *xs = frame->x + g*group_slots, *dxs = frame->dx + g*group_slots;
+            const float *ys = frame->y + g*group_slots, *dys = frame->dy + g*group_slots;
+            u8 *occupied_next = frame_next->occupied + (size_t)g*BATCH_CELLS;
+            float *xs_next = frame_next->x + g*group_slots, *dxs_next = frame_next->dx + g*group_slots;
+            float *ys_next = frame_next->y + g*group_slots, *dys_next = frame_next->dy + g*group_slots;
+            memset(occupied_next, 0, BATCH_CELLS); // erase old artwork
+
+            // Row-major, like DrawProjectile(), so later writes win the same way
+            for (int cells=0; cells < BATCH_CELLS; cells += 8)
+            {
+                u64 eight;
+                memcpy(&eight, &occupied[cells], sizeof(eight));
+                if (!eight) continue; // eight cells empty in every world of the group
+                for (int cell=cells; cell < cells+8; cell++)
+                {
+                    u8 lanes = occupied[cell];
+                    if (!lanes) continue;
+                    int col = cell % SCREEN_WIDTH;
+                    size_t base = (size_t)cell * BATCH_LANES;
+
+                    // Same arithmetic as DrawProjectile(): dx += GRAVITY in double
+                    f32x8 x, dx;
+                    memcpy(&x, xs + base, sizeof(x));
+                    memcpy(&dx, dxs + base, sizeof(dx));
+                    dx = __builtin_convertvector(__builtin_convertvector(dx, f64x8) + gravity, f32x8);
+                    x += dx;
+                    i32x8 row_predict = __builtin_convertvector(x, i32x8);
+
+                    for (int w=0; w < BATCH_LANES; w++)
+                    {
+                        u8 bit = 1 << w;
+                        if (!(lanes & bit)) continue;
+                        if ((u32)row_predict[w] >= SCREEN_HEIGHT)
+                        {
+                            // Erase the projectile
+                            occupied_next[cell] &= ~bit;
+                            xs_next[base + w] = ys_next[base + w] = 0;
+                            dxs_next[base + w] = dys_next[base + w] = 0;
+                        }
+                        else
+                        {
+                            int cell_next = row_predict[w]*SCREEN_WIDTH + col;
+                            size_t slot = (size_t)cell_next * BATCH_LANES + w;
+                            occupied_next[cell_next] |= bit;
+                            xs_next[slot] = x[w];
+                            dxs_next[slot] = dx[w];
+                            ys_next[slot] = ys[base + w];
+                            dys_next[slot] = dys[base + w];
+                        }
+                    }
+                }
+            }
+            current ^= 1;
+        }
+    }
+}
+
+void BatchStep(batch_t *batch, int ticks)
+{
+    batch_job_t job = {batch, ticks};
+    ParallelFor(&batch->pool, batch->groups, 1, BatchGroupJob, &job);
+    batch->current ^= ticks & 1;
+}
+
+int BatchGetParticles(const batch_t *batch, int world, momentum_t *particles, int max)
+{
+    assert((world >= 0) && (world < batch->worlds));
+    const batch_frame_t *frame = &batch->frames[batch->current];
+    size_t group = (size_t)(world / BATCH_LANES) * BATCH_CELLS;
+    const u8 *occupied = frame->occupied + group;
+    int lane = world % BATCH_LANES;
+    u64 lane_bits = 0x0101010101010101ull << lane; // this world's bit in eight cells
+    int count = 0;
+    for (int cells=0; cells < BATCH_CELLS; cells += 8)
+    {
+        u64 eight;
+        memcpy(&eight, &occupied[cells], sizeof(eight));
+        if (!(eight & lane_bits)) continue;
+        for (int cell=cells; cell < cells+8; cell++)
+        {
+            if (!(occupied[cell] & (1 << lane))) continue;
+            if (count < max) particles[count] = BatchMomentum(frame, (group + cell) * BATCH_LANES + lane);
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ *  \brief Headless benchmark: a batch against the same worlds one at a time
+ *
+ *  momentum.exe --batch [worlds] [ticks]
+ *
+ *  Worlds launch on staggered schedules. The one-at-a-time run uses the
+ *  reference DrawProjectile() loop for a sample of worlds and also checks
+ *  that the batch ended up with bit-identical projectiles.
+ */
+internal int BatchBenchmark(int argc, char **argv)
+{
+    int worlds = (argc > 0) ? atoi(argv[0]) : 1024;
+    int ticks  = (argc > 1) ? atoi(argv[1]) : 500;
+    int sample = SDL_min(worlds, 16);
+
+    batch_t *batch = BatchCreate(worlds, 0);
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int tick=0; tick < ticks; tick++)
+    {
+        for (int w=0; w < worlds; w++)
+        {
+            if (tick % (5 + w % 11) == 0) BatchLaunch(batch, w);
+        }
+        BatchStep(batch, 1);
+    }
+    double batch_seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    // Reference: the same worlds, one at a time, the way the app steps one
+    size_t pixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+    u32 *frame = (u32*) calloc(pixels, sizeof(u32));
+    u32 *frame_next = (u32*) calloc(pixels, sizeof(u32));
+    momentum_t *momentum = (momentum_t*) calloc(pixels, sizeof(momentum_t));
+    momentum_t *momentum_next = (momentum_t*) calloc(pixels, sizeof(momentum_t));
+    momentum_t *expected = (momentum_t*) calloc(pixels, sizeof(momentum_t));
+    momentum_t *got = (momentum_t*) calloc(pixels, sizeof(momentum_t));
+    assert(frame && frame_next && momentum && momentum_next && expected && got);
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    int mismatched = 0;
+    start = SDL_GetPerformanceCounter();
+    for (int w=0; w < sample; w++)
+    {
+        FillRect(entire_screen, EMPTY_SPACE, frame);
+        for (int tick=0; tick < ticks; tick++)
+        {
+            if (tick % (5 + w % 11) == 0) InitProjectile(frame, momentum);
+            FillRect(entire_screen, EMPTY_SPACE, frame_next);
+            DrawProjectile(frame, frame_next, momentum, momentum_next);
+            u32 *tmp_pix = frame; frame = frame_next; frame_next = tmp_pix;
+            momentum_t *tmp_mom = momentum; momentum = momentum_next; momentum_next = tmp_mom;
+        }
+        int count = 0;
+        for (size_t i=0; i < pixels; i++)
+        {
+            if (frame[i] == PROJECTILE_COLOR) expected[count++] = momentum[i];
+        }
+        int batch_count = BatchGetParticles(batch, w, got, (int)pixels);
+        if ((batch_count != count) || (memcmp(got, expected, count*sizeof(momentum_t)) != 0)) mismatched++;
+    }
+    double reference_seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    double batch_rate = (double)worlds*ticks / batch_seconds;
+    double reference_rate = (double)sample*ticks / reference_seconds;
+    printf("%d worlds x %d ticks on %d threads: %.0f world-ticks/s batched, %.0f one at a time (%.1fx); "
+           "%d of %d sampled worlds differ\n",
+            worlds, ticks, batch->pool.num_threads, batch_rate, reference_rate,
+            batch_rate / reference_rate, mismatched, sample);
+    free(frame); free(frame_next);
+    free(momentum); free(momentum_next);
+    free(expected); free(got);
+    BatchDestroy(batch);
+    return mismatched ? 1 : 0;
+}
+
+// --------------------
+// | Parameter Sweeps |
+// --------------------
+
+// Every combination of a GRAVITY range and a BLAST range, run headless as
+// worlds of one batch. Sweeps larger than the batch run in rounds that reset
+// and reuse it, so setup is paid once.
+#define SWEEP_BATCH_WORLDS 1024
+#define SWEEP_LAUNCH_EVERY 16 // ticks between launches, like holding Space
+#define SWEEP_SAMPLE_EVERY 4  // ticks between metric samples
+
+typedef struct
+{
+    int launched;   // projectiles placed
+    int alive;      // in flight at the end
+    int peak_alive; // most in flight at any sample
+    float apex;     // highest row reached (smallest x), SCREEN_HEIGHT if none
+} sweep_metrics_t;
+
+internal float SweepValue(float lo, float hi, int steps, int i)
+{
+    return (steps > 1) ? lo + (hi - lo) * i / (steps - 1) : lo;
+}
+
+/**
+ *  \brief Headless parameter sweep over GRAVITY x BLAST
+ *
+ *  momentum.exe --sweep gravity_lo gravity_hi gravity_steps
+ *                       blast_lo blast_hi blast_steps [ticks] [out]
+ *
+ *  Each run launches from the usual spot every SWEEP_LAUNCH_EVERY ticks.
+ *  Writes one tab-separated table to `out` (default momentum-sweep.tsv),
+ *  one row per run, with a header naming the columns.
+ */
+internal int SweepRun(int argc, char **argv)
+{
+    if (argc < 6)
+    {
+        printf("Usage: --sweep gravity_lo gravity_hi gravity_steps "
+               "blast_lo blast_hi blast_steps [ticks] [out]\n");
+        return 1;
+    }
+    float gravity_lo = (float)SDL_atof(argv[0]);
+    float gravity_hi = (float)SDL_atof(argv[1]);
+    int gravity_steps = SDL_max(atoi(argv[2]), 1);
+    float blast_lo = (float)SDL_atof(argv[3]);
+    float blast_hi = (float)SDL_atof(argv[4]);
+    int blast_steps = SDL_max(atoi(argv[5]), 1);
+    int ticks = (argc > 6) ? atoi(argv[6]) : 1000;
+    const char *path = (argc > 7) ? argv[7] : "momentum-sweep.tsv";
+
+    SDL_RWops *out = SDL_RWFromFile(path, "wb");
+    if (!out)
+    {
+        printf("Cannot open %s\n", path);
+        return 1;
+    }
+    const char *header = "run\tgravity\tblast\tlaunched\talive\tpeak_alive\tapex\n";
+    SDL_RWwrite(out, header, 1, strlen(header));
+
+    int runs = gravity_steps * blast_steps;
+    int capacity = SDL_min(runs, SWEEP_BATCH_WORLDS);
+    batch_t *batch = BatchCreate(capacity, 0);
+    sweep_metrics_t *metrics = (sweep_metrics_t*) calloc(capacity, sizeof(sweep_metrics_t));
+    momentum_t *particles = (momentum_t*) calloc(BATCH_CELLS, sizeof(momentum_t));
+    assert(metrics && particles);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int first=0; first < runs; first += capacity)
+    {
+        int count = SDL_min(capacity, runs - first);
+        BatchReset(batch);
+        memset(metrics, 0, capacity * sizeof(sweep_metrics_t));
+        for (int w=0; w < count; w++)
+        {
+            int run = first + w;
+            BatchSetPhysics(batch, w,
+                    SweepValue(gravity_lo, gravity_hi, gravity_steps, run / blast_steps),
+                    SweepValue(blast_lo, blast_hi, blast_steps, run % blast_steps));
+            metrics[w].apex = SCREEN_HEIGHT;
+        }
+        for (int tick=0; tick < ticks; tick++)
+        {
+            if (tick % SWEEP_LAUNCH_EVERY == 0)
+            {
+                for (int w=0; w < count; w++) metrics[w].launched += BatchLaunch(batch, w);
+            }
+            BatchStep(batch, 1);
+            if ((tick % SWEEP_SAMPLE_EVERY != 0) && (tick != ticks-1)) continue;
+            for (int w=0; w < count; w++)
+            {
+                int alive = BatchGetParticles(batch, w, particles, BATCH_CELLS);
+                metrics[w].alive = alive;
+                metrics[w].peak_alive = SDL_max(metrics[w].peak_alive, alive);
+                for (int i=0; i < alive; i++) metrics[w].apex = SDL_min(metrics[w].apex, particles[i].x);
+            }
+        }
+        for (int w=0; w < count; w++)
+        {
+            char line[160];
+            int length = SDL_snprintf(line, sizeof(line), "%d\t%g\t%g\t%d\t%d\t%d\t%g\n",
+                    first + w, batch->gravity[w], batch->blast[w],
+                    metrics[w].launched, metrics[w].alive, metrics[w].peak_alive, metrics[w].apex);
+            SDL_RWwrite(out, line, 1, length);
+        }
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    printf("%d runs x %d ticks on %d threads in %.2f s, written to %s\n",
+            runs, ticks, batch->pool.num_threads, seconds, path);
+
+    SDL_RWclose(out);
+    free(metrics);
+    free(particles);
+    BatchDestroy(batch);
+    return 0;
+}
+
+// ------------------------
+// | Trajectory Recording |
+// ------------------------
+
+// Every projectile, every tick, to a file for offline analysis. A frame is
+// stored against the one before it: particles are kept sorted by column, then
+// row, and each is linked to the particle it was last tick (same column, in
+// order), so its fields are stored as the difference of their float bits from
+// a prediction: the step DrawProjectile() takes, dx gaining GRAVITY and x
+// gaining the new dx, with y and dy unchanged. Plain flight predicts exactly.
+// Differences are zigzagged so small negative steps stay small, and bit-packed
+// in runs of RECORD_RUN at the narrowest width the run needs. A projectile in
+// free flight costs a few bits a tick.
+//
+// Frames go in blocks of RECORD_BLOCK_TICKS. The first frame of a block links
+// to nothing, so a block decodes on its own; an index of blocks at the end of
+// the file makes any tick at most one block read and RECORD_BLOCK_TICKS frame
+// decodes away. Finished blocks are written by a background thread so
+// recording never waits on the disk.
+//
+// File: record_header_t, blocks, record_index_t[blocks], record_trailer_t.
+// Frame: u32 tick, u32 count, then the link stream and the y, dy, dx and x
+// streams in turn. A stream is runs of a u8 width followed by up to
+// RECORD_RUN values packed LSB first and padded to a byte. A link is 0 for
+// "the particle after the last one linked", 1 for a new particle, or 2 plus
+// the zigzagged jump in the previous frame.
+#define RECORD_MAGIC 0x524D4F4D // "MOMR"
+#define RECORD_INDEX_MAGIC 0x494D4F4D // "MOMI"
+#define RECORD_VERSION 1
+#define RECORD_BLOCK_TICKS 64
+#define RECORD_QUEUE 4 // blocks in flight to the writer thread
+#define RECORD_RUN 32 // values sharing one width
+#define RECORD_STREAMS 5 // links, y, dy, dx, x
+
+typedef struct
+{
+    u32 magic;
+    u32 version;
+    u32 block_ticks;
+    u32 reserved;
+} record_header_t;
+
+typedef struct
+{
+    u64 offset;     // file offset of the block
+    u32 bytes;      // block size
+    u32 first_tick; // tick of its first frame
+    u32 frames;
+    u32 reserved;
+} record_index_t;
+
+typedef struct
+{
+    u64 index_offset;
+    u32 blocks;
+    u32 magic;
+} record_trailer_t;
+
+typedef struct
+{
+    u8 *bytes;
+    size_t size, capacity;
+    u32 first_tick;
+    u32 frames;
+} record_block_t;
+
+// The last frame and scratch for the next, shared by recording and playback
+typedef struct
+{
+    momentum_t *previous, *current; // sorted by column, then row
+    int *link;                      // index in previous of each current, -1 if new
+    u32 *values;                    // one stream of packed values
+    int previous_count, capacity;
+} record_frames_t;
+
+struct recorder_t
+{
+    record_block_t blocks[RECORD_QUEUE]; // ring: the writer drains, we fill
+    int fill;                            // block being filled
+    record_frames_t frames;
+    u32 last_tick;                       // ticks added must increase
+    bool any_added;
+
+    // ---Background writer---
+    SDL_RWops *file;
+    u64 file_size;
+    record_index_t *index; // owned by the writer thread until it exits
+    int index_count, index_capacity;
+    SDL_Thread *io_thread;
+    SDL_mutex *io_lock;
+    SDL_cond *io_wake;
+    SDL_cond *io_idle;
+    int io_head, io_pending;
+    bool io_quit;
+};
+
+struct playback_t
+{
+    SDL_RWops *file;
+    record_index_t *index;
+    int blocks;
+    u8 *block;   // bytes of the cached block
+    int cached;  // index of the cached block, -1 if none
+    record_frames_t frames;
+};
+
+internal void RecordFramesReserve(record_frames_t *frames, int count)
+{
+    if (count <= frames->capacity) return;
+    frames->capacity = SDL_max(count, 2*frames->capacity);
+    frames->previous = (momentum_t*) realloc(frames->previous, frames->capacity * sizeof(momentum_t));
+    frames->current = (momentum_t*) realloc(frames->current, frames->capacity * sizeof(momentum_t));
+    frames->link = (int*) realloc(frames->link, frames->capacity * sizeof(int));
+    frames->values = (u32*) realloc(frames->values, frames->capacity * sizeof(u32));
+    assert(frames->previous && frames->current && frames->link && frames->values);
+}
+
+internal void RecordFramesFree(record_frames_t *frames)
+{
+    free(frames->previous);
+    free(frames->current);
+    free(frames->link);
+    free(frames->values);
+}
+
+/**
+ *  \brief Current frame becomes the one the next frame links to
+ */
+internal void RecordFramesAdvance(record_frames_t *frames, int count)
+{
+    momentum_t *tmp = frames->previous;
+    frames->previous = frames->current;
+    frames->current = tmp;
+    frames->previous_count = count;
+}
+
+internal int RecordOrder(const void *a, const void *b)
+{
+    const momentum_t *p = (const momentum_t*) a;
+    const momentum_t *q = (const momentum_t*) b;
+    if (p->y != q->y) return (p->y < q->y) ? -1 : 1;
+    if (p->x != q->x) return (p->x < q->x) ? -1 : 1;
+    return 0;
+}
+
+inline internal u32 RecordBits(float value)
+{
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline internal float RecordFloat(u32 bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline internal u32 Zigzag(u32 delta)
+{
+    return (delta << 1) ^ (u32)((int32_t)delta >> 31);
+}
+
+inline internal u32 Unzigzag(u32 zigzag)
+{
+    return (zigzag >> 1) ^ (0u - (zigzag & 1));
+}
+
+/**
+ *  \brief Prediction for one field of current particle i, from what it linked to
+ *
+ *  Streams decode in order, so x may use this tick's dx.
+ */
+inline internal u32 RecordPredict(const record_frames_t *frames, int stream, int i)
+{
+    int link = frames->link[i];
+    if (link < 0) return 0;
+    const momentum_t *was = &frames->previous[link];
+    switch (stream)
+    {
+        case 1: return RecordBits(was->y);
+        case 2: return RecordBits(was->dy);
+        case 3: return RecordBits((float)(was->dx + GRAVITY));
+        default: return RecordBits(was->x + frames->current[i].dx);
+    }
+}
+
+inline internal float *RecordField(momentum_t *particle, int stream)
+{
+    switch (stream)
+    {
+        case 1: return &particle->y;
+        case 2: return &particle->dy;
+        case 3: return &particle->dx;
+        default: return &particle->x;
+    }
+}
+
+internal void RecordReserve(record_block_t *block, size_t bytes)
+{
+    if (block->size + bytes <= block->capacity) return;
+    block->capacity = SDL_max(2*block->capacity, block->size + bytes);
+    block->bytes = (u8*) realloc(block->bytes, block->capacity);
+    assert(block->bytes);
+}
+
+/**
+ *  \brief Append a stream: runs of a width byte and the run's values packed
+ */
+internal void RecordPack(record_block_t *block, const u32 *values, int count)
+{
+    RecordReserve(block, (size_t)count*4 + (count/RECORD_RUN + 1)*9);
+    u8 *out = block->bytes + block->size;
+    for (int run=0; run < count; run += RECORD_RUN)
+    {
+        int n = SDL_min(RECORD_RUN, count - run);
+        u32 any = 0;
+        for (int i=run; i < run+n; i++) any |= values[i];
+        int width = any ? 32 - __builtin_clz(any) : 0;
+        *out++ = (u8)width;
+        u64 bits = 0;
+        int used = 0;
+        for (int i=run; i < run+n; i++)
+        {
+            bits |= (u64)values[i] << used;
+            used += width;
+            if (used >= 32)
+            {
+                u32 word = (u32)bits;
+                memcpy(out, &word, 4);
+                out += 4;
+                bits >>= 32;
+                used -= 32;
+            }
+        }
+        for (; used > 0; used -= 8)
+        {
+            *out++ = (u8)bits;
+            bits >>= 8;
+        }
+    }
+    block->size = out - block->bytes;
+}
+
+/**
+ *  \brief Read back a stream RecordPack() wrote; returns the bytes consumed
+ */
+internal size_t RecordUnpack(const u8 *in, u32 *values, int count)
+{
+    const u8 *start = in;
+    for (int run=0; run < count; run += RECORD_RUN)
+    {
+        int n = SDL_min(RECORD_RUN, count - run);
+        int width = *in++;
+        size_t bytes = ((size_t)n*width + 7)/8;
+        u64 mask = (width == 32) ? 0xFFFFFFFFull : ((1ull << width) - 1);
+        u64 bits = 0;
+        int have = 0;
+        size_t at = 0;
+        for (int i=run; i < run+n; i++)
+        {
+            while ((have < width) && (at < bytes))
+            {
+                bits |= (u64)in[at++] << have;
+                have += 8;
+            }
+            values[i] = (u32)(bits & mask);
+            bits >>= width;
+            have -= width;
+        }
+        in += bytes;
+    }
+    return in - start;
+}
+
+internal int RecordWriterThread(void *data)
+{
+    recorder_t *recorder = (recorder_t*) data;
+    for (;;)
+    {
+        SDL_LockMutex(recorder->io_lock);
+        while ((recorder->io_pending == 0) && !recorder->io_quit)
+        {
+            SDL_CondWait(recorder->io_wake, recorder->io_lock);
+        }
+        if (recorder->io_pending == 0) // quit and nothing left to do
+        {
+            SDL_UnlockMutex(recorder->io_lock);
+            return 0;
+        }
+        record_block_t *block = &recorder->blocks[recorder->io_head];
+        SDL_UnlockMutex(recorder->io_lock);
+
+        if (recorder->index_count == recorder->index_capacity)
+        {
+            recorder->index_capacity = SDL_max(64, 2*recorder->index_capacity);
+            recorder->index = (record_index_t*) realloc(recorder->index,
+                    recorder->index_capacity * sizeof(record_index_t));
+            assert(recorder->index);
+        }
+        record_index_t entry = {recorder->file_size, (u32)block->size, block->first_tick, block->frames, 0};
+        recorder->index[recorder->index_count++] = entry;
+        SDL_RWwrite(recorder->file, block->bytes, 1, block->size);
+        recorder->file_size += block->size;
+        block->size = 0;
+        block->frames = 0;
+
+        SDL_LockMutex(recorder->io_lock);
+        recorder->io_head = (recorder->io_head + 1) % RECORD_QUEUE;
+        recorder->io_pending--;
+        SDL_CondSignal(recorder->io_idle);
+        SDL_UnlockMutex(recorder->io_lock);
+    }
+}
+
+recorder_t *RecorderOpen(const char *path)
+{
+    SDL_RWops *file = SDL_RWFromFile(path, "wb");
+    if (!file) return NULL;
+    recorder_t *recorder = (recorder_t*) calloc(1, sizeof(recorder_t));
+    assert(recorder);
+    recorder->file = file;
+    record_header_t header = {RECORD_MAGIC, RECORD_VERSION, RECORD_BLOCK_TICKS, 0};
+    SDL_RWwrite(file, &header, sizeof(header), 1);
+    recorder->file_size = sizeof(header);
+    recorder->io_lock = SDL_CreateMutex();
+    recorder->io_wake = SDL_CreateCond();
+    recorder->io_idle = SDL_CreateCond();
+    recorder->io_thread = SDL_CreateThread(RecordWriterThread, "record-io", recorder);
+    assert(recorder->io_thread);
+    return recorder;
+}
+
+/**
+ *  \brief Hand the filled block to the writer, waiting only if the queue is full
+ */
+internal void RecordSubmit(recorder_t *recorder)
+{
+    SDL_LockMutex(recorder->io_lock);
+    recorder->io_pending++;
+    SDL_CondSignal(recorder->io_wake);
+    while (recorder->io_pending == RECORD_QUEUE)
+    {
+        SDL_CondWait(recorder->io_idle, recorder->io_lock);
+    }
+    SDL_UnlockMutex(recorder->io_lock);
+    recorder->fill = (recorder->fill + 1) % RECORD_QUEUE;
+}
+
+int RecorderAdd(recorder_t *recorder, uint32_t tick, const momentum_t *particles, int count)
+{
+    // Playback searches blocks by first tick, so a tick that goes back (after
+    // a rewind, say) would make the one recorded before it unreachable
+    if (recorder->any_added && (tick <= recorder->last_tick)) return 0;
+    recorder->any_added = true;
+    recorder->last_tick = tick;
+
+    record_block_t *block = &recorder->blocks[recorder->fill];
+    record_frames_t *frames = &recorder->frames;
+    if (block->frames == 0)
+    {
+        block->first_tick = tick;
+        frames->previous_count = 0; // starts a block: link to nothing
+    }
+    RecordFramesReserve(frames, count);
+    memcpy(frames->current, particles, count * sizeof(momentum_t));
+    qsort(frames->current, count, sizeof(momentum_t), RecordOrder);
+
+    u32 frame_header[2] = {tick, (u32)count};
+    RecordReserve(block, sizeof(frame_header));
+    memcpy(block->bytes + block->size, frame_header, sizeof(frame_header));
+    block->size += sizeof(frame_header);
+
+    // Link each particle to the same column's particle in order last tick
+    int j = 0, expected = 0;
+    for (int i=0; i < count; i++)
+    {
+        float y = frames->current[i].y;
+        while ((j < frames->previous_count) && (frames->previous[j].y < y)) j++;
+        if ((j < frames->previous_count) && (frames->previous[j].y == y))
+        {
+            frames->link[i] = j;
+            frames->values[i] = (j == expected) ? 0 : 2 + Zigzag((u32)(j - expected));
+            expected = ++j;
+        }
+        else
+        {
+            frames->link[i] = -1;
+            frames->values[i] = 1;
+        }
+    }
+    RecordPack(block, frames->values, count);
+
+    for (int stream=1; stream < RECORD_STREAMS; stream++)
+    {
+        for (int i=0; i < count; i++)
+        {
+            u32 bits = RecordBits(*RecordField(&frames->current[i], stream));
+            frames->values[i] = Zigzag(bits - RecordPredict(frames, stream, i));
+        }
+        RecordPack(block, frames->values, count);
+    }
+    RecordFramesAdvance(frames, count);
+    if (++block->frames == RECORD_BLOCK_TICKS) RecordSubmit(recorder);
+    return 1;
+}
+
+void RecorderClose(recorder_t *recorder)
+{
+    if (recorder->blocks[recorder->fill].frames) RecordSubmit(recorder);
+    SDL_LockMutex(recorder->io_lock);
+    recorder->io_quit = true;
+    SDL_CondSignal(recorder->io_wake);
+    SDL_UnlockMutex(recorder->io_lock);
+    SDL_WaitThread(recorder->io_thread, NULL);
+
+    record_trailer_t trailer = {recorder->file_size, (u32)recorder->index_count, RECORD_INDEX_MAGIC};
+    SDL_RWwrite(recorder->file, recorder->index, sizeof(record_index_t), recorder->index_count);
+    SDL_RWwrite(recorder->file, &trailer, sizeof(trailer), 1);
+    SDL_RWclose(recorder->file);
+    SDL_DestroyCond(recorder->io_idle);
+    SDL_DestroyCond(recorder->io_wake);
+    SDL_DestroyMutex(recorder->io_lock);
+    for (int b=0; b < RECORD_QUEUE; b++) free(recorder->blocks[b].bytes);
+    free(recorder->index);
+    RecordFramesFree(&recorder->frames);
+    free(recorder);
+}
+
+playback_t *PlaybackOpen(const char *path)
+{
+    SDL_RWops *file = SDL_RWFromFile(path, "rb");
+    if (!file) return NULL;
+    record_header_t header;
+    record_trailer_t trailer;
+    Sint64 size = SDL_RWsize(file);
+    if ((size < (Sint64)(sizeof(header) + sizeof(trailer)))
+            || (SDL_RWread(file, &header, sizeof(header), 1) != 1)
+            || (header.magic != RECORD_MAGIC) || (header.version != RECORD_VERSION)
+            || (SDL_RWseek(file, size - sizeof(trailer), RW_SEEK_SET) < 0)
+            || (SDL_RWread(file, &trailer, sizeof(trailer), 1) != 1)
+            || (trailer.magic != RECORD_INDEX_MAGIC)) // not a recording, or not closed
+    {
+        SDL_RWclose(file);
+        return NULL;
+    }
+    playback_t *playback = (playback_t*) calloc(1, sizeof(playback_t));
+    assert(playback);
+    playback->file = file;
+    playback->blocks = trailer.blocks;
+    playback->index = (record_index_t*) calloc(SDL_max(trailer.blocks, 1), sizeof(record_index_t));
+    assert(playback->index);
+    SDL_RWseek(file, trailer.index_offset, RW_SEEK_SET);
+    SDL_RWread(file, playback->index, sizeof(record_index_t), trailer.blocks);
+    playback->cached = -1;
+    return playback;
+}
+
+void PlaybackRange(const playback_t *playback, uint32_t *first, uint32_t *last)
+{
+    *first = *last = 0;
+    if (!playback->blocks) return;
+    const record_index_t *end = &playback->index[playback->blocks-1];
+    *first = playback->index[0].first_tick;
+    *last = end->first_tick + end->frames - 1;
+}
+
+int PlaybackSeek(playback_t *playback, uint32_t tick, momentum_t *particles, int max)
+{
+    // Last block starting at or before tick
+    int lo = 0, hi = playback->blocks - 1, b = -1;
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (playback->index[mid].first_tick <= tick) { b = mid; lo = mid + 1; }
+        else hi = mid - 1;
+    }
+    if (b < 0) return -1;
+
+    const record_index_t *entry = &playback->index[b];
+    if (playback->cached != b)
+    {
+        playback->block = (u8*) realloc(playback->block, entry->bytes);
+        assert(playback->block);
+        playback->cached = -1;
+        SDL_RWseek(playback->file, entry->offset, RW_SEEK_SET);
+        if (SDL_RWread(playback->file, playback->block, 1, entry->bytes) != entry->bytes) return -1;
+        playback->cached = b;
+    }
+
+    record_frames_t *frames = &playback->frames;
+    frames->previous_count = 0;
+    const u8 *in = playback->block;
+    for (u32 frame=0; frame < entry->frames; frame++)
+    {
+        u32 frame_header[2];
+        memcpy(frame_header, in, sizeof(frame_header));
+        in += sizeof(frame_header);
+        int count = (int)frame_header[1];
+        RecordFramesReserve(frames, count);
+
+        in += RecordUnpack(in, frames->values, count);
+        int expected = 0;
+        for (int i=0; i < count; i++)
+        {
+            u32 code = frames->values[i];
+            if (code == 1)
+            {
+                frames->link[i] = -1;
+                continue;
+            }
+            int j = (code == 0) ? expected : expected + (int)Unzigzag(code - 2);
+            frames->link[i] = j;
+            expected = j + 1;
+        }
+        for (int stream=1; stream < RECORD_STREAMS; stream++)
+        {
+            in += RecordUnpack(in, frames->values, count);
+            for (int i=0; i < count; i++)
+            {
+                u32 bits = RecordPredict(frames, stream, i) + Unzigzag(frames->values[i]);
+                *RecordField(&frames->current[i], stream) = RecordFloat(bits);
+            }
+        }
+        RecordFramesAdvance(frames, count);
+        if (frame_header[0] < tick) continue;
+        if (frame_header[0] > tick) return -1; // tick was not recorded
+        memcpy(particles, frames->previous, SDL_min(count, max) * sizeof(momentum_t));
+        return count;
+    }
+    return -1;
+}
+
+void PlaybackClose(playback_t *playback)
+{
+    SDL_RWclose(playback->file);
+    free(playback->index);
+    free(playback->block);
+    RecordFramesFree(&playback->frames);
+    free(playback);
+}
+
+/**
+ *  \brief Headless check of recording: record a busy world, then seek every tick
+ *
+ *  momentum.exe --record-bench [ticks] [path]
+ *
+ *  The world starts with a few thousand projectiles scattered over the screen
+ *  and keeps launching. Reports the file size against raw momentum_t dumps,
+ *  and seeks every tick in a scrambled order checking it comes back bit for
+ *  bit (in playback order, by column).
+ */
+internal int RecordBenchmark(int argc, char **argv)
+{
+    int ticks = (argc > 0) ? atoi(argv[0]) : 1000;
+    const char *path = (argc > 1) ? argv[1] : "momentum-trajectory.bin";
+    int max = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+    world_config_t config = {1, 1, 0};
+    world_t *world = WorldCreate(&config);
+    momentum_t *particles = (momentum_t*) calloc(max, sizeof(momentum_t));
+    assert(particles);
+    int seeded = 3000;
+    ScatterParticles(config.seed, seeded, 2, particles);
+    WorldSetParticles(world, particles, seeded);
+
+    recorder_t *recorder = RecorderOpen(path);
+    if (!recorder)
+    {
+        printf("Cannot open %s\n", path);
+        return 1;
+    }
+    // Everything recorded, kept to check playback against
+    int *counts = (int*) calloc(ticks, sizeof(int));
+    momentum_t **frames = (momentum_t**) calloc(ticks, sizeof(momentum_t*));
+    assert(counts && frames);
+    u64 raw_bytes = 0;
+    double record_seconds = 0;
+    for (int tick=0; tick < ticks; tick++)
+    {
+        if (tick % 8 == 0) WorldLaunch(world);
+        WorldStep(world);
+        int count = WorldGetParticles(world, particles, max);
+        Uint64 start = SDL_GetPerformanceCounter();
+        RecorderAdd(recorder, WorldTick(world), particles, count);
+        record_seconds += (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+        counts[tick] = count;
+        frames[tick] = (momentum_t*) malloc(SDL_max(count, 1) * sizeof(momentum_t));
+        assert(frames[tick]);
+        memcpy(frames[tick], particles, count * sizeof(momentum_t));
+        qsort(frames[tick], count, sizeof(momentum_t), RecordOrder); // playback order
+        raw_bytes += (u64)count * sizeof(momentum_t);
+    }
+    u32 first_tick = WorldTick(world) - ticks + 1;
+    RecorderClose(recorder);
+    WorldDestroy(world);
+
+    playback_t *playback = PlaybackOpen(path);
+    if (!playback)
+    {
+        printf("Cannot read back %s\n", path);
+        return 1;
+    }
+    SDL_RWops *file = SDL_RWFromFile(path, "rb");
+    Sint64 file_bytes = file ? SDL_RWsize(file) : 0;
+    if (file) SDL_RWclose(file);
+
+    int mismatched = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i=0; i < ticks; i++)
+    {
+        int tick = (int)(((u64)i * 7919) % ticks); // every tick once, scrambled
+        int count = PlaybackSeek(playback, first_tick + tick, particles, max);
+        if ((count != counts[tick]) || (memcmp(particles, frames[tick], count * sizeof(momentum_t)) != 0))
+        {
+            mismatched++;
+        }
+    }
+    double seek_seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    printf("%d ticks, %.1f MB raw -> %.2f MB recorded (%.1fx), %.1f us/tick to record, "
+           "%.1f us per random seek; %d ticks differ\n",
+            ticks, raw_bytes / 1e6, file_bytes / 1e6, (double)raw_bytes / SDL_max(file_bytes, 1),
+            1e6 * record_seconds / ticks, 1e6 * seek_seconds / ticks, mismatched);
+    PlaybackClose(playback);
+    for (int tick=0; tick < ticks; tick++) free(frames[tick]);
+    free(frames);
+    free(counts);
+    free(particles);
+    return mismatched ? 1 : 0;
+}
+
+// ------------------------
+// | Differential Testing |
+// ------------------------
+
+// DrawProjectile() is the reference: every other way of moving projectiles is
+// checked against it on random worlds, tick by tick. Paths that should match
+// it bit for bit run on their own from the same start. Paths that only agree
+// up to float rounding are put back on the reference state every tick, so
+// rounding cannot pile up, and compared within DIFF_TOLERANCE. A path that is
+// only comparable on some ticks (LOD between coarse ticks) says so, and is put
+// back and compared on those alone.
+//
+// Paths that resolve collisions in another order (the streamed world walks
+// tile by tile) or not at all (LOD jumps over them) get one projectile per
+// column, which can never collide, since projectiles keep their column.
+//
+// A failure is shrunk before it is reported: particles are dropped, in halves
+// and then one at a time, for as long as the path still fails by the same
+// tick. What is left is printed with exact (hex) floats.
+#define DIFF_TOLERANCE 1e-3f
+
+typedef struct
+{
+    // Reference, and the LOD path: plain buffers
+    u32 *frame, *frame_next;
+    momentum_t *momentum, *momentum_next;
+    lod_t lod;
+    int tick; // since the case started
+    // World API and fast-forward paths
+    world_t *world;
+    // Batch path: the case runs in one lane, the others hold noise
+    batch_t *batch;
+    int lane;
+    // Streaming path: the screen as a streamed world, every tile resident
+    stream_world_t stream;
+} diff_state_t;
+
+typedef struct
+{
+    const char *name;
+    bool exact;
+    bool one_per_column; // collisions differ from the reference
+    void (*set)(diff_state_t *state, const momentum_t *particles, int count);
+    void (*step)(diff_state_t *state);
+    int (*get)(diff_state_t *state, momentum_t *particles, int max); // -1: not comparable now
+} diff_path_t;
+
+internal void DiffBuffersSet(diff_state_t *state, const momentum_t *particles, int count)
+{
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    FillRect(entire_screen, EMPTY_SPACE, state->frame);
+    memset(&state->lod, 0, sizeof(state->lod));
+    for (int i=0; i < count; i++)
+    {
+        ColorSetUnsafe((int)particles[i].x, (int)particles[i].y, PROJECTILE_COLOR, state->frame);
+        MomentumSetUnsafe((int)particles[i].x, (int)particles[i].y, particles[i], state->momentum);
+    }
+}
+
+internal void DiffBuffersSwap(diff_state_t *state)
+{
+    u32 *tmp_pix = state->frame;
+    state->frame = state->frame_next;
+    state->frame_next = tmp_pix;
+    momentum_t *tmp_mom = state->momentum;
+    state->momentum = state->momentum_next;
+    state->momentum_next = tmp_mom;
+}
+
+internal int DiffBuffersGet(diff_state_t *state, momentum_t *particles, int max)
+{
+    int count = 0;
+    for (int i=0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
+    {
+        if (state->frame[i] != PROJECTILE_COLOR) continue;
+        if (count < max) particles[count] = state->momentum[i];
+        count++;
+    }
+    return count;
+}
+
+internal void DiffReferenceStep(diff_state_t *state)
+{
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    FillRect(entire_screen, EMPTY_SPACE, state->frame_next);
+    DrawProjectile(state->frame, state->frame_next, state->momentum, state->momentum_next);
+    DiffBuffersSwap(state);
+}
+
+internal void DiffLodStep(diff_state_t *state)
+{
+    // Focus on everything: every tick is full detail
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    DrawProjectileLOD(state->frame, state->frame_next, state->momentum, state->momentum_next,
+            &state->lod, entire_screen);
+    DiffBuffersSwap(state);
+}
+
+internal void DiffLodFocusSet(diff_state_t *state, const momentum_t *particles, int count)
+{
+    // Put back on a coarse tick, where nothing is owed: LOD carries on
+    lod_t lod = state->lod;
+    DiffBuffersSet(state, particles, count);
+    if (state->tick > 0) state->lod = lod;
+    memcpy(state->frame_next, state->frame, SCREEN_WIDTH*SCREEN_HEIGHT * sizeof(u32));
+    memcpy(state->momentum_next, state->momentum, SCREEN_WIDTH*SCREEN_HEIGHT * sizeof(momentum_t));
+}
+
+internal void DiffLodFocusStep(diff_state_t *state)
+{
+    // The player paces the bottom row a column every 3 ticks, so the focus
+    // moves both on coarse ticks and between them
+    int pace = (state->tick/3 + SCREEN_WIDTH/2) % (2*(SCREEN_WIDTH-1));
+    int col = (pace < SCREEN_WIDTH) ? pace : 2*(SCREEN_WIDTH-1) - pace;
+    rect_t player = {SCREEN_HEIGHT-2, col, 1, 1};
+    DrawProjectileLOD(state->frame, state->frame_next, state->momentum, state->momentum_next,
+            &state->lod, LODFocus(player));
+    DiffBuffersSwap(state);
+    state->tick++;
+}
+
+internal int DiffLodFocusGet(diff_state_t *state, momentum_t *particles, int max)
+{
+    if (state->lod.owed > 0) return -1; // coarse region is behind the focus
+    return DiffBuffersGet(state, particles, max);
+}
+
+internal void DiffStreamSet(diff_state_t *state, const momentum_t *particles, int count)
+{
+    stream_world_t *stream = &state->stream;
+    for (int s=0; s < stream->num_slots; s++)
+    {
+        tile_slot_t *slot = &stream->slots[s];
+        memset(slot->cur->color, 0, sizeof(slot->cur->color));
+        slot->count = 0;
+    }
+    for (int i=0; i < count; i++)
+    {
+        StreamWorldLaunch(stream, (int)particles[i].x, (int)particles[i].y, particles[i]);
+    }
+}
+
+internal void DiffStreamStep(diff_state_t *state)
+{
+    StreamWorldStep(&state->stream);
+}
+
+internal int DiffStreamGet(diff_state_t *state, momentum_t *particles, int max)
+{
+    stream_world_t *stream = &state->stream;
+    int count = 0;
+    for (int row=0; row < SCREEN_HEIGHT; row++)
+    {
+        for (int col=0; col < SCREEN_WIDTH; col++)
+        {
+            int tile = (row/TILE_SIZE)*stream->tile_cols + col/TILE_SIZE;
+            const tile_t *cur = stream->slots[stream->slot_of_tile[tile]].cur;
+            int i = (row%TILE_SIZE)*TILE_SIZE + col%TILE_SIZE;
+            if (cur->color[i] != PROJECTILE_COLOR) continue;
+            if (count < max) particles[count] = cur->momentum[i];
+            count++;
+        }
+    }
+    return count;
+}
+
+internal void DiffWorldSet(diff_state_t *state, const momentum_t *particles, int count)
+{
+    WorldSetParticles(state->world, particles, count);
+}
+
+internal void DiffWorldStep(diff_state_t *state)
+{
+    WorldStep(state->world);
+}
+
+internal void DiffFastForwardStep(diff_state_t *state)
+{
+    WorldFastForward(state->world, 1);
+}
+
+internal int DiffWorldGet(diff_state_t *state, momentum_t *particles, int max)
+{
+    return WorldGetParticles(state->world, particles, max);
+}
+
+internal void DiffBatchSet(diff_state_t *state, const momentum_t *particles, int count)
+{
+    batch_t *batch = state->batch;
+    BatchReset(batch);
+    for (int w=0; w < batch->worlds; w++)
+    {
+        // Noise in the other lanes: their own launches, a few ticks apart
+        if (w != state->lane) for (int t=0; t < w; t++) { BatchLaunch(batch, w); BatchStep(batch, 3); }
+    }
+    batch_frame_t *frame = &batch->frames[batch->current];
+    for (int i=0; i < count; i++)
+    {
+        size_t slot = BatchSlot(state->lane, (int)particles[i].x, (int)particles[i].y);
+        frame->occupied[slot / BATCH_LANES] |= 1 << (state->lane % BATCH_LANES);
+        BatchSetMomentum(frame, slot, particles[i]);
+    }
+}
+
+internal void DiffBatchStep(diff_state_t *state)
+{
+    BatchStep(state->batch, 1);
+}
+
+internal int DiffBatchGet(diff_state_t *state, momentum_t *particles, int max)
+{
+    return BatchGetParticles(state->batch, state->lane, particles, max);
+}
+
+internal const diff_path_t diff_paths[] =
+{
+    {"world",        true,  false, DiffWorldSet,    DiffWorldStep,       DiffWorldGet},
+    {"lod",          true,  false, DiffBuffersSet,  DiffLodStep,         DiffBuffersGet},
+    {"lod-focus",    false, true,  DiffLodFocusSet, DiffLodFocusStep,    DiffLodFocusGet},
+    {"batch",        true,  false, DiffBatchSet,    DiffBatchStep,       DiffBatchGet},
+    {"fast-forward", false, false, DiffWorldSet,    DiffFastForwardStep, DiffWorldGet},
+    {"stream",       true,  true,  DiffStreamSet,   DiffStreamStep,      DiffStreamGet},
+};
+
+internal const diff_path_t diff_reference = {"reference", true, false, DiffBuffersSet, DiffReferenceStep, DiffBuffersGet};
+
+internal bool DiffSame(const momentum_t *a, int a_count, const momentum_t *b, int b_count, bool exact)
+{
+    if (a_count != b_count) return false;
+    if (exact) return memcmp(a, b, a_count * sizeof(momentum_t)) == 0;
+    for (int i=0; i < a_count; i++)
+    {
+        if ((a[i].y != b[i].y) || (a[i].dy != b[i].dy)
+                || (SDL_fabsf(a[i].x - b[i].x) >= DIFF_TOLERANCE)
+                || (SDL_fabsf(a[i].dx - b[i].dx) >= DIFF_TOLERANCE)) return false;
+    }
+    return true;
+}
+
+/**
+ *  \brief Run a path next to the reference
+ *
+ *  \param path_state       For the path
+ *  \param reference_state  For the reference
+ *  \param scratch          Four screen-sized particle buffers
+ *
+ *  \return First tick they differ, or 0 if they agree for `ticks` ticks
+ */
+internal int DiffRun(const diff_path_t *path, diff_state_t *path_state, diff_state_t *reference_state,
+        const momentum_t *particles, int count, int ticks, momentum_t *scratch)
+{
+    int max = SCREEN_WIDTH * SCREEN_HEIGHT;
+    momentum_t *expected = scratch, *got = scratch + max;
+    path_state->tick = 0;
+    diff_reference.set(reference_state, particles, count);
+    path->set(path_state, particles, count);
+    bool compared = true;
+    for (int tick=1; tick <= ticks; tick++)
+    {
+        if (!path->exact && compared)
+        {
+            int now = diff_reference.get(reference_state, expected, max);
+            path->set(path_state, expected, now);
+        }
+        diff_reference.step(reference_state);
+        path->step(path_state);
+        int expected_count = diff_reference.get(reference_state, expected, max);
+        int got_count = path->get(path_state, got, max);
+        compared = (got_count >= 0);
+        if (compared && !DiffSame(expected, expected_count, got, got_count, path->exact)) return tick;
+    }
+    return 0;
+}
+
+/**
+ *  \brief Drop particles from a failing case for as long as it keeps failing
+ *
+ *  \return Particles left, at the front of `particles`
+ */
+internal int DiffShrink(const diff_path_t *path, diff_state_t *path_state, diff_state_t *reference_state,
+        momentum_t *particles, int count, int *ticks, momentum_t *scratch)
+{
+    momentum_t *trial = scratch + 2 * SCREEN_WIDTH * SCREEN_HEIGHT;
+    for (int chunk=count/2; chunk >= 1; chunk = (chunk > 1) ? chunk/2 : 0)
+    {
+        for (int start=0; start < count;)
+        {
+            // Try without [start, start+chunk)
+            int end = SDL_min(start + chunk, count);
+            int kept = 0;
+            for (int i=0; i < count; i++) if ((i < start) || (i >= end)) trial[kept++] = particles[i];
+            int tick = DiffRun(path, path_state, reference_state, trial, kept, *ticks, scratch);
+            if (tick)
+            {
+                memcpy(particles, trial, kept * sizeof(momentum_t));
+                count = kept;
+                *ticks = tick;
+            }
+            else start = end;
+        }
+    }
+    return count;
+}
+
+/**
+ *  \brief Headless differential test of every projectile path against DrawProjectile()
+ *
+ *  momentum.exe --diff [cases] [ticks] [seed]
+ *
+ *  Each case scatters a random number of projectiles, sometimes crowded into
+ *  a few columns so they collide, with random speeds up and down. The
+ *  streamed world is backed by momentum-diff.bin while it runs.
+ */
+internal int DiffTest(int argc, char **argv)
+{
+    int cases = (argc > 0) ? atoi(argv[0]) : 200;
+    int ticks = (argc > 1) ? atoi(argv[1]) : 300;
+    u64 seed = (argc > 2) ? (u64)strtoull(argv[2], NULL, 0) : 1;
+    int max = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+    diff_state_t states[2] = {{0}};
+    for (int s=0; s < 2; s++)
+    {
+        diff_state_t *state = &states[s];
+        state->frame = (u32*) calloc(max, sizeof(u32));
+        state->frame_next = (u32*) calloc(max, sizeof(u32));
+        state->momentum = (momentum_t*) calloc(max, sizeof(momentum_t));
+        state->momentum_next = (momentum_t*) calloc(max, sizeof(momentum_t));
+        assert(state->frame && state->frame_next && state->momentum && state->momentum_next);
+    }
+    diff_state_t *reference_state = &states[0], *path_state = &states[1];
+    world_config_t config = {1, seed, 0};
+    path_state->world = WorldCreate(&config);
+    path_state->batch = BatchCreate(BATCH_LANES, 1);
+    const char *stream_path = "momentum-diff.bin";
+    remove(stream_path);
+    stream_world_t *stream = &path_state->stream;
+    size_t stream_tiles = (size_t)((SCREEN_HEIGHT + TILE_SIZE-1)/TILE_SIZE) * ((SCREEN_WIDTH + TILE_SIZE-1)/TILE_SIZE);
+    if (!StreamWorldOpen(stream, stream_path, SCREEN_HEIGHT, SCREEN_WIDTH, stream_tiles * 2*sizeof(tile_t)))
+    {
+        printf("Cannot open %s\n", stream_path);
+        return 1;
+    }
+    rect_t entire_screen = {0,0,SCREEN_WIDTH,SCREEN_HEIGHT};
+    StreamWorldTouchRect(stream, entire_screen);
+    StreamWorldWait(stream);
+    StreamWorldStep(stream); // takes the loaded tiles
+    momentum_t *particles = (momentum_t*) calloc(max, sizeof(momentum_t));
+    momentum_t *sparse = (momentum_t*) calloc(max, sizeof(momentum_t));
+    momentum_t *scratch = (momentum_t*) calloc(3 * max, sizeof(momentum_t));
+    assert(particles && sparse && scratch);
+
+    int num_paths = (int)SDL_arraysize(diff_paths);
+    int failures = 0;
+    for (int c=0; c < cases; c++)
+    {
+        // Random world, made canonical by the reference: one projectile a pixel
+        int count = 1 + (int)(RngU32(seed, c, 0, 0) % 400);
+        int columns = 1 + (int)(RngU32(seed, c, 0, 1) % SCREEN_WIDTH);
+        for (int i=0; i < count; i++)
+        {
+            momentum_t particle = {
+                RngUnit(RngU32(seed, c, i+1, 0)) * SCREEN_HEIGHT,
+                (float)(RngU32(seed, c, i+1, 1) % columns) + RngUnit(RngU32(seed, c, i+1, 2)),
+                (RngUnit(RngU32(seed, c, i+1, 3)) - 0.5f) * 4,
+                RngUnit(RngU32(seed, c, i+1, 4)) - 0.5f};
+            particles[i] = particle;
+        }
+        diff_reference.set(reference_state, particles, count);
+        count = diff_reference.get(reference_state, particles, max);
+        int sparse_count = 0;
+        bool column_taken[SCREEN_WIDTH] = {0};
+        for (int i=0; i < count; i++)
+        {
+            int col = (int)particles[i].y;
+            if (!column_taken[col]) sparse[sparse_count++] = particles[i];
+            column_taken[col] = true;
+        }
+
+        path_state->lane = c % BATCH_LANES;
+        for (int p=0; p < num_paths; p++)
+        {
+            const diff_path_t *path = &diff_paths[p];
+            const momentum_t *start = path->one_per_column ? sparse : particles;
+            int start_count = path->one_per_column ? sparse_count : count;
+            int tick = DiffRun(path, path_state, reference_state, start, start_count, ticks, scratch);
+            if (!tick) continue;
+            failures++;
+            momentum_t *shrunk = (momentum_t*) calloc(start_count, sizeof(momentum_t));
+            assert(shrunk);
+            memcpy(shrunk, start, start_count * sizeof(momentum_t));
+            int shrunk_count = DiffShrink(path, path_state, reference_state, shrunk, start_count, &tick, scratch);
+            printf("%s differs from the reference in case %d at tick %d; shrunk to %d projectiles:\n",
+                    path->name, c, tick, shrunk_count);
+            for (int i=0; i < shrunk_count; i++)
+            {
+                printf("  {%a, %a, %a, %a}\n", shrunk[i].x, shrunk[i].y, shrunk[i].dx, shrunk[i].dy);
+            }
+            free(shrunk);
+        }
+    }
+    printf("%d cases x %d ticks x %d paths: %d failures\n", cases, ticks, num_paths, failures);
+
+    WorldDestroy(path_state->world);
+    BatchDestroy(path_state->batch);
+    StreamWorldClose(stream);
+    remove(stream_path);
+    for (int s=0; s < 2; s++)
+    {
+        free(states[s].frame);
+        free(states[s].frame_next);
+        free(states[s].momentum);
+        free(states[s].momentum_next);
+    }
+    free(particles);
+    free(sparse);
+    free(scratch);
+    return failures ? 1 : 0;
+}
+
+// ---------
+// | Bloom |
+// ---------
+
+// Glow for presentation: light from the brightest pixels of an ARGB image
+// bleeds into their surroundings. A bright pass keeps what is over
+// BLOOM_THRESHOLD at a quarter of the size; each further level halves that
+// again and is blurred, and the levels are then added back up, coarsest
+// first, with bilinear upsampling, and the sum is added onto the image.
+//
+// Levels keep each row as four planes, b, g, r and a, premultiplied, 0 to
+// 255, so every pass works on four pixels per vector, and every pass is split
+// across threads by rows. Dim pixels are skipped by their alpha, which no
+// premultiplied channel exceeds. Each level flags the rows with anything in
+// them; other rows read as zeros and are not touched, and the image is left
+// alone wherever the glow is too faint to show, BLOOM_RUN quarter-size
+// pixels at a time.
+#define BLOOM_LEVELS 3       // quarter, eighth and sixteenth size
+#define BLOOM_THRESHOLD 150  // brightest premultiplied channel where glow starts
+#define BLOOM_STRENGTH 1.0f  // weight of each level in the glow
+#define BLOOM_RUN 8          // quarter-size pixels per test for glow
+
+typedef struct
+{
+    int rows, cols;
+    int stride;    // floats per plane, cols padded to a multiple of 4
+    float *pixels; // rows x 4 planes x stride
+    bool *lit;     // per row: anything but zeros in it
+} bloom_level_t;
+
+struct bloom_t
+{
+    thread_pool_t pool;
+    int rows, cols; // full size
+    bloom_level_t levels[BLOOM_LEVELS];
+    float *blurred;            // horizontal blur pass, as big as levels[1]
+    float *zeros;              // four planes of levels[0].stride, for unlit rows
+    bool *spread;              // lit rows once blurred, per row of levels[1]
+    float *lines[MAX_THREADS]; // per-thread, four planes of levels[0].stride
+};
+
+typedef struct
+{
+    bloom_t *bloom;
+    int level;
+    u8 *pixels;
+    int pitch;
+} bloom_job_t;
+
+/**
+ *  \brief Row `row` of `pixels`, laid out as `level`, as four planes (0 b, 1 g, 2 r, 3 a)
+ */
+inline internal float *BloomRow(const bloom_level_t *level, float *pixels, int row)
+{
+    return pixels + (size_t)row*4*level->stride;
+}
+
+/**
+ *  \brief Row `row` of a level, or zeros if nothing is in it
+ */
+inline internal const float *BloomRowOrZeros(const bloom_t *bloom, const bloom_level_t *level, int row)
+{
+    return level->lit[row] ? BloomRow(level, level->pixels, row) : bloom->zeros;
+}
+
+/**
+ *  \brief Channels of four ARGB pixels, one vector each, premultiplied
+ */
+inline internal void BloomLoad4(const u32 *argb, f32x4 channels[4])
+{
+    i32x4 pixels;
+    memcpy(&pixels, argb, sizeof(pixels));
+    channels[3] = __builtin_convertvector((pixels >> 24) & 0xFF, f32x4);
+    f32x4 alpha = channels[3] * (1/255.0f);
+    channels[0] = __builtin_convertvector(pixels & 0xFF, f32x4) * alpha;
+    channels[1] = __builtin_convertvector((pixels >> 8) & 0xFF, f32x4) * alpha;
+    channels[2] = __builtin_convertvector((pixels >> 16) & 0xFF, f32x4) * alpha;
+}
+
+/**
+ *  \brief Four ARGB pixels with straight alpha from premultiplied channels
+ */
+inline internal void BloomStore4(const f32x4 channels[4], u32 *argb)
+{
+    const f32x4 top = (f32x4){0} + 255;
+    f32x4 alpha = MinF32x4(channels[3], top);
+    f32x4 scale = top / MaxF32x4(alpha, (f32x4){0} + 1e-3f); // no color without alpha
+    i32x4 pixels = __builtin_convertvector(alpha + 0.5f, i32x4) << 24;
+    pixels |= __builtin_convertvector(MinF32x4(channels[0]*scale, top) + 0.5f, i32x4);
+    pixels |= __builtin_convertvector(MinF32x4(channels[1]*scale, top) + 0.5f, i32x4) << 8;
+    pixels |= __builtin_convertvector(MinF32x4(channels[2]*scale, top) + 0.5f, i32x4) << 16;
+    memcpy(argb, &pixels, sizeof(pixels));
+}
+
+/**
+ *  \brief Sum of the lanes of each of v[0..3], in lanes 0..3
+ */
+inline internal f32x4 BloomSumLanes(const f32x4 v[4])
+{
+    f32x4 low = __builtin_shuffle(v[0], v[1], (i32x4){0, 4, 1, 5}) + __builtin_shuffle(v[0], v[1], (i32x4){2, 6, 3, 7});
+    f32x4 high = __builtin_shuffle(v[2], v[3], (i32x4){0, 4, 1, 5}) + __builtin_shuffle(v[2], v[3], (i32x4){2, 6, 3, 7});
+    return __builtin_shuffle(low, high, (i32x4){0, 1, 4, 5}) + __builtin_shuffle(low, high, (i32x4){2, 3, 6, 7});
+}
+
+/**
+ *  \brief Bright pass of the image into quarter-size rows [begin, end)
+ *
+ *  Each quarter-size pixel is the mean of a 4 x 4 block, four blocks at a time.
+ */
+internal void BloomBrightJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    bloom_job_t *job = (bloom_job_t*) data;
+    bloom_t *bloom = job->bloom;
+    bloom_level_t *quarter = &bloom->levels[0];
+    const i32x4 dim = (i32x4){0} + BLOOM_THRESHOLD;
+    for (int row=begin; row < end; row++)
+    {
+        const u32 *src[4];
+        for (int k=0; k < 4; k++)
+        {
+            src[k] = (const u32*)(job->pixels + (size_t)SDL_min(4*row + k, bloom->rows-1)*job->pitch);
+        }
+        float *out = BloomRow(quarter, quarter->pixels, row);
+        bool lit = false;
+        for (int col=0; col < quarter->cols; col += 4)
+        {
+            i32x4 bright = {0}; // skip the four blocks if all dim
+            for (int k=0; k < 4; k++)
+            {
+                if (4*col + 16 > bloom->cols) // the right edge
+                {
+                    for (int i=4*col; i < bloom->cols; i++) bright[0] |= (src[k][i] >> 24) > BLOOM_THRESHOLD;
+                    continue;
+                }
+                for (int i=0; i < 16; i += 4)
+                {
+                    i32x4 pixels;
+                    memcpy(&pixels, src[k] + 4*col + i, sizeof(pixels));
+                    bright |= ((pixels >> 24) & 0xFF) > dim;
+                }
+            }
+            if (!(bright[0] | bright[1] | bright[2] | bright[3]))
+            {
+                if (lit) for (int c=0; c < 4; c++) memset(out + c*quarter->stride + col, 0, 4*sizeof(float));
+                continue;
+            }
+            if (!lit) memset(out, 0, 4*quarter->stride*sizeof(float)); // what came before was all dim
+            lit = true;
+
+            f32x4 sums[4][4] = {{{0}}}; // [channel][block], a lane per column of the block
+            for (int block=0; block < 4; block++)
+            {
+                int left = 4*(col + block);
+                if (left >= bloom->cols) break;
+                for (int k=0; k < 4; k++)
+                {
+                    u32 edge[4]; // the right edge repeats its last column
+                    const u32 *pixels = src[k] + left;
+                    if (left + 4 > bloom->cols)
+                    {
+                        for (int i=0; i < 4; i++) edge[i] = src[k][SDL_min(left + i, bloom->cols-1)];
+                        pixels = edge;
+                    }
+                    f32x4 channels[4];
+                    BloomLoad4(pixels, channels);
+                    f32x4 brightest = MaxF32x4(MaxF32x4(channels[0], channels[1]), channels[2]);
+                    f32x4 weight = (brightest - BLOOM_THRESHOLD) * (1.0f / (255 - BLOOM_THRESHOLD));
+                    weight = MinF32x4(MaxF32x4(weight, (f32x4){0}), (f32x4){0} + 1); // ramp in, no popping
+                    for (int c=0; c < 4; c++) sums[c][block] += channels[c] * weight;
+                }
+            }
+            for (int c=0; c < 4; c++)
+            {
+                f32x4 mean = BloomSumLanes(sums[c]) * (1/16.0f);
+                memcpy(out + c*quarter->stride + col, &mean, sizeof(mean));
+            }
+        }
+        quarter->lit[row] = lit;
+    }
+}
+
+/**
+ *  \brief Rows [begin, end) of job->level, each pixel the mean of four in the level above
+ */
+internal void BloomDownsampleJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    bloom_job_t *job = (bloom_job_t*) data;
+    bloom_t *bloom = job->bloom;
+    const bloom_level_t *from = &bloom->levels[job->level - 1];
+    bloom_level_t *to = &bloom->levels[job->level];
+    for (int row=begin; row < end; row++)
+    {
+        int next = SDL_min(2*row + 1, from->rows-1);
+        to->lit[row] = from->lit[2*row] || from->lit[next];
+        if (!to->lit[row]) continue;
+        for (int c=0; c < 4; c++)
+        {
+            const float *top = BloomRowOrZeros(bloom, from, 2*row) + c*from->stride;
+            const float *bottom = BloomRowOrZeros(bloom, from, next) + c*from->stride;
+            float *out = BloomRow(to, to->pixels, row) + c*to->stride;
+            int col = 0;
+            for (; 2*col + 8 <= from->cols; col += 4)
+            {
+                f32x4 a[2], b[2];
+                memcpy(a, top + 2*col, sizeof(a));
+                memcpy(b, bottom + 2*col, sizeof(b));
+                f32x4 low = a[0] + b[0], high = a[1] + b[1];
+                f32x4 mean = (__builtin_shuffle(low, high, (i32x4){0, 2, 4, 6}) +
+                              __builtin_shuffle(low, high, (i32x4){1, 3, 5, 7})) * 0.25f;
+                memcpy(out + col, &mean, sizeof(mean));
+            }
+            for (; col < to->cols; col++)
+            {
+                int left = 2*col, right = SDL_min(2*col + 1, from->cols-1);
+                out[col] = (top[left] + top[right] + bottom[left] + bottom[right]) * 0.25f;
+            }
+        }
+    }
+}
+
+/**
+ *  \brief Horizontal pass of the 1 4 6 4 1 blur, rows [begin, end) of job->level into bloom->blurred
+ */
+internal void BloomBlurRowsJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    bloom_job_t *job = (bloom_job_t*) data;
+    const bloom_level_t *level = &job->bloom->levels[job->level];
+    int cols = level->cols;
+    for (int row=begin; row < end; row++)
+    {
+        if (!level->lit[row]) continue;
+        for (int c=0; c < 4; c++)
+        {
+            const float *in = BloomRow(level, level->pixels, row) + c*level->stride;
+            float *out = BloomRow(level, job->bloom->blurred, row) + c*level->stride;
+            for (int col=0; col < cols; col++)
+            {
+                if ((col >= 2) && (col + 6 <= cols)) // four at a time through the middle
+                {
+                    f32x4 taps[5];
+                    for (int k=0; k < 5; k++) memcpy(&taps[k], in + col + k-2, sizeof(taps[k]));
+                    f32x4 sum = (taps[0] + taps[4] + 4*(taps[1] + taps[3]) + 6*taps[2]) * (1/16.0f);
+                    memcpy(out + col, &sum, sizeof(sum));
+                    col += 3;
+                    continue;
+                }
+                float sum = 6*in[col];
+                sum += 4*(in[SDL_max(col-1, 0)] + in[SDL_min(col+1, cols-1)]);
+                sum += in[SDL_max(col-2, 0)] + in[SDL_min(col+2, cols-1)];
+                out[col] = sum * (1/16.0f);
+            }
+        }
+    }
+}
+
+/**
+ *  \brief Vertical pass of the 1 4 6 4 1 blur, bloom->blurred back into rows [begin, end) of job->level
+ */
+internal void BloomBlurColsJob(void *data, int begin, int end, int thread)
+{
+    (void)thread;
+    bloom_job_t *job = (bloom_job_t*) data;
+    bloom_t *bloom = job->bloom;
+    bloom_level_t *level = &bloom->levels[job->level];
+    for (int row=begin; row < end; row++)
+    {
+        if (!bloom->spread[row]) continue;
+        const float *in[5];
+        for (int k=0; k < 5; k++)
+        {
+            int from = SDL_min(SDL_max(row + k-2, 0), level->rows-1);
+            in[k] = level->lit[from] ? BloomRow(level, bloom->blurred, from) : bloom->zeros;
+        }
+        float *out = BloomRow(level, level->pixels, row);
+        for (int col=0; col < 4*level->stride; col += 4)
+        {
+            f32x4 taps[5];
+            for (int k=0; k < 5; k++) memcpy(&taps[k], in[k] + col, sizeof(taps[k]));
+            f32x4 sum = (taps[0] + taps[4] + 4*(taps[1] + taps[3]) + 6*taps[2]) * (1/16.0f);
+            memcpy(out + col, &sum, sizeof(sum));
+        }
+    }
+}
+
+typedef struct
+{
+    const float *closest, *next; // rows of a level, or zeros
+    float weight;                // of the next one
+} bloom_lerp_t;
+
+/**
+ *  \brief The two rows of `from` that row `row` of a level `scale` times as tall mixes, bilinear
+ *
+ *  \return false if both are unlit
+ */
+internal bool BloomLerpRows(const bloom_t *bloom, const bloom_level_t *from, int row, int scale, bloom_lerp_t *lerp)
+{
+    float offset = (row % scale + 0.5f) / scale - 0.5f; // from the nearest row
+    int closest = row / scale;
+    int next = (offset < 0) ? SDL_max(closest - 1, 0) : SDL_min(closest + 1, from->rows-1);
+    lerp->closest = BloomRowOrZeros(bloom, from, closest);
+    lerp->next = BloomRowOrZeros(bloom, from, next);
+    lerp->weight = SDL_fabsf(offset);
+    return from->lit[closest] || from->lit[next];
+}
+
+/**
+ *  \brief Columns [begin, end) of every plane of the mixed row into `line`, laid out as `from`
+ *
+ *  \param begin  A multiple of 4
+ */
+internal void BloomLerp(const bloom_level_t *from, const bloom_lerp_t *lerp, int begin, int end, float *line)
+{
+    for (int c=0; c < 4; c++)
+    {
+        for (int col=c*from->stride + begin; col < c*from->stride + end; col += 4)
+        {
+            f32x4 closest, next;
+            memcpy(&closest, lerp->closest + col, sizeof(closest));
+            memcpy(&next, lerp->next + col, sizeof(next));
+            f32x4 mixed = closest + lerp->weight*(next - closest);
+            memcpy(line + col, &mixed, sizeof(mixed));
+        }
+    }
+}
+
+/**
+ *  \brief Add job->level, upsampled, into rows [begin, end) of the level above
+ */
+internal void BloomUpsampleJob(void *data, int begin, int end, int thread)
+{
+    bloom_job_t *job = (bloom_job_t*) data;
+    bloom_t *bloom = job->bloom;
+    const bloom_level_t *from = &bloom->levels[job->level];
+    bloom_level_t *to = &bloom->levels[job->level - 1];
+    float *line = bloom->lines[thread];
+    for (int row=begin; row < end; row++)
+    {
+        bloom_lerp_t lerp;
+        if (!BloomLerpRows(bloom, from, row, 2, &lerp)) continue;
+        BloomLerp(from, &lerp, 0, from->stride, line);
+        if (!to->lit[row]) memset(BloomRow(to, to->pixels, row), 0, 4*to->stride*sizeof(float));
+        to->lit[row] = true;
+        for (int c=0; c < 4; c++)
+        {
+            const float *in = line + c*from->stride;
+            float *out = BloomRow(to, to->pixels, row) + c*to->stride;
+            for (int col=0; col < to->cols; col++)
+            {
+                int source = col/2;
+                if ((col % 8 == 0) && (source >= 1) && (source + 5 <= from->cols)) // eight at a time
+                {
+                    f32x4 left, middle, right, low, high;
+                    memcpy(&left, in + source-1, sizeof(left));
+                    memcpy(&middle, in + source, sizeof(middle));
+                    memcpy(&right, in + source+1, sizeof(right));
+                    f32x4 even = 0.25f*left + 0.75f*middle, odd = 0.75f*middle + 0.25f*right;
+                    memcpy(&low, out + col, sizeof(low));
+                    memcpy(&high, out + col + 4, sizeof(high));
+                    low += __builtin_shuffle(even, odd, (i32x4){0, 4, 1, 5});
+                    high += __builtin_shuffle(even, odd, (i32x4){2, 6, 3, 7});
+                    memcpy(out + col, &low, sizeof(low));
+                    memcpy(out + col + 4, &high, sizeof(high));
+                    col += 7;
+                    continue;
+                }
+                int neighbour = (col & 1) ? SDL_min(source + 1, from->cols-1) : SDL_max(source - 1, 0);
+                out[col] += 0.75f*in[source] + 0.25f*in[neighbour];
+            }
+        }
+    }
+}
+
+/**
+ *  \brief Image rows [begin, end) plus their glow
+ *
+ *  The glow is the quarter-size level scaled up four times, bilinear: each
+ *  quarter-size pixel gives four columns, weighted with its neighbours.
+ */
+internal void BloomCompositeJob(void *data, int begin, int end, int thread)
+{
+    bloom_job_t *job = (bloom_job_t*) data;
+    bloom_t *bloom = job->bloom;
+    const bloom_level_t *quarter = &bloom->levels[0];
+    float *line = bloom->lines[thread];
+    const f32x4 left_weight = (f32x4){0.375f, 0.125f, 0, 0} * BLOOM_STRENGTH;
+    const f32x4 right_weight = (f32x4){0, 0, 0.125f, 0.375f} * BLOOM_STRENGTH;
+    const f32x4 middle_weight = BLOOM_STRENGTH - left_weight - right_weight;
+    const float faint = 0.5f / BLOOM_STRENGTH; // glow that rounds away
+    for (int row=begin; row < end; row++)
+    {
+        bloom_lerp_t lerp;
+        if (!BloomLerpRows(bloom, quarter, row, 4, &lerp)) continue;
+        const float *b = line, *g = b + quarter->stride, *r = g + quarter->stride, *a = r + quarter->stride;
+        const float *closest_alpha = lerp.closest + 3*quarter->stride, *next_alpha = lerp.next + 3*quarter->stride;
+        u32 *pixels = (u32*)(job->pixels + (size_t)row*job->pitch);
+        for (int run=0; run < quarter->cols; run += BLOOM_RUN)
+        {
+            // The mix is never brighter than both rows, and the upsampling
+            // blends in a neighbour either side
+            int run_end = SDL_min(run + BLOOM_RUN, quarter->cols);
+            int first = SDL_max(run - 1, 0), last = SDL_min(run_end + 1, quarter->cols);
+            float most = 0;
+            for (int c=first; c < last; c++) most = SDL_max(most, SDL_max(closest_alpha[c], next_alpha[c]));
+            if (most < faint) continue;
+            BloomLerp(quarter, &lerp, first / 4 * 4, SDL_min((last + 3) / 4 * 4, quarter->stride), line);
+            for (int cell=run; cell < run_end; cell++)
+            {
+                int left = SDL_max(cell - 1, 0), right = SDL_min(cell + 1, quarter->cols-1);
+                int col = 4*cell;
+                bool edge = (col + 4 > bloom->cols);
+                u32 partial[4] = {0};
+                if (edge) memcpy(partial, pixels + col, (bloom->cols - col) * sizeof(u32));
+                f32x4 channels[4] = {{0}};
+                u64 any[2]; // clear, as most of the image is: nothing to convert
+                memcpy(any, edge ? partial : pixels + col, sizeof(any));
+                if (any[0] | any[1]) BloomLoad4(edge ? partial : pixels + col, channels);
+                channels[0] += left_weight*b[left] + middle_weight*b[cell] + right_weight*b[right];
+                channels[1] += left_weight*g[left] + middle_weight*g[cell] + right_weight*g[right];
+                channels[2] += left_weight*r[left] + middle_weight*r[cell] + right_weight*r[right];
+                channels[3] += left_weight*a[left] + middle_weight*a[cell] + right_weight*a[right];
+                BloomStore4(channels, edge ? partial : pixels + col);
+                if (edge) memcpy(pixels + col, partial, (bloom->cols - col) * sizeof(u32));
+            }
+        }
+    }
+}
+
+bloom_t *BloomCreate(int rows, int cols, int threads)
+{
+    bloom_t *bloom = (bloom_t*) calloc(1, sizeof(bloom_t));
+    assert(bloom);
+    bloom->rows = rows;
+    bloom->cols = cols;
+    for (int l=0; l < BLOOM_LEVELS; l++)
+    {
+        bloom_level_t *level = &bloom->levels[l];
+        level->rows = l ? (bloom->levels[l-1].rows + 1) / 2 : (rows + 3) / 4;
+        level->cols = l ? (bloom->levels[l-1].cols + 1) / 2 : (cols + 3) / 4;
+        level->stride = (level->cols + 3) / 4 * 4;
+        level->pixels = (float*) calloc((size_t)level->rows*4*level->stride, sizeof(float));
+        level->lit = (bool*) calloc(level->rows, sizeof(bool));
+        assert(level->pixels && level->lit);
+    }
+    const bloom_level_t *quarter = &bloom->levels[0], *eighth = &bloom->levels[1];
+    bloom->blurred = (float*) calloc((size_t)eighth->rows*4*eighth->stride, sizeof(float));
+    bloom->zeros = (float*) calloc(4*quarter->stride, sizeof(float));
+    bloom->spread = (bool*) calloc(eighth->rows, sizeof(bool));
+    assert(bloom->blurred && bloom->zeros && bloom->spread);
+    ThreadPoolInit(&bloom->pool, threads);
+    for (int t=0; t < bloom->pool.num_threads; t++)
+    {
+        bloom->lines[t] = (float*) calloc(4*quarter->stride, sizeof(float));
+        assert(bloom->lines[t]);
+    }
+    return bloom;
+}
+
+void BloomDestroy(bloom_t *bloom)
+{
+    if (!bloom) return;
+    for (int t=0; t < bloom->pool.num_threads; t++) free(bloom->lines[t]);
+    ThreadPoolFree(&bloom->pool);
+    for (int l=0; l < BLOOM_LEVELS; l++)
+    {
+        free(bloom->levels[l].pixels);
+        free(bloom->levels[l].lit);
+    }
+    free(bloom->blurred);
+    free(bloom->zeros);
+    free(bloom->spread);
+    free(bloom);
+}
+
+void BloomApply(bloom_t *bloom, void *pixels, int pitch)
+{
+    bloom_job_t job = {bloom, 0, (u8*)pixels, pitch};
+    thread_pool_t *pool = &bloom->pool;
+    const bloom_level_t *quarter = &bloom->levels[0];
+    ParallelFor(pool, quarter->rows, SDL_max(2048 / quarter->cols, 1), BloomBrightJob, &job);
+    for (job.level=1; job.level < BLOOM_LEVELS; job.level++) // each level from the blurred one above
+    {
+        bloom_level_t *level = &bloom->levels[job.level];
+        int chunk = SDL_max(2048 / level->cols, 1);
+        ParallelFor(pool, level->rows, chunk, BloomDownsampleJob, &job);
+        ParallelFor(pool, level->rows, chunk, BloomBlurRowsJob, &job);
+        for (int row=0; row < level->rows; row++) // the blur reaches two rows out
+        {
+            bloom->spread[row] = false;
+            for (int k=SDL_max(row - 2, 0); k <= SDL_min(row + 2, level->rows-1); k++) bloom->spread[row] |= level->lit[k];
+        }
+        ParallelFor(pool, level->rows, chunk, BloomBlurColsJob, &job);
+        memcpy(level->lit, bloom->spread, level->rows*sizeof(bool));
+    }
+    for (job.level=BLOOM_LEVELS-1; job.level > 0; job.level--)
+    {
+        bloom_level_t *level = &bloom->levels[job.level-1];
+        ParallelFor(pool, level->rows, SDL_max(2048 / level->cols, 1), BloomUpsampleJob, &job);
+    }
+    ParallelFor(pool, bloom->rows, SDL_max(8192 / bloom->cols, 1), BloomCompositeJob, &job);
+}
+
+/**
+ *  \brief Headless benchmark: glow over projectiles scaled up to a presentation size
+ *
+ *  momentum.exe --bloom [projectiles] [rows] [cols] [frames] [threads]
+ *
+ *  The world is drawn as big as fits, centred, as a full screen window
+ *  would show it. Also checks that an image with nothing bright in it
+ *  comes out unchanged.
+ */
+internal int BloomBenchmark(int argc, char **argv)
+{
+    int count   = (argc > 0) ? atoi(argv[0]) : 2000;
+    int rows    = (argc > 1) ? atoi(argv[1]) : 1080;
+    int cols    = (argc > 2) ? atoi(argv[2]) : 1920;
+    int frames  = (argc > 3) ? atoi(argv[3]) : 200;
+    int threads = (argc > 4) ? atoi(argv[4]) : 0;
+    int scale = SDL_max(SDL_min(rows / SCREEN_HEIGHT, cols / SCREEN_WIDTH), 1);
+    int world_rows = SCREEN_HEIGHT*scale, world_cols = SCREEN_WIDTH*scale;
+    int top = SDL_max(rows - world_rows, 0) / 2, left = SDL_max(cols - world_cols, 0) / 2;
+    u8 *indexes = (u8*) calloc((size_t)world_rows*world_cols, sizeof(u8));
+    u32 *image = (u32*) calloc((size_t)rows*cols, sizeof(u32));
+    u32 *glowing = (u32*) calloc((size_t)rows*cols, sizeof(u32));
+    momentum_t *particles = (momentum_t*) calloc(count, sizeof(momentum_t));
+    assert(indexes && image && glowing && particles);
+
+    world_t *world = WorldCreate(NULL);
+    ScatterParticles(1, count, 2, particles);
+    int placed = WorldSetParticles(world, particles, count);
+    bloom_t *bloom = BloomCreate(rows, cols, threads);
+    double seconds = 0;
+    for (int frame=0; frame < frames; frame++)
+    {
+        WorldRenderInterpolated(world, (frame % 4) / 4.0f, scale, indexes);
+        for (int row=0; row < SDL_min(world_rows, rows); row++) // cropped if the image is smaller
+        {
+            PaletteExpand(WorldPalette(world), indexes + (size_t)row*world_cols, 1, SDL_min(world_cols, cols),
+                    image + (size_t)(top + row)*cols + left, cols*sizeof(u32));
+        }
+        memcpy(glowing, image, (size_t)rows*cols*sizeof(u32));
+        Uint64 start = SDL_GetPerformanceCounter();
+        BloomApply(bloom, glowing, cols*sizeof(u32));
+        seconds += (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    }
+
+    // Translucent green everywhere: nothing bright, so nothing may change
+    for (size_t i=0; i < (size_t)rows*cols; i++) image[i] = glowing[i] = PLAYER_COLOR;
+    BloomApply(bloom, glowing, cols*sizeof(u32));
+    bool unchanged = (memcmp(image, glowing, (size_t)rows*cols*sizeof(u32)) == 0);
+
+    printf("%dx%d, %d projectiles at %dx, %d threads: %.2f ms per frame (budget 2 ms); "
+           "dim image %s\n", cols, rows, placed, scale, bloom->pool.num_threads,
+            1e3 * seconds / frames, unchanged ? "unchanged" : "CHANGED");
+    BloomDestroy(bloom);
+    WorldDestroy(world);
+    free(indexes);
+    free(image);
+    free(glowing);
+    free(particles);
+    return unchanged ? 0 : 1;
+}
+
+int MomentumHeadless(int argc, char **argv)
+{
+    if (argc < 2) return -1;
+    if (strcmp(argv[1], "--stream") == 0)        return StreamDemo(argc-2, argv+2);
+    if (strcmp(argv[1], "--hash") == 0)          return HashScenario(argc-2, argv+2);
+    if (strcmp(argv[1], "--shm-view") == 0)      return ShmView(argc-2, argv+2);
+    if (strcmp(argv[1], "--rng") == 0)           return RngBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--heatmap") == 0)       return HeatmapBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--sph") == 0)           return SphBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--stable-fluids") == 0) return StableFluidBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--lbm") == 0)           return LbmBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--heat") == 0)          return HeatBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--life") == 0)          return LifeBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--pm") == 0)            return PmBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--batch") == 0)         return BatchBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--sweep") == 0)         return SweepRun(argc-2, argv+2);
+    if (strcmp(argv[1], "--record-bench") == 0)  return RecordBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--fast-forward") == 0)  return FastForwardBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--rewind") == 0)        return RewindBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--palette") == 0)       return PaletteBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--interpolate") == 0)   return InterpolateBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--splat") == 0)         return SplatBenchmark(argc-2, argv+2);
+    if (strcmp(argv[1], "--diff") == 0)          return DiffTest(argc-2, argv+2);
+    if (strcmp(argv[1], "--allocs") == 0)        return AllocationCheck(argc-2, argv+2);
+    if (strcmp(argv[1], "--bloom") == 0)         return BloomBenchmark(argc-2, argv+2);
+    return -1;
+}
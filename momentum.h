@@ -0,0 +1,240 @@
+// momentum engine: the simulation as a library.
+//
+// A world is an opaque handle holding everything one simulation needs: the
+// projectile and momentum buffers, the player, every optional mode, and a
+// thread pool. Worlds share nothing, so a process can run as many as it
+// likes. The SDL front end in main.c is one client of this API.
+//
+// Coordinates follow the engine: x is the row (down is positive), y is the
+// column. Pixels are ARGB8888, row-major.
+#ifndef MOMENTUM_H
+#define MOMENTUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+    float x;  // vertical position as float (think fractional rows)
+    float y;  // horizontal position as float (think fractional cols)
+    float dx; // vertical (think rows)
+    float dy; // horizontal (think cols)
+} momentum_t;
+
+typedef struct world_t world_t;
+
+typedef struct
+{
+    int threads; // 0: one per core; use 1 when running many worlds at once
+    uint64_t seed; // keys every random number the world draws
+    int smooth_scale; // the scale WORLD_SMOOTH anti-aliases at, 0: 5
+} world_config_t;
+
+// Optional behavior, all off in a new world
+typedef enum
+{
+    WORLD_LOD,     // coarse updates away from the player
+    WORLD_TRAILS,  // fading trails behind projectiles
+    WORLD_HEATMAP, // color by how many projectiles passed
+    WORLD_FLUID,   // SPH liquid; launching pours a block instead
+    WORLD_WIND,    // stable-fluids wind, the player blows upward like a fan
+    WORLD_TUNNEL,  // lattice Boltzmann flow around everything drawn
+    WORLD_HEAT,    // temperature that projectiles warm and rise on
+    WORLD_LIFE,    // Conway's Life, seeded by projectiles as they fly
+    WORLD_CLOUD,   // a dust cloud collapsing under its own gravity
+    WORLD_SMOOTH,  // anti-aliased projectiles in WorldRenderInterpolated()
+    WORLD_MODE_COUNT
+} world_mode_t;
+
+// ---Lifetime---
+
+world_t *WorldCreate(const world_config_t *config); // NULL config: defaults
+void WorldDestroy(world_t *world);
+
+// ---Simulation---
+
+void WorldStep(world_t *world); // one physics tick
+void WorldLaunch(world_t *world); // fire a projectile (or pour fluid)
+void WorldMovePlayer(world_t *world, int rows, int cols); // one step each way, -1, 0 or 1
+void WorldSetMode(world_t *world, world_mode_t mode, int enabled);
+int  WorldMode(const world_t *world, world_mode_t mode);
+
+/**
+ *  \brief Same as `ticks` WorldStep() calls, but in closed form between events
+ *
+ *  Costs a few events per projectile however far it jumps. Positions agree
+ *  with stepping up to float rounding. With any mode but WORLD_LOD or
+ *  WORLD_SMOOTH on, it just steps.
+ */
+void WorldFastForward(world_t *world, uint32_t ticks);
+
+// ---Queries---
+
+void WorldSize(const world_t *world, int *rows, int *cols);
+void WorldPlayer(const world_t *world, int *row, int *col);
+uint32_t WorldTick(const world_t *world);
+uint64_t WorldHash(world_t *world); // changes iff projectiles or player changed
+
+/**
+ *  \brief Draw the current frame: projectiles and modes, and the player
+ *
+ *  Either buffer may be NULL. Both are rows x cols ARGB.
+ */
+void WorldRender(world_t *world, uint32_t *pixels, uint32_t *player_pixels);
+
+/**
+ *  \brief Like WorldRender(), but one palette index per pixel
+ *
+ *  A quarter of the bytes of ARGB. Colors are the same except that trails and
+ *  heat ramps take fewer shades. Widen with PaletteExpand(), ideally straight
+ *  into a locked texture.
+ */
+void WorldRenderIndexed(world_t *world, uint8_t *indexes, uint8_t *player_indexes);
+
+/**
+ *  \brief Draw projectiles `alpha` of the way from the last tick to this one
+ *
+ *  For frames that fall between ticks: 0 is where they were a tick ago, 1 is
+ *  where they are now. Output is (rows*scale) x (cols*scale) palette indexes,
+ *  each projectile a scale x scale block at its exact position, not snapped
+ *  to its pixel. WORLD_SMOOTH blends the block's edges into the texels they
+ *  partly cover, at the world's smooth_scale only. With any other mode but
+ *  WORLD_LOD on, it draws WorldRenderIndexed() scaled up instead.
+ */
+void WorldRenderInterpolated(world_t *world, float alpha, int scale, uint8_t *indexes);
+
+/**
+ *  \brief The 256 ARGB colors of WorldRenderIndexed(); fixed for the world's lifetime
+ */
+const uint32_t *WorldPalette(const world_t *world);
+
+/**
+ *  \brief Widen rows x cols palette indexes to ARGB, `pitch` bytes per output row
+ */
+void PaletteExpand(const uint32_t *palette, const uint8_t *indexes, int rows, int cols,
+        void *pixels, int pitch);
+
+// ---Bulk particle I/O---
+
+/**
+ *  \brief Copy out up to `max` projectiles, in row-major pixel order
+ *
+ *  \return Total number of projectiles, which may be more than `max`
+ */
+int WorldGetParticles(const world_t *world, momentum_t *particles, int max);
+
+/**
+ *  \brief Replace every projectile with `particles`
+ *
+ *  Each lands on the pixel under its position. Ones off the grid, or on a
+ *  pixel already taken, are dropped.
+ *
+ *  \return Number placed
+ */
+int WorldSetParticles(world_t *world, const momentum_t *particles, int count);
+
+// ---Rewind---
+
+/**
+ *  \brief Keep a history of past ticks, in at most about `budget_bytes`
+ *
+ *  Covers projectiles and the player, not the optional modes. 0 turns it off.
+ *  Allocates the budget once, here; capturing a tick never allocates. If the
+ *  ticks since the last keyframe (up to 64) outgrow it, the history starts
+ *  over from the current tick.
+ */
+void WorldSetRewind(world_t *world, size_t budget_bytes);
+int WorldRewindRange(world_t *world, uint32_t *first, uint32_t *last); // 0 if no history
+
+/**
+ *  \brief Go back (or forward again) to a tick in the history
+ *
+ *  Stepping from there replaces the history after it.
+ *
+ *  \return 0 if `tick` is not in the history
+ */
+int WorldRewind(world_t *world, uint32_t tick);
+
+// ---Sharing---
+
+/**
+ *  \brief Publish every tick to shared memory segment `name` (see --shm-view)
+ *
+ *  \return 0 if the segment could not be created
+ */
+int WorldShare(world_t *world, const char *name);
+
+// ---Batches---
+
+// Many small worlds stepped together, projectiles only, each with its own
+// gravity and blast. Much faster than as many separate worlds.
+typedef struct batch_t batch_t;
+
+batch_t *BatchCreate(int worlds, int threads); // threads 0: one per core
+void BatchDestroy(batch_t *batch);
+void BatchReset(batch_t *batch); // empty every world, default physics
+void BatchSetPhysics(batch_t *batch, int world, double gravity, float blast);
+int  BatchLaunch(batch_t *batch, int world); // 0 if the spot was taken
+void BatchStep(batch_t *batch, int ticks); // every world, `ticks` ticks
+int  BatchGetParticles(const batch_t *batch, int world, momentum_t *particles, int max); // as WorldGetParticles
+
+// ---Trajectory recording---
+
+// Every projectile every tick, delta-encoded and bit-packed, written by a
+// background thread, with an index so any tick can be read back quickly.
+typedef struct recorder_t recorder_t;
+typedef struct playback_t playback_t;
+
+recorder_t *RecorderOpen(const char *path); // NULL if the file cannot be created
+
+/**
+ *  \brief Record the particles at `tick`
+ *
+ *  Ticks must increase. After a rewind, nothing is recorded until the world
+ *  passes the last tick recorded; the recording then carries on from the new
+ *  history.
+ *
+ *  \return 0 if `tick` is not after the last one added, and nothing was recorded
+ */
+int RecorderAdd(recorder_t *recorder, uint32_t tick, const momentum_t *particles, int count);
+void RecorderClose(recorder_t *recorder); // flushes and writes the index
+
+playback_t *PlaybackOpen(const char *path); // NULL if not a closed recording
+void PlaybackRange(const playback_t *playback, uint32_t *first, uint32_t *last);
+
+/**
+ *  \brief Particles recorded at `tick`, up to `max` of them
+ *
+ *  Bit for bit as recorded, but ordered by column, then row.
+ *
+ *  \return Number recorded at that tick, or -1 if it was not recorded
+ */
+int PlaybackSeek(playback_t *playback, uint32_t tick, momentum_t *particles, int max);
+void PlaybackClose(playback_t *playback);
+
+// ---Bloom---
+
+// Glow around the brightest pixels of an ARGB image, for presentation.
+// Runs on the CPU, on threads of its own.
+typedef struct bloom_t bloom_t;
+
+bloom_t *BloomCreate(int rows, int cols, int threads); // threads 0: one per core
+void BloomDestroy(bloom_t *bloom);
+
+/**
+ *  \brief Add the glow of `pixels` onto them, in place
+ *
+ *  rows x cols ARGB8888 with straight alpha, as PaletteExpand() writes
+ *  them, such as a locked texture. Pixels with no glow near them are not
+ *  written.
+ */
+void BloomApply(bloom_t *bloom, void *pixels, int pitch);
+
+/**
+ *  \brief Run the headless tool named by argv[1] (--sph, --hash, ...)
+ *
+ *  \return Its exit status, or -1 if argv[1] names no tool
+ */
+int MomentumHeadless(int argc, char **argv);
+
+#endif // MOMENTUM_H